@@ -0,0 +1,276 @@
+#include "LibraryGenerator.hpp"
+#include <fstream>
+#include <cstdint>
+
+static const uint32_t SAMPLE_RATE     = 8000;
+static const uint32_t SAMPLE_COUNT    = 800; //< 0.1s
+static const int      MP3_FRAME_COUNT = 2;   //< a frame is only accepted, if it is followed by another frame
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper
+///////////////////////////////////////////////////////////////////////////////
+
+static void appendLE16(std::string& data, uint16_t value) { data += (char)value; data += (char)(value >> 8); }
+static void appendLE32(std::string& data, uint32_t value) { appendLE16(data, (uint16_t)value); appendLE16(data, (uint16_t)(value >> 16)); }
+static void appendLE64(std::string& data, uint64_t value) { appendLE32(data, (uint32_t)value); appendLE32(data, (uint32_t)(value >> 32)); }
+static void appendBE24(std::string& data, uint32_t value) { data += (char)(value >> 16); data += (char)(value >> 8); data += (char)value; }
+static void appendBE32(std::string& data, uint32_t value) { data += (char)(value >> 24); appendBE24(data, value); }
+/** ID3v2 sizes use only 7 bits per byte. */
+static void appendSyncSafe32(std::string& data, uint32_t value) { appendBE32(data, (value >> 21 & 0x7F) << 24 | (value >> 14 & 0x7F) << 16 | (value >> 7 & 0x7F) << 8 | (value & 0x7F)); }
+
+struct Tags
+{
+	std::string title;
+	std::string artist;
+	std::string album;
+};
+
+/** Vorbis comment without framing bit (used by FLAC and OGG). */
+static std::string getVorbisComment(const Tags& tags)
+{
+	static const std::string vendor = "Console_MusicPlayer benchmark";
+	std::string data;
+	appendLE32(data, (uint32_t)vendor.size());
+	data += vendor;
+	appendLE32(data, 3);
+	for (const std::string& field : { "TITLE=" + tags.title, "ARTIST=" + tags.artist, "ALBUM=" + tags.album }) {
+		appendLE32(data, (uint32_t)field.size());
+		data += field;
+	}
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Formats
+///////////////////////////////////////////////////////////////////////////////
+
+static std::string getMp3(const Tags& tags)
+{
+	std::string frames;
+	for (auto& [id, text] : { std::make_pair("TIT2", tags.title), std::make_pair("TPE1", tags.artist), std::make_pair("TALB", tags.album) }) {
+		frames += id;
+		appendSyncSafe32(frames, (uint32_t)text.size() + 1);
+		frames += std::string(2, '\0'); // flags
+		frames += '\x03';               // utf-8
+		frames += text;
+	}
+	std::string data = "ID3";
+	data += '\x04'; // version 2.4
+	data += '\0';
+	data += '\0';   // flags
+	appendSyncSafe32(data, (uint32_t)frames.size());
+	data += frames;
+
+	// MPEG-1 layer III, 128 kbit/s, 44.1 kHz, mono: 417 bytes per frame; the side info is 0, so the frames are silent.
+	for (int i = 0; i < MP3_FRAME_COUNT; ++i) {
+		data += "\xFF\xFB\x90\xC0";
+		data += std::string(417 - 4, '\0');
+	}
+	return data;
+}
+
+static std::string getWav(const Tags& tags)
+{
+	std::string info = "INFO";
+	for (auto& [id, text] : { std::make_pair("INAM", tags.title), std::make_pair("IART", tags.artist), std::make_pair("IPRD", tags.album) }) {
+		info += id;
+		appendLE32(info, (uint32_t)text.size() + 1);
+		info += text;
+		info += '\0';
+		if ((text.size() + 1) & 1) {
+			info += '\0'; // chunks are word aligned
+		}
+	}
+
+	std::string data = "RIFF";
+	appendLE32(data, 0); // set below
+	data += "WAVEfmt ";
+	appendLE32(data, 16);
+	appendLE16(data, 1);           // PCM
+	appendLE16(data, 1);           // mono
+	appendLE32(data, SAMPLE_RATE);
+	appendLE32(data, SAMPLE_RATE); // bytes per second
+	appendLE16(data, 1);           // block align
+	appendLE16(data, 8);           // bits per sample
+	data += "LIST";
+	appendLE32(data, (uint32_t)info.size());
+	data += info;
+	data += "data";
+	appendLE32(data, SAMPLE_COUNT);
+	data += std::string(SAMPLE_COUNT, '\x80'); // 8 bit samples are unsigned
+	uint32_t riffSize = (uint32_t)data.size() - 8;
+	data.replace(4, 4, std::string{ (char)riffSize, (char)(riffSize >> 8), (char)(riffSize >> 16), (char)(riffSize >> 24) });
+	return data;
+}
+
+static std::string getFlac(const Tags& tags)
+{
+	std::string data = "fLaC";
+	data += '\x00'; // STREAMINFO
+	appendBE24(data, 34);
+	data += std::string("\x10\x00\x10\x00", 4); // min and max block size: 4096
+	data += std::string(6, '\0'); // min and max frame size: unknown
+	// sample rate (20 bits), channels - 1 (3 bits), bits per sample - 1 (5 bits), sample count (36 bits)
+	uint64_t format = (uint64_t)SAMPLE_RATE << 44 | (uint64_t)0 << 41 | (uint64_t)15 << 36 | SAMPLE_COUNT;
+	appendBE32(data, (uint32_t)(format >> 32));
+	appendBE32(data, (uint32_t)format);
+	data += std::string(16, '\0'); // MD5: unknown
+
+	std::string comment = getVorbisComment(tags);
+	data += '\x84'; // last block, VORBIS_COMMENT
+	appendBE24(data, (uint32_t)comment.size());
+	data += comment;
+	return data;
+}
+
+static uint32_t getOggCrc(const std::string& page)
+{
+	static uint32_t table[256] = {};
+	if (table[1] == 0) {
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t crc = i << 24;
+			for (int bit = 0; bit < 8; ++bit) {
+				crc = crc & 0x80000000 ? crc << 1 ^ 0x04C11DB7 : crc << 1;
+			}
+			table[i] = crc;
+		}
+	}
+	uint32_t crc = 0;
+	for (char c : page) {
+		crc = crc << 8 ^ table[(crc >> 24 ^ (uint8_t)c) & 0xFF];
+	}
+	return crc;
+}
+
+static void appendOggPage(std::string& data, uint8_t headerType, uint64_t granulePosition, uint32_t sequenceNumber, const std::string& packet)
+{
+	std::string segmentTable(packet.size() / 255, '\xFF');
+	segmentTable += (char)(packet.size() % 255);
+	std::string page = "OggS";
+	page += '\0'; // version
+	page += (char)headerType;
+	appendLE64(page, granulePosition);
+	appendLE32(page, 0x12345678); // serial
+	appendLE32(page, sequenceNumber);
+	appendLE32(page, 0);          // crc, set below
+	page += (char)segmentTable.size();
+	page += segmentTable;
+	page += packet;
+	uint32_t crc = getOggCrc(page);
+	page.replace(22, 4, std::string{ (char)crc, (char)(crc >> 8), (char)(crc >> 16), (char)(crc >> 24) });
+	data += page;
+}
+
+static std::string getOgg(const Tags& tags)
+{
+	std::string identification = "\x01vorbis";
+	appendLE32(identification, 0);           // version
+	identification += '\x01';                // mono
+	appendLE32(identification, SAMPLE_RATE);
+	appendLE32(identification, 0);           // max bitrate
+	appendLE32(identification, 64000);       // nominal bitrate
+	appendLE32(identification, 0);           // min bitrate
+	identification += '\xB8';                // block sizes: 256 and 2048
+	identification += '\x01';                // framing bit
+
+	std::string comment = "\x03vorbis" + getVorbisComment(tags) + '\x01';
+
+	std::string data;
+	appendOggPage(data, 0x02, 0, 0, identification); // beginning of stream
+	appendOggPage(data, 0x00, 0, 1, comment);
+	appendOggPage(data, 0x04, SAMPLE_COUNT, 2, ""); // end of stream
+	return data;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Library
+///////////////////////////////////////////////////////////////////////////////
+
+bool benchmark::parseFormats(const std::string& str, std::vector<std::pair<std::string, int>>& formats)
+{
+	formats.clear();
+	size_t start = 0;
+	while (start < str.size()) {
+		size_t end = str.find(',', start);
+		if (end == std::string::npos) {
+			end = str.size();
+		}
+		std::string entry = str.substr(start, end - start);
+		start = end + 1;
+		size_t separator = entry.find('=');
+		std::string extension = entry.substr(0, separator);
+		int weight = 1;
+		if (separator != std::string::npos) {
+			try {
+				weight = std::stoi(entry.substr(separator + 1));
+			}
+			catch (const std::exception&) {
+				return false;
+			}
+		}
+		if ((extension != "mp3" && extension != "wav" && extension != "flac" && extension != "ogg") || weight < 0) {
+			return false;
+		}
+		if (weight > 0) {
+			formats.push_back({ extension, weight });
+		}
+	}
+	return !formats.empty();
+}
+
+std::string benchmark::getFormatsStr(const std::vector<std::pair<std::string, int>>& formats)
+{
+	std::string str;
+	for (auto& [extension, weight] : formats) {
+		str += (str.empty() ? "" : ",") + extension + "=" + std::to_string(weight);
+	}
+	return str;
+}
+
+size_t benchmark::generateLibrary(const fs::path& rootPath, const LibraryOptions& options)
+{
+	// The formats repeat in a fixed pattern (e.g. mp3=2,wav=1: mp3, mp3, wav, mp3, ..), so the mix is exact and reproducible.
+	std::vector<const std::string*> formatPattern;
+	for (auto& [extension, weight] : options.formats) {
+		formatPattern.insert(formatPattern.end(), weight, &extension);
+	}
+	if (formatPattern.empty()) {
+		return 0;
+	}
+
+	int leafCount = 1;
+	for (int level = 0; level < options.depth; ++level) {
+		leafCount *= options.fanOut;
+	}
+	int filesPerLeaf = (options.fileCount + leafCount - 1) / leafCount;
+	size_t createdCount = 0;
+	for (int leaf = 0; leaf < leafCount && (int)createdCount < options.fileCount; ++leaf) {
+		// The digits of 'leaf' (base fanOut) are the directory indices of each level.
+		fs::path dirPath = rootPath;
+		int artist = 0;
+		for (int level = 0, divisor = leafCount / options.fanOut; level < options.depth; ++level, divisor /= options.fanOut) {
+			int dirIndex = leaf / divisor % options.fanOut;
+			if (level == 0) {
+				artist = dirIndex;
+			}
+			dirPath /= level == options.depth - 1 ? "Album " + std::to_string(leaf) : (level == 0 ? "Artist " : "Dir ") + std::to_string(dirIndex);
+		}
+		fs::create_directories(dirPath);
+		std::ofstream(dirPath / "cover.jpg");
+
+		Tags tags;
+		tags.artist = "Artist " + std::to_string(artist);
+		tags.album  = "Album " + std::to_string(leaf);
+		for (int track = 0; track < filesPerLeaf && (int)createdCount < options.fileCount; ++track, ++createdCount) {
+			const std::string& extension = *formatPattern[createdCount % formatPattern.size()];
+			tags.title = "Track " + std::to_string(track + 1);
+			std::ofstream ofs(dirPath / (tags.title + "." + extension), std::ios::out | std::ios::binary);
+			if (options.isEmpty) {
+				continue;
+			}
+			std::string data = extension == "mp3" ? getMp3(tags) : extension == "wav" ? getWav(tags) : extension == "flac" ? getFlac(tags) : getOgg(tags);
+			ofs.write(data.data(), data.size());
+		}
+	}
+	return createdCount;
+}
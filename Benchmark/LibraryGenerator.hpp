@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/**
+ * Generates a synthetic music library for the benchmarks.
+ * The files are tiny (about 1 KB), but they have real headers and tags, so the TagReader reads them like real music:
+ * - MP3: ID3v2.4 tag and a few silent CBR frames.
+ * - WAV: fmt, LIST/INFO and data chunk with silence.
+ * - FLAC: STREAMINFO and VORBIS_COMMENT block, but no audio frames.
+ * - OGG: Vorbis identification and comment header and a last page with the granule position, but no setup header and no audio.
+ *   FLAC and OGG files can not be decoded by SDL_mixer, which does not matter, because the scanner only decodes files
+ *   which the TagReader can not read.
+ * Each leaf directory is an album of one artist (the top level directory), so the tags repeat like in a real library.
+ */
+namespace benchmark
+{
+	struct LibraryOptions
+	{
+		int  depth     = 2;     //< directory levels below the root; the music is in the directories of the last level
+		int  fanOut    = 10;    //< subdirectories per directory
+		int  fileCount = 10000;
+		std::vector<std::pair<std::string, int>> formats = { { "mp3", 4 }, { "flac", 2 }, { "ogg", 2 }, { "wav", 1 } }; //< extension and weight
+		bool isEmpty   = false; //< empty files are enough to benchmark the walk
+	};
+
+	/** "mp3=4,flac=1" -> { { "mp3", 4 }, { "flac", 1 } }; returns false if a format is not supported or a weight is invalid. */
+	bool parseFormats(const std::string& str, std::vector<std::pair<std::string, int>>& formats);
+	std::string getFormatsStr(const std::vector<std::pair<std::string, int>>& formats);
+	/** Returns the count of created music files. Existing files are overwritten. Each leaf directory also gets an (empty) cover.jpg. */
+	size_t generateLibrary(const fs::path& rootPath, const LibraryOptions& options);
+}
@@ -0,0 +1,450 @@
+#include "LibraryGenerator.hpp"
+#include "core/LibraryScanner.hpp"
+#include "core/LibraryIndex.hpp"
+#include "core/MusicLibrary.hpp"
+#include "core/SmallTools.hpp"
+#include "core/Timer.hpp"
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <Windows.h>
+#include <Psapi.h>
+
+/**
+ * Benchmarks of the library loading. Usage:
+ * - Benchmark walk [directory] [file count] [runs]
+ *   Compares the directory walk of the LibraryScanner with the fs::recursive_directory_iterator loop it replaced.
+ *   If the directory does not exist, then a synthetic library of empty files is generated (only the walk is measured).
+ *   File system requests are counted with GetProcessIoCounters() (directory listings and attribute queries are 'other' operations).
+ * - Benchmark scan [--dir path] [--depth n] [--fan-out n] [--files n] [--formats mp3=4,flac=2,ogg=2,wav=1] [--regenerate]
+ *                  [--modes cold,warm,indexed] [--runs n] [--threads n] [--output json|csv] [--out file]
+ *   Loads the library like MusicPlayer::init() and reports files/s, peak working set and the time of each phase:
+ *   walk, probe (see LibraryScanner), library (MusicLibrary), playlist (rows and duration of the ALL playlist) and index
+ *   (LibraryIndex::write()). The result is written as JSON or CSV to stdout (or --out), everything else goes to stderr.
+ *   Modes:
+ *   - cold:    The cached file data is dropped before each run, so all headers are read from disk. Directory listings
+ *              can not be dropped without administrator rights, so they may still be cached.
+ *   - warm:    The file data is cached from the previous run.
+ *   - indexed: Like a player start with an up-to-date library index: nothing has to be probed.
+ *   If the directory does not exist (or with --regenerate), then a synthetic library is generated (see LibraryGenerator).
+ */
+
+///////////////////////////////////////////////////////////////////////////////
+// Walk
+///////////////////////////////////////////////////////////////////////////////
+struct WalkResult
+{
+	size_t     fileCount;
+	core::Time time;
+	ULONGLONG  ioCount;
+};
+
+/** The walk of LibraryScanner before it used the Win32 directory listing. */
+static void walkWithIterator(const std::vector<fs::path>& musicDirs, const std::function<bool(core::LibraryScanner::FileEntry&&)>& onFile)
+{
+	for (auto& musicDirPath : musicDirs) {
+		if (!fs::exists(musicDirPath)) {
+			continue;
+		}
+		std::error_code ec;
+		for (auto it = fs::recursive_directory_iterator(musicDirPath, fs::directory_options::skip_permission_denied, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+			if (ec || !it->is_regular_file(ec) || !core::isSupportedAudioFile(it->path())) {
+				continue;
+			}
+			core::LibraryScanner::FileEntry fileEntry;
+			fileEntry.path          = fs::path(it->path().wstring()).make_preferred();
+			fileEntry.fileSize      = it->file_size(ec);
+			fileEntry.lastWriteTime = it->last_write_time(ec).time_since_epoch().count();
+			if (!onFile(std::move(fileEntry))) {
+				return;
+			}
+		}
+	}
+}
+
+static ULONGLONG getIoCount()
+{
+	IO_COUNTERS ioCounters = {};
+	GetProcessIoCounters(GetCurrentProcess(), &ioCounters);
+	return ioCounters.ReadOperationCount + ioCounters.WriteOperationCount + ioCounters.OtherOperationCount;
+}
+
+static WalkResult measureWalk(const std::function<void(const std::function<bool(core::LibraryScanner::FileEntry&&)>&)>& walk)
+{
+	WalkResult result = {};
+	ULONGLONG startIoCount = getIoCount();
+	core::Timer timer;
+	walk([&result](core::LibraryScanner::FileEntry&& fileEntry) {
+		++result.fileCount;
+		return true;
+	});
+	result.time    = timer.getElapsedTime();
+	result.ioCount = getIoCount() - startIoCount;
+	return result;
+}
+
+static int runWalkBenchmark(int argc, char* argv[])
+{
+	fs::path rootPath = argc > 2 ? fs::path(argv[2]) : fs::path("benchmark_library");
+	int fileCount     = argc > 3 ? std::stoi(argv[3]) : 100000;
+	int runCount      = argc > 4 ? std::stoi(argv[4]) : 5;
+
+	if (!fs::exists(rootPath)) {
+		benchmark::LibraryOptions libraryOptions;
+		libraryOptions.depth     = 2;
+		libraryOptions.fanOut    = 32;
+		libraryOptions.fileCount = fileCount;
+		libraryOptions.isEmpty   = true;
+		std::cout << "Generating " << fileCount << " files in '" << rootPath.u8string() << "'..." << std::endl;
+		core::Timer timer;
+		benchmark::generateLibrary(rootPath, libraryOptions);
+		std::cout << "Generated in " << core::getTimeStr(timer.getElapsedTime()) << std::endl;
+	}
+
+	std::vector<fs::path> musicDirs = { fs::absolute(rootPath) };
+	std::vector<std::string> logMessages;
+	auto iteratorWalk = [&musicDirs](const std::function<bool(core::LibraryScanner::FileEntry&&)>& onFile) {
+		walkWithIterator(musicDirs, onFile);
+	};
+	auto scannerWalk = [&musicDirs, &logMessages](const std::function<bool(core::LibraryScanner::FileEntry&&)>& onFile) {
+		core::LibraryScanner::walk(musicDirs, logMessages, onFile);
+	};
+
+	// Alternate the walks, so that both see the same cache state.
+	WalkResult bestResults[2] = {};
+	for (int run = 0; run < runCount; ++run) {
+		WalkResult results[2] = { measureWalk(iteratorWalk), measureWalk(scannerWalk) };
+		for (int i = 0; i < 2; ++i) {
+			if (run == 0 || results[i].time < bestResults[i].time) {
+				bestResults[i] = results[i];
+			}
+		}
+		std::cout << "Run " << run + 1 << ": iterator " << results[0].time.asMilliseconds() << "ms (" << results[0].ioCount << " I/O operations), "
+			<< "scanner " << results[1].time.asMilliseconds() << "ms (" << results[1].ioCount << " I/O operations)" << std::endl;
+	}
+	for (auto& message : logMessages) {
+		std::cout << message;
+	}
+
+	const char* names[2] = { "recursive_directory_iterator", "LibraryScanner::walk" };
+	std::cout << "\nBest of " << runCount << " runs:\n";
+	for (int i = 0; i < 2; ++i) {
+		std::cout << names[i] << ": " << bestResults[i].fileCount << " files, " << bestResults[i].time.asMilliseconds() << "ms, "
+			<< bestResults[i].ioCount << " I/O operations" << std::endl;
+	}
+	if (bestResults[0].fileCount != bestResults[1].fileCount) {
+		std::cout << "Error: The walks found a different number of files!" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scan
+///////////////////////////////////////////////////////////////////////////////
+struct ScanResult
+{
+	std::string mode;
+	int         run;
+	size_t      fileCount;
+	size_t      failedCount;
+	size_t      cachedCount;
+	size_t      decodedCount;
+	double      walkSeconds;     //< without the time of the library phase, which runs in between
+	double      probeSeconds;
+	double      librarySeconds;
+	double      playlistSeconds;
+	double      indexSeconds;
+	double      totalSeconds;
+	double      filesPerSecond;  //< found files per total second
+	size_t      libraryBytes;    //< see MusicLibrary::getMemoryReport()
+	size_t      peakWorkingSet;  //< bytes; of the process, so it never decreases
+};
+
+/**
+ * Opening a file without buffering drops its cached data, as long as no other process has the file mapped. This needs
+ * no administrator rights, other than emptying the whole standby list.
+ */
+static void dropFileCache(const fs::path& rootPath)
+{
+	std::vector<std::string> logMessages;
+	core::LibraryScanner::walk({ rootPath }, logMessages, [](core::LibraryScanner::FileEntry&& fileEntry) {
+		HANDLE handle = CreateFileW(fileEntry.path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING, NULL);
+		if (handle != INVALID_HANDLE_VALUE) {
+			CloseHandle(handle);
+		}
+		return true;
+	});
+}
+
+static size_t getPeakWorkingSet()
+{
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize;
+}
+
+static ScanResult measureScan(const std::string& mode, int run, const fs::path& rootPath, const fs::path& indexPath, int threadCount)
+{
+	ScanResult result = {};
+	result.mode = mode;
+	result.run  = run;
+	if (mode == "cold") {
+		dropFileCache(rootPath);
+	}
+
+	core::Timer totalTimer;
+	core::MusicLibrary library;
+	if (mode == "indexed") {
+		auto index = std::make_unique<core::LibraryIndex>();
+		if (index->open(indexPath)) {
+			library.attach(std::move(index));
+		}
+		else {
+			std::cerr << "Warning: Library index '" << indexPath.u8string() << "' could not be opened, so everything is probed.\n";
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Walk, probe and library
+	///////////////////////////////////////////////////////////////////////////////
+	core::LibraryScanner scanner;
+	core::Time libraryTime = 0s;
+	size_t loggedCount = 0;
+	scanner.scan({ rootPath }, threadCount, library.getIndex(), [&](core::LibraryScanner::Batch&& batch) {
+		core::Timer libraryTimer;
+		for (auto& musicInfo : batch.musicInfoList) {
+			// Like MusicPlayer::applyScanBatches(): music of the index is only changed, if it has changed on disk.
+			int musicIndex = library.find(musicInfo.path);
+			if (musicIndex == -1) {
+				library.add(musicInfo);
+			}
+			else if (!library.equals(musicIndex, musicInfo)) {
+				library.set(musicIndex, musicInfo);
+			}
+		}
+		libraryTime += libraryTimer.getElapsedTime();
+		for (auto& message : batch.logMessages) {
+			if (loggedCount++ < 10) { // e.g. a real library with many broken files should not flood the output
+				std::cerr << message << "\n";
+			}
+		}
+	});
+	const core::LibraryScanner::Stats& stats = scanner.getStats();
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Playlist
+	///////////////////////////////////////////////////////////////////////////////
+	// The same work as the ALL playlist in MusicPlayer::init(), without the console.
+	core::Timer playlistTimer;
+	std::vector<int> musicIndexList;
+	std::vector<std::pair<std::string, std::string>> rows; //< title and duration
+	core::Time duration = 0s;
+	musicIndexList.reserve(library.getMusicCount());
+	rows.reserve(library.getMusicCount());
+	for (int musicIndex = 0; musicIndex < (int)library.size(); ++musicIndex) {
+		if (!library.isRemoved(musicIndex)) {
+			musicIndexList.push_back(musicIndex);
+			rows.push_back({ std::string(library.getTitle(musicIndex)), core::getTimeStr(library.getDuration(musicIndex)) });
+			duration += library.getDuration(musicIndex);
+		}
+	}
+	core::Time playlistTime = playlistTimer.getElapsedTime();
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Index
+	///////////////////////////////////////////////////////////////////////////////
+	// The index is written by every run (the player only writes it, if something has changed), so that the next indexed run can use it.
+	core::Timer indexTimer;
+	fs::path tempIndexPath = indexPath;
+	tempIndexPath += ".tmp";
+	if (!core::LibraryIndex::write(tempIndexPath, library, {}, true)) {
+		std::cerr << "Error: Library index '" << tempIndexPath.u8string() << "' could not be written.\n";
+	}
+	core::Time indexTime = indexTimer.getElapsedTime();
+	core::Time totalTime = totalTimer.getElapsedTime();
+
+	result.fileCount       = stats.fileCount;
+	result.failedCount     = stats.failedCount;
+	result.cachedCount     = stats.cachedCount;
+	result.decodedCount    = stats.decodedCount;
+	result.walkSeconds     = (double)(stats.walkTime.asSeconds() - libraryTime.asSeconds());
+	result.probeSeconds    = (double)stats.probeTime.asSeconds();
+	result.librarySeconds  = (double)libraryTime.asSeconds();
+	result.playlistSeconds = (double)playlistTime.asSeconds();
+	result.indexSeconds    = (double)indexTime.asSeconds();
+	result.totalSeconds    = (double)totalTime.asSeconds();
+	result.filesPerSecond  = result.totalSeconds > 0 ? result.fileCount / result.totalSeconds : 0;
+	result.libraryBytes    = library.getMemoryReport().bytes;
+	result.peakWorkingSet  = getPeakWorkingSet();
+
+	library.clear(); // unmaps the index, so that it can be replaced
+	std::error_code ec;
+	fs::rename(tempIndexPath, indexPath, ec);
+	return result;
+}
+
+static std::string toJsonStr(const std::string& str)
+{
+	std::string json = "\"";
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			json += '\\';
+		}
+		json += c;
+	}
+	return json + "\"";
+}
+
+static int runScanBenchmark(int argc, char* argv[])
+{
+	///////////////////////////////////////////////////////////////////////////////
+	// Options
+	///////////////////////////////////////////////////////////////////////////////
+	fs::path rootPath = "benchmark_music";
+	benchmark::LibraryOptions libraryOptions;
+	bool isRegenerated = false;
+	std::vector<std::string> modes = { "cold", "warm", "indexed" };
+	int runCount    = 3;
+	int threadCount = 0;
+	std::string outputFormat = "json";
+	fs::path outputPath;
+	for (int i = 2; i < argc; ++i) {
+		std::string option = argv[i];
+		std::string value  = i + 1 < argc ? argv[i + 1] : "";
+		bool isValid = true;
+		try {
+			if (option == "--regenerate")   { isRegenerated = true; continue; }
+			else if (option == "--dir")     rootPath = fs::u8path(value);
+			else if (option == "--depth")   libraryOptions.depth = std::stoi(value);
+			else if (option == "--fan-out") libraryOptions.fanOut = std::stoi(value);
+			else if (option == "--files")   libraryOptions.fileCount = std::stoi(value);
+			else if (option == "--formats") isValid = benchmark::parseFormats(value, libraryOptions.formats);
+			else if (option == "--runs")    runCount = std::stoi(value);
+			else if (option == "--threads") threadCount = std::stoi(value);
+			else if (option == "--output")  { outputFormat = value; isValid = value == "json" || value == "csv"; }
+			else if (option == "--out")     outputPath = fs::u8path(value);
+			else if (option == "--modes") {
+				std::stringstream ss(value);
+				modes.clear();
+				for (std::string mode; std::getline(ss, mode, ',');) {
+					isValid &= mode == "cold" || mode == "warm" || mode == "indexed";
+					modes.push_back(mode);
+				}
+			}
+			else {
+				isValid = false;
+			}
+		}
+		catch (const std::exception&) {
+			isValid = false;
+		}
+		if (!isValid || libraryOptions.depth < 0 || libraryOptions.fanOut < 1 || runCount < 1) {
+			std::cerr << "Error: Invalid option '" << option << " " << value << "'.\n";
+			return EXIT_FAILURE;
+		}
+		++i; // value
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Library
+	///////////////////////////////////////////////////////////////////////////////
+	if (isRegenerated || !fs::exists(rootPath)) {
+		fs::remove_all(rootPath);
+		std::cerr << "Generating " << libraryOptions.fileCount << " files (" << benchmark::getFormatsStr(libraryOptions.formats) << ") in '" << rootPath.u8string() << "'...\n";
+		core::Timer timer;
+		benchmark::generateLibrary(rootPath, libraryOptions);
+		std::cerr << "Generated in " << core::getTimeStr(timer.getElapsedTime()) << "\n";
+	}
+	rootPath = fs::absolute(rootPath);
+	fs::path indexPath = rootPath;
+	indexPath += ".index";
+	fs::remove(indexPath);
+
+	// SDL_mixer is only used for files which the TagReader can not read (not the case for generated libraries).
+	if (SDL_Init(SDL_INIT_AUDIO) < 0 || Mix_OpenAudio(MIX_DEFAULT_FREQUENCY, MIX_DEFAULT_FORMAT, 2, 2048) == -1) {
+		std::cerr << "Warning: Audio could not be initialized, so only files which the TagReader supports can be read. SDL Error: " << SDL_GetError() << "\n";
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Runs
+	///////////////////////////////////////////////////////////////////////////////
+	std::vector<ScanResult> results;
+	for (auto& mode : modes) {
+		if (mode == "indexed" && !fs::exists(indexPath)) {
+			measureScan("warm", 0, rootPath, indexPath, threadCount); // writes the index; not reported
+		}
+		for (int run = 1; run <= runCount; ++run) {
+			results.push_back(measureScan(mode, run, rootPath, indexPath, threadCount));
+			const ScanResult& result = results.back();
+			std::cerr << mode << " run " << run << ": " << result.fileCount << " files in " << result.totalSeconds << "s ("
+				<< (size_t)result.filesPerSecond << " files/s)\n";
+		}
+	}
+	Mix_CloseAudio();
+	SDL_Quit();
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Output
+	///////////////////////////////////////////////////////////////////////////////
+	std::ofstream ofs;
+	if (!outputPath.empty()) {
+		ofs.open(outputPath);
+	}
+	std::ostream& os = outputPath.empty() ? std::cout : ofs;
+	if (outputFormat == "csv") {
+		os << "mode,run,files,failed,cached,decoded,threads,walk_s,probe_s,library_s,playlist_s,index_s,total_s,files_per_s,library_bytes,peak_working_set_bytes\n";
+		for (auto& result : results) {
+			os << result.mode << "," << result.run << "," << result.fileCount << "," << result.failedCount << "," << result.cachedCount << ","
+				<< result.decodedCount << "," << (threadCount > 0 ? threadCount : (int)std::thread::hardware_concurrency()) << ","
+				<< result.walkSeconds << "," << result.probeSeconds << "," << result.librarySeconds << "," << result.playlistSeconds << ","
+				<< result.indexSeconds << "," << result.totalSeconds << "," << result.filesPerSecond << "," << result.libraryBytes << ","
+				<< result.peakWorkingSet << "\n";
+		}
+	}
+	else {
+		os << "{\n"
+			<< "  \"benchmark\": \"scan\",\n"
+			<< "  \"library\": { \"path\": " << toJsonStr(rootPath.u8string()) << ", \"depth\": " << libraryOptions.depth << ", \"fanOut\": " << libraryOptions.fanOut
+			<< ", \"formats\": " << toJsonStr(benchmark::getFormatsStr(libraryOptions.formats)) << " },\n"
+			<< "  \"threads\": " << (threadCount > 0 ? threadCount : (int)std::thread::hardware_concurrency()) << ",\n"
+			<< "  \"runs\": [\n";
+		for (size_t i = 0; i < results.size(); ++i) {
+			const ScanResult& result = results[i];
+			os << "    { \"mode\": " << toJsonStr(result.mode) << ", \"run\": " << result.run << ", \"files\": " << result.fileCount
+				<< ", \"failed\": " << result.failedCount << ", \"cached\": " << result.cachedCount << ", \"decoded\": " << result.decodedCount
+				<< ", \"walkSeconds\": " << result.walkSeconds << ", \"probeSeconds\": " << result.probeSeconds << ", \"librarySeconds\": " << result.librarySeconds
+				<< ", \"playlistSeconds\": " << result.playlistSeconds << ", \"indexSeconds\": " << result.indexSeconds << ", \"totalSeconds\": " << result.totalSeconds
+				<< ", \"filesPerSecond\": " << result.filesPerSecond << ", \"libraryBytes\": " << result.libraryBytes << ", \"peakWorkingSetBytes\": " << result.peakWorkingSet
+				<< " }" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+		os << "  ]\n}\n";
+	}
+	return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Main
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+	std::string command = argc > 1 ? argv[1] : "";
+	if (command == "walk") {
+		return runWalkBenchmark(argc, argv);
+	}
+	if (command == "scan") {
+		return runScanBenchmark(argc, argv);
+	}
+	std::cerr << "Usage:\n"
+		<< "  Benchmark walk [directory] [file count] [runs]\n"
+		<< "  Benchmark scan [--dir path] [--depth n] [--fan-out n] [--files n] [--formats mp3=4,flac=2,ogg=2,wav=1] [--regenerate]\n"
+		<< "                 [--modes cold,warm,indexed] [--runs n] [--threads n] [--output json|csv] [--out file]\n";
+	return EXIT_FAILURE;
+}
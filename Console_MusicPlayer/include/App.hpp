@@ -45,6 +45,11 @@ public:
 	DirectoryState        directoryState;
 
 	std::vector<fs::path> musicDirs;
+	int                   scanThreadCount; //< threads used to read the music metadata; 0 is one thread per core
+	unsigned int          shuffleSeed; //< 0 is a random seed
+	core::Time            crossfadeTime; //< 0 plays the music without crossfade (gapless)
+	core::AudioPlayer::FadeCurve crossfadeCurve;
+	bool                  isLatencyProbed; //< see config.properties::latencyProbe
 	fs::path              currPlaylist;
 	Style                 style;
 	bool                  isDrawKeyInfo;
@@ -24,6 +24,14 @@ public:
 		TrackSkipForward,
 		KeyInfo,
 		Select,
+		ShowQueue,
+		EnqueueNext,
+		EnqueueLast,
+		RemoveEntry,
+		MoveEntryUp,
+		MoveEntryDown,
+		ExportPlaylist,
+		RescanPlaylists,
 		
 		Count
 	};
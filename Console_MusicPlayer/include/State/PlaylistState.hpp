@@ -34,5 +34,7 @@ private:
 
     bool isTrappedOnTop();
     void scrollToTop();
+    /** Erases the rows of removed playlists and appends the new playlists, so the hover and the selection stay on their playlists. */
+    void updatePlaylistList();
     void onMessage(core::Message message);
 };
\ No newline at end of file
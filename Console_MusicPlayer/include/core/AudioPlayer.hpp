@@ -0,0 +1,212 @@
+#pragma once
+
+#include "Time.hpp"
+#include <SDL_mixer.h>
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	/**
+	 * Plays music with its own audio callback (Mix_SetPostMix()), which mixes the samples itself, so that the next music
+	 * starts at the sample after the current one ends (gapless).
+	 * - The current music is streamed: SDL_mixer decodes it with Mix_PlayMusic() one audio buffer at a time (before the
+	 *   post mix callback), and the audio callback moves these samples into a buffer of the music, which it mixes from.
+	 *   The decoding pauses when STREAM_BUFFER_COUNT buffers are ahead, so a streamed music needs only a few audio buffers
+	 *   of memory and starts when STREAM_START_COUNT buffers are decoded, regardless of its length. It ends at the position
+	 *   at which SDL_mixer finished it (Mix_GetMusicPosition()); with a codec which can not tell the position (e.g. MIDI),
+	 *   it ends with the silence till the end of that audio buffer.
+	 * - setNext() prefetches the music which follows the current one. A loader thread decodes it completely (Mix_LoadWAV(),
+	 *   in the format of the audio device), if it is not longer than MAX_DECODED_LENGTH (about 12 minutes with 44.1 kHz,
+	 *   16 bit, stereo or 6 minutes with float samples); a longer one is streamed, and SDL_mixer decodes it ahead while the
+	 *   current music is not streamed. Only the current, the next and the fading music are kept (see update()).
+	 *   If the next music is loaded in time, the audio callback starts it without gap; otherwise the current music ends and
+	 *   isStopped() becomes true, like with Mix_PlayMusic(). SDL_mixer decodes only one music at a time, so a streamed music
+	 *   is not crossfaded with a streamed next one, and the next one can only be decoded ahead by the buffers which the
+	 *   current one is decoded ahead. After a few streamed music in a row (or a replayed streamed music) the next one may
+	 *   start a few buffers late.
+	 * - With a float device (AUDIO_F32SYS) the music stays float from the decoder through volume and fades till SDL
+	 *   converts it for the hardware.
+	 * - The audio callback reports when a music starts or ends through pollEvent(), and getPosition() counts the samples it
+	 *   delivered to the device, so both are sample accurate and do not depend on the frame rate of the main thread.
+	 * - setCrossfade() overlaps the end of a music with the start of the next one. The audio callback applies the fade
+	 *   curve to each sample, so the fade is smooth and does not depend on the frame rate of the main thread (a stalled
+	 *   main thread only delays the prefetch).
+	 * - The audio callback only locks 'mutex' while it mixes the samples and controls the decoding; all other functions
+	 *   lock it only shortly and never while loading or freeing music.
+	 * Usage: init() after Mix_OpenAudio() with signed samples (their silence is 0); call update() and pollEvent() on the main thread (e.g. every frame).
+	 */
+	class AudioPlayer
+	{
+	public:
+		enum class FadeCurve
+		{
+			Linear,    //< the gain changes evenly, so the loudness dips in the middle of a crossfade
+			EqualPower //< sine gains, so the power of both music together stays the same
+		};
+
+		enum class Event
+		{
+			NextStarted, //< the next music became the current one (or the current one is replayed)
+			Ended        //< the current music ended without next music or failed to load
+		};
+
+		~AudioPlayer();
+		/** Hooks the audio callback into SDL_mixer (the audio device has to be opened) and starts the loader thread. */
+		void init();
+		void terminate();
+		/**
+		 * Stops the current music and plays the music file from the start, as soon as it is loaded. The current or the
+		 * prefetched next music is not loaded again.
+		 */
+		void play(const fs::path& musicFilePath);
+		/**
+		 * Prefetches the music file, which is played after the current one. The path of the current music replays it;
+		 * an empty path plays nothing afterwards. The next music is consumed, when it is started.
+		 */
+		void setNext(const fs::path& musicFilePath);
+		void stop();
+		void pause();
+		void resume();
+		/** Jumps to 'position' of the current music; the end of the music starts the next one. */
+		void seek(Time position);
+		/** 0..MIX_MAX_VOLUME (like Mix_VolumeMusic()), but not rounded, if the audio device uses float samples. */
+		void setVolume(float volume);
+		/**
+		 * The last 'duration' of each music is faded out, while the next music starts and is faded in; 0 disables it, so the
+		 * next music starts after the last sample (gapless). Must be called after init().
+		 * Music which is shorter than the crossfade is faded out over its whole length.
+		 */
+		void setCrossfade(Time duration, FadeCurve curve);
+		/**
+		 * Measures the latency of pause(), resume() and seek(): the time till the audio callback applies them plus the
+		 * duration of the buffer it fills, which is played after the buffer the device plays at the moment. update() logs it.
+		 */
+		void setLatencyProbe(bool isEnabled);
+		/**
+		 * The audio callback, which init() sets with Mix_SetPostMix(). Public, so that a test can mix into its own buffers
+		 * (e.g. with the dummy audio driver and the callback removed from SDL_mixer); 'userData' is the AudioPlayer.
+		 */
+		static void SDLCALL mix(void* userData, Uint8* stream, int length);
+		/** Frees the music which is not played anymore and logs the errors of the loader thread. Must be called on the main thread. */
+		void update();
+		/**
+		 * Returns false if there is no event. The events are in the order the audio callback reached them; play() and stop()
+		 * discard the events of the music before.
+		 */
+		bool pollEvent(Event& event);
+		/** Path of the current music, also while it is loading and after it ended; empty after stop(). */
+		const fs::path& getPath() const;
+		/** Position in the current music by the samples delivered to the audio device; 0 while it is loading. */
+		Time getPosition() const;
+		bool isPaused() const;
+		/** The current music ended (and there was no next one), failed to load or there is none. */
+		bool isStopped() const;
+		/** The next music is loaded (or there is none), so it starts without gap. */
+		bool isNextLoaded() const;
+	private:
+		struct Track
+		{
+			fs::path           path;
+			Mix_Chunk*         chunk;                     //< decoded completely; nullptr if the music is streamed
+			Mix_Music*         music;                     //< streamed by SDL_mixer; nullptr if it is decoded completely
+			Uint64             length            = 0;     //< in bytes; of streamed music by Mix_MusicDuration(), till it is decoded to the end
+			bool               isLengthKnown     = true;  //< false for streamed music without duration, which is not faded out
+			std::vector<Uint8> streamBuffer;              //< decoded samples of 'music', which are not mixed yet
+			Uint64             streamPosition    = 0;     //< in bytes of the music, of the first byte of 'streamBuffer'
+			bool               isStreamStarted   = false; //< SDL_mixer decodes 'music' from the end of 'streamBuffer'
+			bool               isStreamBuffering = true;  //< it is not mixed till STREAM_START_COUNT buffers are decoded (after its start or seek())
+			bool               isStreamEnded     = false; //< 'music' is decoded to the end, so 'length' is exact
+		};
+
+		static constexpr Uint64 MAX_DECODED_LENGTH  = 128 * 1024 * 1024; //< bytes; a longer next music is streamed
+		static constexpr Uint32 STREAM_START_COUNT  = 2; //< audio buffers which are decoded, before a streamed music is mixed
+		static constexpr Uint32 STREAM_BUFFER_COUNT = 3; //< audio buffers which are decoded ahead at most
+
+		// Audio device:
+		Uint16                  format     = 0;
+		int                     frameSize  = 0; //< bytes of one sample of all channels
+		int                     frequency  = 0;
+		bool                    isHooked   = false;
+		static std::atomic<bool> isMusicFinished;       //< set by Mix_HookMusicFinished(), which has no user data
+		// Shared with the audio callback and the loader thread (locked by 'mutex'):
+		mutable std::mutex      mutex;
+		std::vector<Track*>     tracks;                 //< all loaded music; freed by update(), when it is not 'current', 'next' or 'fading'
+		Track*                  current        = nullptr;
+		Track*                  next           = nullptr;
+		Uint64                  position       = 0;     //< in bytes of 'current'
+		Track*                  fading         = nullptr; //< previous music, which is faded out while 'current' is faded in
+		Uint64                  fadingPosition = 0;     //< in bytes of 'fading'
+		Uint64                  fadeInLength   = 0;     //< bytes at the start of 'current' which are faded in; 0 if it started without crossfade
+		Uint64                  crossfadeLength = 0;    //< bytes at the end of each music which are faded out; 0 is gapless
+		Track*                  streaming      = nullptr; //< music which SDL_mixer decodes at the moment
+		bool                    isStreamPaused = false; //< the decoding of 'streaming' is paused (Mix_PauseMusic()), because enough is decoded ahead
+		Uint32                  bufferLength   = 0;     //< bytes of the last audio buffer; to reserve the stream buffers
+		FadeCurve               fadeCurve      = FadeCurve::EqualPower;
+		bool                    isEnded        = false; //< 'current' was played till the end
+		bool                    isNextReplayed = false; //< the next music is 'current' again
+		bool                    isPaused_      = false;
+		int                     currentLoadID  = 0;     //< load request of 'current'; 0 if it is not loading
+		int                     nextLoadID     = 0;     //< load request of 'next'; 0 if it is not loading
+		fs::path                currentLoadPath;
+		fs::path                nextLoadPath;
+		int                     loadingID      = 0;     //< request which the loader thread decodes at the moment
+		int                     lastLoadID     = 0;
+		std::vector<std::string> logMessages;           //< log() is not thread safe
+		std::vector<Event>      events;                 //< reserved by init(), so that the audio callback usually does not allocate
+		bool                    isLatencyProbed = false;
+		const char*             probeAction    = nullptr; //< pause(), resume() or seek() which the audio callback did not apply yet
+		const char*             probedAction   = nullptr; //< applied, but not logged yet
+		std::chrono::steady_clock::time_point probeStartTime;
+		std::chrono::steady_clock::time_point probeMixTime;
+		Uint32                  probeBufferLength = 0; //< in bytes
+		std::atomic<float>      volume         = MIX_MAX_VOLUME;
+		// Loader thread:
+		std::thread             loaderThread;
+		std::atomic<bool>       isRunning      = false;
+		std::condition_variable condition;
+		// Main thread only:
+		fs::path                currentPath;
+		fs::path                nextPath;
+
+		/** Requires 'mutex'. */
+		void mixLocked(Uint8* stream, int length);
+		/** Requires 'mutex'. Makes the next music the current one (or replays it) and sends Event::NextStarted. */
+		void startNext();
+		/** Requires 'mutex'. Adds 'length' bytes of 'track' from 'position' to 'stream', with the volume and the fade gain of each sample. */
+		void mixTrack(Uint8* stream, const Track* track, Uint64 position, Uint32 length, Uint64 fadeInLength, float volume) const;
+		/** Requires 'mutex'. Returns the fade gain 0..1 of the sample at 'position' (in bytes) of 'track'. */
+		float getFadeGain(const Track* track, Uint64 position, Uint64 fadeInLength) const;
+		/** Requires 'mutex'. Starts a latency measurement of 'action', if the latency probe is enabled. */
+		void startLatencyProbe(const char* action);
+		/** Requires 'mutex'. Bytes at the end of 'track' which are faded out. */
+		Uint64 getFadeOutLength(const Track* track) const;
+		/** Requires 'mutex'. Samples of 'track' at 'position'; of streamed music only the decoded ones (see getDecodedLength()). */
+		const Uint8* getSamples(const Track* track, Uint64 position) const;
+		/** Requires 'mutex'. Bytes from 'position' which can be mixed; less than the rest of a streamed music, if it is not decoded yet. */
+		Uint64 getDecodedLength(const Track* track, Uint64 position) const;
+		/** Requires 'mutex'. The end of 'track' is reached; streamed music has to be decoded to the end. */
+		bool isTrackEnded(const Track* track, Uint64 position) const;
+		/** Requires 'mutex'. Moves the samples which SDL_mixer decoded into 'stream' to the buffer of 'streaming'. */
+		void receiveStream(const Uint8* stream, Uint32 length);
+		/**
+		 * Requires 'mutex'. Starts, pauses and stops the decoding of SDL_mixer for the next audio buffer, so that the played
+		 * streamed music (or else the next one) is decoded ahead.
+		 */
+		void controlStream();
+		/** Requires 'mutex'. Discards the decoded samples of streamed 'track', so that it is decoded again from 'position'. */
+		void restartStream(Track* track, Uint64 position);
+		/** Requires 'mutex'. Discards the decoded samples of streamed 'track' before 'position', which are mixed. */
+		void discardStream(Track* track, Uint64 position);
+		static void SDLCALL onMusicFinished();
+		static void freeTrack(Track* track);
+		void runLoader();
+	};
+}
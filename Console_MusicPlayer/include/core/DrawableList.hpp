@@ -12,6 +12,20 @@ namespace core
 	public:
 		using Row = std::vector<std::string>; //< list of columns
 
+		/**
+		 * Supplies the rows of a list, which does not store them itself (see setRowProvider()). Only the drawn rows are
+		 * requested, so the rows can be formatted on demand and a large list costs no more to draw than a small one.
+		 */
+		class RowProvider
+		{
+		public:
+			virtual ~RowProvider() = default;
+			virtual size_t size() const = 0;
+			virtual Row getRow(size_t index) const = 0;
+			/** Length of the largest item in the column (for Column::LARGEST_ITEM). By default all rows are requested; override this for large lists. */
+			virtual int getMaxLength(size_t columnIndex) const;
+		};
+
 		enum Options
 		{
 			None              = 0,
@@ -75,7 +89,24 @@ namespace core
 		void selectHoveredItem();
 		void clear();
 		void push_back(Row item);
+		/** Selection and hover stay on the same items. */
+		void erase(size_t index);
+		/** Replaces the row at 'index'. */
+		void set(size_t index, Row item);
+		/**
+		 * The list draws the rows of 'rowProvider' instead of its own rows, which are cleared; nullptr uses its own rows again.
+		 * The provider has to outlive the list. Tell the list about changed rows with onRowsChanged() and onRowErased().
+		 */
+		void setRowProvider(const RowProvider* rowProvider);
+		/** Call this after rows of the RowProvider were added or changed. */
+		void onRowsChanged();
+		/** Call this after the RowProvider removed the row at 'index'. Selection and hover stay on the same items. */
+		void onRowErased(size_t index);
+		/** Call this after the RowProvider moved the row at 'from' to 'to'. Selection and hover stay on the same items. */
+		void onRowMoved(size_t from, size_t to);
 		void onConsoleResize();
+		/** Name is displayed on the top. */
+		void setName(std::string name);
 		/** No event handling and no update(). draw() is active, but selection will be ignored. Resets isTrapped flags. */
 		void loseFocus();
 		void gainFocus();
@@ -86,6 +117,7 @@ namespace core
 		Row getSelected() const;
 		size_t getHoverIndex() const;
 		Row getHover() const;
+		/** Only for lists without RowProvider. */
 		const std::vector<Row>& get() const;
 		/** return length of the drawn box in character column count. Note that this ignores the tab and Scrollbar - its just the border. */
 		int getDrawSize() const;
@@ -97,6 +129,7 @@ namespace core
 		bool hasFocus() const;
 	private:
 		std::vector<Row>         list;
+		const RowProvider*       rowProvider = nullptr; //< if set, it is used instead of 'list'
 		size_t                   selected; //< item index which is "selected"
 		size_t                   hover; //< item index over which you "hover"
 		Vec2                     sizeInside; //< size inside the list (without border, scrollbar, ..) as column character count * row count.
@@ -112,7 +145,9 @@ namespace core
 		std::vector<Column>      columnLayout;
 		int                      paddingX; //< Space between border and column (padding on x axis); Style!?
 		bool                     isFirstDraw; //< optional, but save
+		bool                     isLayoutOutdated; //< rows changed, so LARGEST_ITEM columns are recalculated in the next draw()
 
+		Row getRow(size_t index) const;
 		void move(bool up);
 		void drawBorder(bool isTop) const;
 		int getItemNumberDrawSize() const;
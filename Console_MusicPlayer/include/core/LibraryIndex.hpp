@@ -0,0 +1,97 @@
+#pragma once
+
+#include "MusicInfo.hpp"
+#include "Time.hpp"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	class MusicLibrary;
+
+	/**
+	 * Binary file with all music of the library, which is memory mapped and used in place. Opening it costs the same
+	 * for 10 or 100.000 tracks: nothing is parsed or allocated, the data is read when it is accessed (see MusicLibrary).
+	 * It contains:
+	 * - tracks:      fixed size records (duration, file size and write time, title, path, artist and album)
+	 * - strings:     utf-8 strings of all tracks; artists and albums are interned
+	 * - directories: the tracks of each directory (for renamed or removed directories)
+	 * - playlists:   the resolved music indices of each playlist file, which are valid as long as the playlist file is unchanged
+	 * - path table:  open addressing hash table to find tracks by path
+	 * A music index of the library is the track index in the file, so the file is written in library order. Removed music
+	 * is only flagged, unless the file is written compacted.
+	 * Strings and ids are checked when they are accessed, so a corrupted file can not crash the player; it just shows wrong data.
+	 */
+	class LibraryIndex
+	{
+	public:
+		struct Directory
+		{
+			std::string_view path;       //< utf-8
+			const uint32_t*  musicIndices;
+			size_t           musicCount;
+		};
+
+		struct Playlist
+		{
+			std::string      name;
+			uintmax_t        fileSize;
+			long long        lastWriteTime; //< fs::file_time_type ticks
+			std::vector<int> musicIndexList;
+		};
+
+		LibraryIndex() = default;
+		LibraryIndex(const LibraryIndex&) = delete;
+		LibraryIndex& operator=(const LibraryIndex&) = delete;
+		~LibraryIndex();
+
+		/** Returns false if the file does not exist, is outdated or corrupted. Only the header is checked. */
+		bool open(const fs::path& filePath);
+		void close();
+		/**
+		 * Writes all music of the library and the playlists. With 'isCompacted' removed music is dropped, so the music
+		 * indices change; the file can not be attached to 'library' anymore.
+		 * The file is written directly - write to a temporary file and rename it, to replace an index atomically.
+		 */
+		static bool write(const fs::path& filePath, const MusicLibrary& library, const std::vector<Playlist>& playlists, bool isCompacted);
+
+		size_t size() const;
+		size_t getRemovedCount() const;
+		size_t getFileSize() const;
+		/** Returns -1 if the path is unknown. Removed music can be found. */
+		int find(std::string_view path) const;
+		bool isRemoved(int musicIndex) const;
+		std::string_view getTitle(int musicIndex) const;
+		std::string_view getArtist(int musicIndex) const;
+		std::string_view getAlbum(int musicIndex) const;
+		std::string_view getPath(int musicIndex) const;
+		Time getDuration(int musicIndex) const;
+		uintmax_t getMusicFileSize(int musicIndex) const;
+		long long getLastWriteTime(int musicIndex) const;
+		MusicInfo getMusicInfo(int musicIndex) const;
+		size_t getDirectoryCount() const;
+		Directory getDirectory(size_t directoryIndex) const;
+		/** Returns false if the playlist is unknown, or its file has changed since the index was written. */
+		bool findPlaylist(const std::string& name, uintmax_t fileSize, long long lastWriteTime, std::vector<int>& musicIndexList) const;
+	private:
+		struct Header;
+		struct Track;
+		struct StringRef;
+		struct DirectoryRecord;
+		struct PlaylistRecord;
+
+		void*         mappingHandle = nullptr;
+		const char*   data          = nullptr;
+		size_t        dataSize      = 0;
+		const Header* header        = nullptr;
+
+		const Track& getTrack(int musicIndex) const;
+		std::string_view getString(const StringRef& stringRef) const;
+		std::string_view getInternedString(uint32_t id) const;
+		template <typename T>
+		const T* getSection(uint64_t offset) const;
+	};
+}
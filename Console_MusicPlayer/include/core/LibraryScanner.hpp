@@ -0,0 +1,83 @@
+#pragma once
+
+#include "MusicInfo.hpp"
+#include "LibraryIndex.hpp"
+#include "Time.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	/**
+	 * Searches the music directories for audio files and reads their metadata.
+	 * Scanning is split into two phases, which alternate in batches:
+	 * - walk: All music directories are iterated on the calling thread and every supported audio file is collected.
+	 * - probe: The metadata of the collected files is read on a pool of worker threads (one per core by default).
+	 * The result is always in walk order, so it does not depend on the thread count or on which worker finished first.
+	 * scan() can run on a background thread: the batches are delivered through a callback and nothing is logged directly.
+	 * If a LibraryIndex is passed, then only new or changed files are probed. The index is only read, so it can be used by other threads at the same time.
+	 */
+	class LibraryScanner
+	{
+	public:
+		struct Stats
+		{
+			size_t fileCount;      //< audio files found while walking
+			size_t failedCount;    //< audio files which could not be opened
+			size_t cachedCount;    //< audio files whose metadata was taken from the index
+			size_t decodedCount;   //< audio files which had to be opened by SDL_mixer, because their headers could not be read
+			int    threadCount;    //< worker threads used for probing
+			Time   walkTime;
+			Time   probeTime;
+			float  filesPerSecond; //< found files per second (walk and probe)
+		};
+
+		struct Batch
+		{
+			std::vector<MusicInfo>   musicInfoList;
+			std::vector<std::string> logMessages; //< log() is not thread safe, so the receiver has to log them
+		};
+		using BatchCallback = std::function<void(Batch&&)>;
+
+		struct FileEntry
+		{
+			fs::path  path;
+			uintmax_t fileSize;
+			long long lastWriteTime; //< fs::file_time_type ticks
+		};
+
+		struct ProbeResult
+		{
+			MusicInfo   musicInfo;
+			std::string error;     //< empty if the file could be read
+			bool        isDecoded; //< the file had to be opened with SDL_mixer
+		};
+
+		/** Reads the metadata of a single music file. This is thread safe. File size and write time are not set. */
+		static ProbeResult probe(const fs::path& musicFilePath);
+		/**
+		 * Finds all supported audio files in the music directories (incl. subdirectories). Size and write time are taken from the
+		 * directory listing, so no file is opened. Directory links are followed, but every physical directory and file is only
+		 * found once (duplicates are logged). Stops walking if 'onFile' returns false.
+		 */
+		static void walk(const std::vector<fs::path>& musicDirs, std::vector<std::string>& logMessages, const std::function<bool(FileEntry&&)>& onFile);
+
+		/** threadCount <= 0 uses one thread per hardware core. 'index' is optional. Blocks till everything is scanned. */
+		std::vector<MusicInfo> scan(const std::vector<fs::path>& musicDirs, int threadCount = 0, const LibraryIndex* index = nullptr);
+		/**
+		 * Calls 'onBatch' on the calling thread whenever a batch of files is read. The last batch is always delivered
+		 * (it contains the stats message), even if it is empty.
+		 */
+		void scan(const std::vector<fs::path>& musicDirs, int threadCount, const LibraryIndex* index, const BatchCallback& onBatch);
+		/** Thread safe; scan() returns after the current batch. */
+		void cancel();
+		const Stats& getStats() const;
+	private:
+		Stats             stats;
+		std::atomic<bool> isCanceled = false;
+	};
+}
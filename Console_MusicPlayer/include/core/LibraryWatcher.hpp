@@ -0,0 +1,62 @@
+#pragma once
+
+#include "MusicInfo.hpp"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	/**
+	 * Watches the music directories (incl. all subdirectories) for added, removed, renamed and changed audio files.
+	 * The file system events are received on a background thread (ReadDirectoryChangesW). New and changed files are
+	 * read there too (see LibraryScanner::probe), so that applying a change on the main thread is cheap.
+	 * Usage:
+	 * - start() the watcher after the library is scanned.
+	 * - pollChanges() on the main thread (e.g. every frame) and apply them to the library.
+	 * - stop() it before the application terminates (the destructor does this too).
+	 */
+	class LibraryWatcher
+	{
+	public:
+		struct Change
+		{
+			enum class Type
+			{
+				Added,   //< new or changed audio file; 'musicInfo' is set
+				Removed, //< audio file or directory
+				Renamed, //< audio file or directory; 'oldPath' is set
+				Rescan   //< too many events at once, some are lost; all files in the directory 'path' are added again, but removed files have to be checked
+			};
+
+			Type      type;
+			fs::path  path;
+			fs::path  oldPath;
+			MusicInfo musicInfo;
+		};
+
+		~LibraryWatcher();
+		void start(const std::vector<fs::path>& musicDirs);
+		void stop();
+		/** Returns all changes since the last call in the order they happened. Must be called on the main thread, because it also logs the watcher errors. */
+		std::vector<Change> pollChanges();
+	private:
+		std::thread              thread;
+		std::atomic<bool>        isRunning = false;
+		std::mutex               mutex; //< locks 'changes' and 'logMessages'
+		std::vector<Change>      changes;
+		std::vector<std::string> logMessages; //< log() is not thread safe
+
+		void run(std::vector<fs::path> musicDirs);
+		void push(Change change);
+		void pushLog(std::string message);
+		/** Reads the file and pushes it as added; does nothing if the file can not be read. */
+		void pushAdded(const fs::path& musicFilePath);
+		/** Pushes all audio files in the directory as added. */
+		void pushAddedDirectory(const fs::path& dirPath);
+	};
+}
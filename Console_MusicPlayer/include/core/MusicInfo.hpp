@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Time.hpp"
+#include <string>
+#include <filesystem>
+
+namespace core
+{
+	/** Metadata of an music file. */
+	struct MusicInfo
+	{
+		std::filesystem::path path;
+		std::string           title;
+		std::string           artist;
+		std::string           album;
+		Time                  duration;
+		uintmax_t             fileSize      = 0; //< is compared with the file, to find changed music (see LibraryIndex)
+		long long             lastWriteTime = 0; //< fs::file_time_type ticks
+	};
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "MusicInfo.hpp"
+#include "LibraryIndex.hpp"
+#include "Time.hpp"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <memory>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	/**
+	 * Stores the metadata of all music as struct of arrays, which needs much less memory than a MusicInfo per music
+	 * and is faster to iterate (e.g. summing up durations only touches the durations).
+	 * - Titles and paths are stored in one string arena (utf-8); the music only stores offset and length.
+	 * - Artists and albums are interned: each distinct value (e.g. "unknown") is stored once and the music stores its id.
+	 * - A music index stays valid forever. Removed music keeps its data, but can not be found anymore.
+	 * Changing music with set() appends the new strings to the arena; the old strings are not reused.
+	 * With attach() the library starts with the music of a LibraryIndex, which is read in place from the mapped file.
+	 * Only music which is added or changed afterwards is stored in the library itself.
+	 */
+	class MusicLibrary
+	{
+	public:
+		struct MemoryReport
+		{
+			size_t musicCount;
+			size_t bytes;          //< heap and object size of this library (without the index)
+			size_t mappedBytes;    //< size of the attached index
+			size_t musicInfoBytes; //< heap and object size if the same music was stored as std::vector<MusicInfo>
+		};
+
+		/** Replaces all music by the music of the index. */
+		void attach(std::unique_ptr<LibraryIndex> index);
+		/** Returns nullptr if no index is attached. */
+		const LibraryIndex* getIndex() const;
+		/** Music was added, changed or removed since the index was attached. */
+		bool isModified() const;
+
+		/** Returns the new music index. */
+		int add(const MusicInfo& musicInfo);
+		void set(int musicIndex, const MusicInfo& musicInfo);
+		void remove(int musicIndex);
+		void clear();
+		void reserve(size_t musicCount);
+		/** Returns -1 if the music is unknown or removed. */
+		int find(const fs::path& musicFilePath) const;
+		/** Returns all music (which is not removed) inside the directory and its subdirectories. */
+		std::vector<int> findInDirectory(const fs::path& dirPath) const;
+		/**
+		 * Returns all music (which is not removed) with the filename (utf-8, case sensitive) in library order; usually one.
+		 * The first call builds a hash table of all filenames, which is updated afterwards, so each call is O(1).
+		 * After buildFilenameIndex() it only reads, so it can be called from several threads.
+		 */
+		std::vector<int> findByFilename(std::string_view filename) const;
+		/** Does nothing if the hash table for findByFilename() is already built. */
+		void buildFilenameIndex() const;
+		/** Returns true if all metadata (incl. file size and write time) is the same. */
+		bool equals(int musicIndex, const MusicInfo& musicInfo) const;
+
+		MusicInfo get(int musicIndex) const;
+		std::string_view getTitle(int musicIndex) const;
+		std::string_view getArtist(int musicIndex) const;
+		std::string_view getAlbum(int musicIndex) const;
+		Time getDuration(int musicIndex) const;
+		fs::path getPath(int musicIndex) const;
+		/** utf-8 */
+		std::string_view getPathStr(int musicIndex) const;
+		uintmax_t getFileSize(int musicIndex) const;
+		long long getLastWriteTime(int musicIndex) const;
+		bool isRemoved(int musicIndex) const;
+		/** Count of all music indices (incl. removed music). */
+		size_t size() const;
+		/** Count of music which is not removed. */
+		size_t getMusicCount() const;
+		MemoryReport getMemoryReport() const;
+	private:
+		struct StringRef
+		{
+			uint32_t offset;
+			uint32_t length;
+		};
+
+		/** Music of the index, which was changed by set(). */
+		struct ChangedMusic
+		{
+			std::string path; //< utf-8
+			std::string title;
+			uint32_t    artistId;
+			uint32_t    albumId;
+			long long   duration; //< nanoseconds
+			uintmax_t   fileSize;
+			long long   lastWriteTime;
+		};
+
+		std::unique_ptr<LibraryIndex>         index;        //< contains the music indices [0, indexSize)
+		size_t                                indexSize = 0;
+		std::unordered_map<int, ChangedMusic> changedMusic; //< key: music index < indexSize
+
+		// Music which was added after the index; music index is 'indexSize' + column index:
+		std::vector<long long>  durations;      //< nanoseconds
+		std::vector<uintmax_t>  fileSizes;
+		std::vector<long long>  lastWriteTimes;
+		std::vector<StringRef>  titles;
+		std::vector<StringRef>  paths;          //< utf-8
+		std::vector<uint32_t>   artistIds;      //< index in 'internedStrings'
+		std::vector<uint32_t>   albumIds;       //< index in 'internedStrings'
+
+		std::vector<bool>       removedFlags;   //< grows on the first remove(); removed music of the index is flagged in the index
+		size_t                  removedCount = 0;
+		bool                    isModified_ = false;
+		std::string             arena;          //< titles and paths
+		std::vector<std::string>                  internedStrings;   //< few distinct values, so storing them twice is cheap
+		std::unordered_map<std::string, uint32_t> internedStringIds; //< value: index in 'internedStrings'
+		std::unordered_multimap<size_t, int>      pathIndices;       //< key: hash of the utf-8 path; only music which is not removed and not found through the index
+		mutable std::unordered_multimap<size_t, int> filenameIndices; //< key: hash of the utf-8 filename; only music which is not removed
+		mutable bool                              isFilenameIndexBuilt = false; //< 'filenameIndices' is built by the first findByFilename()
+
+		const ChangedMusic* findChanged(int musicIndex) const;
+		void erasePathIndex(int musicIndex);
+		void eraseFilenameIndex(int musicIndex);
+		StringRef addString(std::string_view str);
+		std::string_view getString(StringRef stringRef) const;
+		uint32_t internString(const std::string& str);
+		static size_t hashPath(std::string_view path);
+		static std::string_view getFilename(std::string_view path);
+	};
+}
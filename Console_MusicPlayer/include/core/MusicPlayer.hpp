@@ -2,11 +2,25 @@
 
 #include "Timer.hpp"
 #include "DrawableList.hpp"
+#include "MusicInfo.hpp"
+#include "MusicLibrary.hpp"
+#include "LibraryWatcher.hpp"
+#include "LibraryScanner.hpp"
+#include "LibraryIndex.hpp"
+#include "PlaylistRegistry.hpp"
+#include "PlaytimeIndex.hpp"
+#include "PlayOrder.hpp"
+#include "PlayQueue.hpp"
+#include "PlaylistWriter.hpp"
+#include "AudioPlayer.hpp"
 #include <SDL.h>
 #include <SDL_mixer.h>
 #include <string>
 #include <filesystem>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
 namespace fs = std::filesystem;
 class App;
 
@@ -15,14 +29,32 @@ namespace core
 	/**
 	 * Music player has playlists and plays them.
 	 * Usage:
-	 * - First you have to call MusicPlayer::init(). This loads all music sets everything up.
+	 * - First you have to call MusicPlayer::init(). This loads all music sets everything up. With Options::ProgressiveLoad init() returns immediately and
+	 *   the music is scanned on a background thread; update() appends it in batches to the ALL_PLAYLIST_NAME playlist, which can already be played.
+	 *   Other playlists are filled after the scan is finished.
 	 * - Afterwards you can add playlists with MusicPlayer::addPlaylist(). Note there is a default playlist called ALL_PLAYLIST_NAME which contains all found tracks.
+	 *   Playlists can also be added or removed (removePlaylist()) while another playlist is playing.
 	 *   The playlist file contains in each line a music filename (helloWorld.mp3) which is searched for in all directories specified in 'musicDirPaths'.
 	 * - To run a playlist use playPlaylist(name). The playlist name is the filename without its extention - its stem name. Or just use Options::AutoStart
 	 *   to automatically start the ALL_PLAYLIST_NAME playlist when initializing.
+	 * - While a music plays, the next one (of the queue or the play order) is decoded in the background and started without gap or
+	 *   crossfaded (see AudioPlayer).
 	 * - By default the ALL_PLAYLIST_NAME playlist is drawn. To draw something else use MusicPlayer::setDrawnPlaylist(). This is not done automatically, because
 	 *   a playlist can be played, while the user looks at a different playlist.
 	 * - MusicPlayer can even handle events. TODO: Select events and its key bindings.
+	 * - The hovered track of the drawn playlist can be enqueued (Keymap::Action::EnqueueNext and EnqueueLast). Queued music is
+	 *   played before the active playlist continues. The queue is drawn instead of the drawn playlist with Keymap::Action::ShowQueue,
+	 *   where its entries can be removed and moved. "Previous" goes back through the music which was really played (see PlayQueue).
+	 * - Playlists can be created and edited (createPlaylist(), addTrack(), removeTrack() and moveTrack(); the tracks of the drawn
+	 *   playlist can also be removed and moved with Keymap::Action::RemoveEntry, MoveEntryUp and MoveEntryDown). The playlist
+	 *   files are written in the background by a PlaylistWriter.
+	 * - Playlists of other tools (M3U/M3U8 and PLS) in "data/" are imported by the App (see importPlaylistFile()); the drawn playlist
+	 *   is exported to "data/export/" with Keymap::Action::ExportPlaylist (see exportPlaylist()).
+	 * - The music directories are watched, so added, removed and renamed music files are applied to the library and all playlists while running.
+	 *   Removed music stays in 'library' (so that all music indices stay valid), but is removed from all playlists. A playing music is
+	 *   removed after it was played.
+	 * - The library is stored in a LibraryIndex ("data/library.index"), which is mapped on the next start. Then all music and unchanged
+	 *   playlists are available immediately; the scan only updates the music which has changed since then.
 	 */
 	class MusicPlayer
 	{
@@ -33,8 +65,10 @@ namespace core
 			Shuffle   = 1 << 0,
 			LoopAll   = 1 << 1,
 			LoopOne   = 1 << 2,
-			FadeOut   = 1 << 3,
-			AutoStart = 1 << 4
+			FadeOut   = 1 << 3,  //< crossfades to the next music (App::crossfadeTime, App::crossfadeCurve)
+			AutoStart = 1 << 4,
+			ProgressiveLoad = 1 << 5,
+			SeparateArtists = 1 << 6  //< shuffle() avoids playing the same artist twice in a row
 		};
 
 		enum class Replay
@@ -45,14 +79,8 @@ namespace core
 			Count = 3
 		};
 
-		struct MusicInfo
-		{
-			std::filesystem::path path;
-			std::string           title;
-			std::string           artist;
-			std::string           album;
-			Time                  duration;
-		};
+		using MusicInfo = core::MusicInfo;
+		using Playlist  = core::Playlist;
 
 		struct Report
 		{
@@ -66,6 +94,34 @@ namespace core
 		void terminate();
 		/** Does nothing if playlist is already added. */
 		void addPlaylist(fs::path playlistFilePath);
+		/** Like addPlaylist(), but the playlist files are read and resolved in parallel and then added at once. */
+		void addPlaylists(const std::vector<fs::path>& playlistFilePaths);
+		/**
+		 * Removes the playlist; stops it first, if it is playing. ALL_PLAYLIST_NAME can not be removed.
+		 * Returns false if there is no such playlist.
+		 */
+		bool removePlaylist(const std::string& playlistName);
+		/**
+		 * Imports the playlists of other tools in "data/" (see importPlaylistFile()), adds the new playlist files and removes the
+		 * playlists whose file was deleted. Adding and removing playlists sends Message::PLAYLISTS_CHANGED.
+		 */
+		void scanPlaylists();
+		/** Creates an empty playlist "data/<playlistName>" (incl. the extension ".pl"). Returns false if the playlist or its file already exists. */
+		bool createPlaylist(const std::string& playlistName);
+		/**
+		 * Adds the music file to the playlist in front of the track at 'position' (-1 appends it). Positions are the drawn rows of
+		 * the playlist. Returns false if the music is not in the library or the playlist already contains it or can not be edited.
+		 */
+		bool addTrack(const std::string& playlistName, const fs::path& musicFilePath, int position = -1);
+		/** Removes the track at 'position' from the playlist (and its file). */
+		bool removeTrack(const std::string& playlistName, int position);
+		/** Moves the track at 'position' so that it is at 'newPosition' afterwards. */
+		bool moveTrack(const std::string& playlistName, int position, int newPosition);
+		/**
+		 * Writes the playlist as M3U/M3U8 or PLS file (by the extension of 'filePath') with the titles and durations of its music.
+		 * Music inside the directory of the file is written relative to it, other music absolute. Returns false if it can not be written.
+		 */
+		bool exportPlaylist(const std::string& playlistName, const fs::path& filePath) const;
 		void update();
 		void handleEvents();
 		void draw();
@@ -84,17 +140,27 @@ namespace core
 		void resumeDrawableListEvents();
 		void scrollDrawableListToTop();
 
-		/** playlistName can be emptry to display nothing. */
+		/** playlistName can be emptry to display nothing. Hides the play queue. */
 		void setDrawnPlaylist(std::string playlistName = "");
+		/** The play queue is drawn instead of the drawn playlist (if there is one). */
+		void setPlayQueueShown(bool isShown);
+		bool isPlayQueueShown() const;
 		void setVolume(float volume);
 		/** Music may also be paused. */
-		const MusicInfo& getPlayingMusicInfo() const;
+		MusicInfo getPlayingMusicInfo() const;
+		/** Position in the playing music by the samples played (see AudioPlayer::getPosition()). */
 		const Time getPlayingMusicElapsedTime() const;
 		std::string getActivePlaylistName() const;
+		/** All playlists except ALL_PLAYLIST_NAME in the order they were added. */
+		std::vector<std::string> getPlaylistNames() const;
 		int getActivePlaylistSize() const;
 		int getActivePlaylistCurrentTrackNumber() const;
 		Time getActivePlaylistDuration() const;
 		Time getActivePlaylistPlaytime() const;
+		/** Playtime till the end of the active playlist (in play order). */
+		Time getActivePlaylistRemainingTime() const;
+		/** Time till the track with this number (1..getActivePlaylistSize(), see getActivePlaylistCurrentTrackNumber()) starts; 0 if it was already played. */
+		Time getTimeUntilTrack(int trackNumber) const;
 		float getVolume() const;
 		Replay getReplayStatus() const;
 		Time getPlaytime() const;
@@ -106,31 +172,47 @@ namespace core
 		bool empty() const;
 		bool isShuffled() const;
 		bool isTrappedOnTop() const;
+		/** The music directories are scanned in the background (see Options::ProgressiveLoad). */
+		bool isScanning() const;
 	private:
-		struct Playlist
-		{
-			std::string      name;
-			std::vector<int> musicIndexList; //< music index from musicInfoList
-			DrawableList     drawableList; //< is in the order of the currently playing playlist; Is in 'Playlist', so that unactive playlists can be drawn.
-			Time             duration;
-			Time             oldTracksPlaytime; //< playtime of all tracks till now; add getPlayingMusicElapsedTime() to get the playtime; max is 'duration'
-		};
-
 		App*                           app;
-		Mix_Music*                     music; // currently playing music
-		std::vector<MusicInfo>         musicInfoList; //< contains all found music files.
-		std::vector<Playlist>          playlists;
+		AudioPlayer                    audioPlayer; //< plays the current music and prefetches the next one
+		int                            prefetchedMusicIndex; //< music index from 'library' of the next music of 'audioPlayer'; -1 if there is none
+		bool                           isNextStarted; //< 'audioPlayer' already plays the next music, so play() only updates the state
+		MusicLibrary                   library; //< contains all found music files.
+		LibraryWatcher                 libraryWatcher;
+		std::vector<int>               deferredMusicIndices; //< music which has to be removed from the active playlist, but is still playing
+		LibraryScanner                 libraryScanner;
+		std::thread                    scanThread;
+		std::atomic<bool>              isScanThreadRunning;
+		bool                           isScanning_; //< till all batches are applied
+		bool                           isLibraryIncomplete; //< the scan started without library index, so the playlists are resolved after the scan
+		bool                           isLibraryIndexOutdated; //< a playlist was resolved, which is not in the library index
+		std::vector<bool>              scannedMusic; //< music which was found by the running scan; the rest is removed after the scan
+		std::mutex                     scanMutex; //< locks 'scanBatches'
+		std::vector<LibraryScanner::Batch> scanBatches; //< scanned, but not yet applied music
+		bool                           isAutoStartPending; //< Options::AutoStart waits for the first music
+		PlaylistRegistry               playlists; //< the playlists are never moved, so the pointers below stay valid until the playlist is removed
+		PlaylistWriter                 playlistWriter; //< writes the edits of the playlists
 		Playlist*                      activePlaylist; //< currently active playlist
 		Playlist*                      drawnPlaylist; //< playlist which is drawn.
-		std::vector<int>               playingOrder; //< specifies the playing order from the "music" in Playlist::musicIndexList; 0..musicIndexList.size()
+		PlayOrder                      playingOrder; //< specifies the playing order from the "music" in Playlist::musicIndexList; 0..musicIndexList.size()
+		PlaytimeIndex                  playingOrderPlaytime; //< durations of the music in 'playingOrder' (same order)
+		bool                           isPlayingOrderDeferred; //< insertIntoPlaylist() collects the music appended to the active playlist in 'deferredOrderPositions' (see applyScanBatches())
+		std::vector<int>               deferredOrderPositions; //< positions in the active playlist, which are not yet in 'playingOrder'
 		int                            playingOrder_currentIndex; // index of current music in playingOrder
-		core::Timer                    trackPlaytime;
+		PlayQueue                      playQueue; //< is played before 'playingOrder' continues
+		PlayQueueRows                  playQueueRows;
+		DrawableList                   playQueueList;
+		bool                           isPlayQueueShown_; //< 'playQueueList' is drawn instead of the drawn playlist
+		int                            queuedMusicIndex; //< music index from 'library' of the playing music, if it is from 'playQueue'; otherwise -1
 		core::Time                     sleepTime; //< user can define how long the player should play, when it should put itself to sleep.
 		core::Timer                    playtime; //< started with the first track being played 
 		bool                           fadeOutEnabled;
-		bool                           fadeOutActive;
 		float                          volume;
 		bool                           isShuffled_;
+		bool                           isSameArtistSeparated; //< see Options::SeparateArtists
+		std::mt19937                   rng; //< seeded with App::shuffleSeed, so that a shuffled session can be replayed
 		Replay                         replayStatus;
 		core::Timer                    cooldownSkipReport;
 		core::Timer                    cooldownVolumeReport;
@@ -138,13 +220,64 @@ namespace core
 		Report                         skipReport;
 		Report                         volumeReport;
 
-		void addMusic(std::filesystem::path musicFilePath);
 		/** return playing music index from Playlist::musicIndexList */
 		int getPlaylistPlayingMusicIndex() const;
-		/** return playing music index from MusicPlayer::musicInfoList */
+		/** return playing music index from MusicPlayer::library */
 		int getPlayingMusicIndex() const;
+		Playlist& getAllPlaylist();
+		/** Adds the playlist to 'playlists' and binds its rows; returns nullptr if the name is already used. */
+		Playlist* registerPlaylist(Playlist playlist);
+		/** Returns the list which is drawn and handles the events: the play queue or the drawn playlist; nullptr if nothing is drawn. */
+		DrawableList* getDrawnList();
+		const DrawableList* getDrawnList() const;
+		/** Plays the queue first and then the next or previous music of 'playingOrder'. */
 		void play(bool next);
+		/** Goes back to the last music of the history. */
+		void playPrevious();
+		/** Starts the music of getPlayingMusicIndex(). */
+		void loadMusic();
+		/** Returns the music index from 'library' which play(true) would play next; -1 if the playlist ends. Has no side effects. */
+		int getNextMusicIndex() const;
+		/** Lets 'audioPlayer' prefetch the next music, if it changed (e.g. music was enqueued or the playlist was shuffled). */
+		void prefetchNextMusic();
+		/** Adds the playing music (if any) to the history of 'playQueue'. */
+		void pushHistory();
+		/** Handles the keys which edit the drawn list: enqueue music and remove or move the entries of the play queue or the drawn playlist. */
+		void handleEditEvents();
+		/** Returns nullptr if there is no such playlist or it has no playlist file (ALL_PLAYLIST_NAME). */
+		Playlist* getEditablePlaylist(const std::string& playlistName);
 		void skipTime(Time time);
 		void updateListSelection();
+		void updateOldTracksPlaytime();
+		/** Call this after 'playingOrder' was reordered. */
+		void rebuildPlayingOrderPlaytime();
+		/** Adds the scanned music to the library and finishes the scan, if the scan thread is done. */
+		void applyScanBatches();
+		/** Resolves all playlists (except ALL_PLAYLIST_NAME) in parallel. */
+		void resolvePlaylists();
+		/**
+		 * Fills the playlist with the music of its playlist file. Only reads the library, so several playlists can be resolved in
+		 * parallel after MusicLibrary::buildFilenameIndex(). log() is not thread safe, so the warnings are returned.
+		 * Returns true if the music was taken from the library index, which then does not have to be saved again.
+		 */
+		bool resolvePlaylist(Playlist& playlist, std::vector<std::string>& warnings) const;
+		/** With 'isCompacted' removed music is dropped from the index, but the library is cleared, because its music indices are outdated. */
+		void saveLibraryIndex(bool isCompacted);
+		/** Applies the changes of the music directories to the library and all playlists. */
+		void applyLibraryChanges();
+		void addMusic(const MusicInfo& musicInfo);
+		void removeMusic(int musicIndex);
+		void renameMusic(int musicIndex, const fs::path& newPath);
+		/** Sets the metadata and updates all playlists which contain the music. */
+		void updateMusic(int musicIndex, const MusicInfo& musicInfo);
+		/** Adds or removes the music from each playlist, depending on whether the playlist wants it. */
+		void updatePlaylistMembership(int musicIndex);
+		/** 'position' is the index in Playlist::musicIndexList; -1 appends the music. */
+		void insertIntoPlaylist(Playlist& playlist, int musicIndex, int position = -1);
+		/** Inserts 'deferredOrderPositions' into 'playingOrder' at once (O(n) instead of O(n) per music). */
+		void insertDeferredOrderPositions();
+		/** 'position' is the index in Playlist::musicIndexList. */
+		void removeFromPlaylist(Playlist& playlist, int position);
+		bool isPlayingMusic(int musicIndex) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vector>
+#include <string_view>
+#include <random>
+
+namespace core
+{
+	/**
+	 * The order in which the music of a playlist is played: a permutation of the playlist positions (indices in
+	 * Playlist::musicIndexList) together with its inverse, so the order index of any playlist position is O(1).
+	 * - reset() is the unshuffled order; shuffle() and separateGroups() are O(n).
+	 * - insert() and erase() are O(n), because the positions after the inserted or erased one move by one.
+	 * - append() adds many new positions at the end of the playlist at once in O(n + k), e.g. the music of a scan batch.
+	 */
+	class PlayOrder
+	{
+	public:
+		/** Unshuffled order 0..size-1. */
+		void reset(size_t size);
+		void clear();
+		/** Shuffles all positions with 'rng'. If 'firstPosition' is not -1, it is moved to the front and the rest is shuffled. */
+		void shuffle(std::mt19937& rng, int firstPosition = -1);
+		/**
+		 * Moves positions with the same group (e.g. artist; indexed by playlist position) apart, so that as far as possible no
+		 * neighbours share a group. Conflicting positions are deferred, till a position of another group is placed (O(n)).
+		 * The first position stays first. An empty group never conflicts.
+		 */
+		void separateGroups(const std::vector<std::string_view>& groups);
+		/** Inserts the new playlist 'position' at 'orderIndex'; existing positions >= 'position' are increased. */
+		void insert(size_t orderIndex, int position);
+		/**
+		 * Adds the new playlist positions size()..size()+k-1 (music appended to the playlist) in any order. With 'rng' they are
+		 * put in random order at random order indices >= 'firstOrderIndex', like k insert() calls; otherwise they are appended.
+		 */
+		void append(const std::vector<int>& positions, std::mt19937* rng = nullptr, size_t firstOrderIndex = 0);
+		/** Removes the entry at 'orderIndex'; positions after its position are decreased. */
+		void erase(size_t orderIndex);
+		/** Returns the playlist position at 'orderIndex'. */
+		int at(size_t orderIndex) const;
+		int operator[](size_t orderIndex) const;
+		/** Returns the order index of the playlist position. */
+		int getOrderIndex(int position) const;
+		size_t size() const;
+		bool empty() const;
+		std::vector<int>::const_iterator begin() const;
+		std::vector<int>::const_iterator end() const;
+	private:
+		std::vector<int> order;        //< order index -> playlist position
+		std::vector<int> orderIndices; //< playlist position -> order index (inverse of 'order')
+
+		void updateOrderIndices();
+	};
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "DrawableList.hpp"
+#include <vector>
+
+namespace core
+{
+	class MusicLibrary;
+
+	/**
+	 * The music which is played next ("up next"), before the play order of the active playlist continues, and the history
+	 * of the played music, so that "previous" goes back to the music which was really played before, even if the queue was
+	 * edited or the playlist was shuffled in the meantime.
+	 * - The queue is a linked list of entries; each entry keeps its EntryID till it is removed, so pushFront(), pushBack(),
+	 *   popFront(), erase() and move() are O(1).
+	 * - getEntry() walks from the last requested entry (or the front or back, if that is closer), so the consecutive rows
+	 *   of a DrawableList are O(1) each.
+	 * - The history keeps the last HISTORY_SIZE / 2 to HISTORY_SIZE music indices.
+	 */
+	class PlayQueue
+	{
+	public:
+		using EntryID = int;
+		static constexpr EntryID NOENTRY      = -1;
+		static constexpr size_t  HISTORY_SIZE = 1000;
+
+		struct HistoryEntry
+		{
+			int  musicIndex;
+			bool isQueued; //< was played from the queue and not from the play order of the playlist
+		};
+
+		/** Enqueues the music as the next one. */
+		EntryID pushFront(int musicIndex);
+		/** Enqueues the music as the last one. */
+		EntryID pushBack(int musicIndex);
+		/** Removes the first entry and returns its music index; -1 if the queue is empty. */
+		int popFront();
+		void erase(EntryID entryID);
+		/** Moves the entry in front of 'nextEntryID'; NOENTRY moves it to the back. */
+		void move(EntryID entryID, EntryID nextEntryID);
+		/** Clears the queue, but not the history. */
+		void clear();
+		/** Returns the entry at 'position' (0 is the next music). */
+		EntryID getEntry(size_t position) const;
+		EntryID getNext(EntryID entryID) const;
+		EntryID getPrevious(EntryID entryID) const;
+		int getMusicIndex(EntryID entryID) const;
+		size_t size() const;
+		bool empty() const;
+
+		/** Adds the music which was played till now. */
+		void pushHistory(HistoryEntry entry);
+		/** Removes the last played music and returns it; its music index is -1 if the history is empty. */
+		HistoryEntry popHistory();
+		bool isHistoryEmpty() const;
+	private:
+		struct Entry
+		{
+			int     musicIndex;
+			EntryID previous;
+			EntryID next;
+		};
+
+		std::vector<Entry>        entries; //< indexed by EntryID; free entries are reused
+		std::vector<EntryID>      freeEntries;
+		EntryID                   first = NOENTRY;
+		EntryID                   last  = NOENTRY;
+		size_t                    count = 0;
+		mutable EntryID           cursorEntry    = NOENTRY; //< last entry found by getEntry(); NOENTRY after the queue changed
+		mutable size_t            cursorPosition = 0;
+		std::vector<HistoryEntry> history; //< the last played music is at the back
+
+		EntryID allocate(int musicIndex);
+		/** Inserts the (unlinked) entry in front of 'nextEntryID'; NOENTRY inserts it at the back. */
+		void link(EntryID entryID, EntryID nextEntryID);
+		void unlink(EntryID entryID);
+	};
+
+	/** Formats the drawn rows of the play queue (title and duration) on demand from the library. */
+	class PlayQueueRows : public DrawableList::RowProvider
+	{
+	public:
+		PlayQueueRows() = default;
+		PlayQueueRows(const MusicLibrary* library, const PlayQueue* playQueue);
+		size_t size() const override;
+		DrawableList::Row getRow(size_t index) const override;
+		/** The duration column only formats the longest duration, so editing the queue does not format all rows. */
+		int getMaxLength(size_t columnIndex) const override;
+	private:
+		const MusicLibrary* library   = nullptr;
+		const PlayQueue*    playQueue = nullptr;
+	};
+}
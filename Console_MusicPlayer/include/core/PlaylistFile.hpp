@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	/** Playlist formats of other tools, which can be imported and exported. */
+	enum class PlaylistFileFormat
+	{
+		Unknown,
+		M3U,  //< ".m3u": a path per line, optionally with "#EXTINF:<seconds>,<title>" in front of it
+		M3U8, //< ".m3u8": the same as M3U, but always UTF-8
+		PLS   //< ".pls": "File<N>=", "Title<N>=" and "Length<N>=" keys in a "[playlist]" section
+	};
+
+	struct PlaylistFileEntry
+	{
+		std::wstring path;               //< as written in the file: absolute, relative or an URL
+		std::string  title;              //< utf-8; empty if unknown
+		int          durationInSec = -1; //< -1 if unknown
+	};
+
+	/** Returns the format by the file extension. */
+	PlaylistFileFormat getPlaylistFileFormat(const fs::path& filePath);
+	/** Lines of playlist files should be UTF-8; other lines are read with one character per byte (Latin-1, as older M3U files are written). */
+	std::wstring decodePlaylistLine(const std::string& line);
+	/**
+	 * Returns the path of the file an entry refers to: An absolute path is used as it is; a relative path is looked up
+	 * next to the playlist file first and then in each music directory. "file://" URLs are decoded.
+	 * Returns the path next to the playlist file, if the file exists nowhere, and an empty path for other URLs (e.g. streams).
+	 */
+	fs::path resolvePlaylistEntryPath(const std::wstring& entryPath, const fs::path& playlistDirPath, const std::vector<fs::path>& musicDirs);
+
+	/**
+	 * Reads the entries of a M3U/M3U8 or PLS file one by one, so that only the current entry is in memory (even for
+	 * playlists with 100k entries).
+	 * Usage: if (reader.open(filePath)) while (reader.next(entry)) { ... }
+	 */
+	class PlaylistFileReader
+	{
+	public:
+		/** Returns false if the file can not be opened or the format is unknown. */
+		bool open(const fs::path& filePath);
+		/** Returns false if there are no more entries. */
+		bool next(PlaylistFileEntry& entry);
+	private:
+		std::ifstream      ifs;
+		PlaylistFileFormat format = PlaylistFileFormat::Unknown;
+		bool               isFirstLine = true;
+		PlaylistFileEntry  pendingEntry;            //< M3U: info of the "#EXTINF" line; PLS: keys of the entry with 'pendingNumber'
+		int                pendingNumber = -1;      //< PLS only
+
+		/** Returns false at the end of the file. Removes the line break and the byte order mark. */
+		bool readLine(std::string& line);
+		bool nextM3U(PlaylistFileEntry& entry);
+		bool nextPLS(PlaylistFileEntry& entry);
+	};
+
+	/**
+	 * Writes the entries of a M3U/M3U8 or PLS file one by one (UTF-8). The file is written to a temporary file first,
+	 * which replaces the file on close(), so a failed export never leaves a half written file.
+	 */
+	class PlaylistFileWriter
+	{
+	public:
+		/** Discards the temporary file, if close() was not called. */
+		~PlaylistFileWriter();
+		/** Returns false if the file can not be written or the format is unknown. */
+		bool open(const fs::path& filePath);
+		void write(const PlaylistFileEntry& entry);
+		/** Returns false if writing failed. */
+		bool close();
+	private:
+		std::ofstream      ofs;
+		fs::path           filePath;
+		fs::path           tempFilePath;
+		PlaylistFileFormat format = PlaylistFileFormat::Unknown;
+		int                entryCount = 0;
+	};
+
+	/**
+	 * Converts a M3U/M3U8 or PLS file into a playlist file (one music filename per line), streaming entry by entry.
+	 * Streams and files outside of the music directories are skipped with a warning, because the music player can not find
+	 * them. Returns false if the playlist can not be read or written.
+	 */
+	bool importPlaylistFile(const fs::path& filePath, const fs::path& playlistFilePath, const std::vector<fs::path>& musicDirs, std::vector<std::string>& warnings);
+}
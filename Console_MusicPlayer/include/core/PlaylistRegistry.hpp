@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Time.hpp"
+#include "DrawableList.hpp"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	class MusicLibrary;
+
+	/** Formats the drawn rows of a playlist (title and duration) on demand from the library, so the rows are not stored. */
+	class PlaylistRows : public DrawableList::RowProvider
+	{
+	public:
+		PlaylistRows() = default;
+		PlaylistRows(const MusicLibrary* library, const std::vector<int>* musicIndexList);
+		size_t size() const override;
+		DrawableList::Row getRow(size_t index) const override;
+		/** The duration column only formats the longest duration. */
+		int getMaxLength(size_t columnIndex) const override;
+	private:
+		const MusicLibrary*     library        = nullptr;
+		const std::vector<int>* musicIndexList = nullptr;
+	};
+
+	struct Playlist
+	{
+		std::string      name;
+		fs::path         filePath; //< empty for ALL_PLAYLIST_NAME
+		std::vector<int> musicIndexList; //< music index from 'library'
+		std::vector<std::wstring> musicFilenames; //< entries of the playlist file; empty for ALL_PLAYLIST_NAME, which contains all music
+		std::unordered_set<std::wstring> musicFilenameSet; //< the filenames of 'musicFilenames', so whether the playlist wants a music is O(1)
+		std::vector<bool> containedMusic; //< music index from 'library' -> is in 'musicIndexList' (each music is in it at most once)
+		uintmax_t        fileSize;      //< of the playlist file, to find out if the resolved music in the library index is still valid
+		long long        lastWriteTime; //< fs::file_time_type ticks
+		bool             isEdited = false; //< the playlist file is rewritten in the background (see PlaylistWriter), so 'fileSize' and 'lastWriteTime' are outdated
+		DrawableList     drawableList; //< is in the order of the currently playing playlist; Is in 'Playlist', so that unactive playlists can be drawn.
+		PlaylistRows     rows;         //< rows of 'drawableList'; points into this playlist, so it is set after the playlist is added to the PlaylistRegistry, which never moves it
+		Time             duration;
+		Time             oldTracksPlaytime; //< playtime of all tracks till now; add getPlayingMusicElapsedTime() to get the playtime; max is 'duration'
+	};
+
+	/**
+	 * Owns all playlists of the music player. Each playlist is allocated once, so pointers to it stay valid until it is
+	 * removed; adding or removing other playlists never moves it.
+	 * - A Handle identifies a playlist; after the playlist is removed, the handle is invalid (get() returns nullptr), even
+	 *   if its slot is reused by a new playlist.
+	 * - add(), remove() and the lookups by handle or name are O(1).
+	 * - Iterating visits all playlists in the order they were added, except that remove() moves the last playlist into the gap.
+	 */
+	class PlaylistRegistry
+	{
+	public:
+		struct Handle
+		{
+			uint32_t slot       = UINT32_MAX;
+			uint32_t generation = 0;
+
+			bool operator==(const Handle& other) const { return slot == other.slot && generation == other.generation; }
+			bool operator!=(const Handle& other) const { return !(*this == other); }
+		};
+
+		class Iterator
+		{
+		public:
+			explicit Iterator(std::vector<Playlist*>::const_iterator it) : it(it) {}
+			Playlist& operator*() const { return **it; }
+			Playlist* operator->() const { return *it; }
+			Iterator& operator++() { ++it; return *this; }
+			bool operator==(const Iterator& other) const { return it == other.it; }
+			bool operator!=(const Iterator& other) const { return it != other.it; }
+		private:
+			std::vector<Playlist*>::const_iterator it;
+		};
+
+		/** Returns an invalid handle, if a playlist with this name already exists. */
+		Handle add(Playlist playlist);
+		/** Returns false if the handle is invalid. Pointers to the removed playlist are dangling afterwards. */
+		bool remove(Handle handle);
+		void clear();
+		/** Returns nullptr if the handle is invalid. */
+		Playlist* get(Handle handle);
+		const Playlist* get(Handle handle) const;
+		/** Returns an invalid handle, if there is no playlist with this name. */
+		Handle find(const std::string& name) const;
+		bool isValid(Handle handle) const;
+		size_t size() const;
+		bool empty() const;
+		Iterator begin() const;
+		Iterator end() const;
+	private:
+		struct Slot
+		{
+			std::unique_ptr<Playlist> playlist;       //< nullptr if the slot is free
+			uint32_t                  generation = 0; //< is increased when the playlist is removed, so old handles become invalid
+			uint32_t                  position   = 0; //< in 'playlists'
+		};
+
+		std::vector<Slot>                         slots;
+		std::vector<uint32_t>                     freeSlots;
+		std::vector<Playlist*>                    playlists;     //< all playlists for iterating
+		std::vector<uint32_t>                     playlistSlots; //< slot of each entry in 'playlists'
+		std::unordered_map<std::string, uint32_t> slotsByName;
+	};
+}
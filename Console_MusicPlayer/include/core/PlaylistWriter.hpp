@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace core
+{
+	/**
+	 * Saves the edits of playlists on a background thread, so that editing a large playlist neither blocks the main thread
+	 * nor rewrites the whole playlist file per edit.
+	 * - Each edit is appended to the journal of the playlist file ("<playlist>.pl.journal"); only the journal grows per edit.
+	 * - The journal is compacted into the playlist file, when it has COMPACT_EDIT_COUNT edits, when the playlist was not
+	 *   edited for COMPACT_DELAY, or on stop(). The playlist file is written to a temporary file first, which then replaces
+	 *   the playlist file, so a crash never leaves a half written playlist file.
+	 * - A journal starts with the last write time of the playlist file it belongs to. After a crash applyJournal() replays
+	 *   a valid journal when the playlist is loaded; a journal of another version of the playlist file (e.g. the crash
+	 *   happened after the compacted file replaced the old one) is deleted.
+	 * Usage:
+	 * - start() the writer, append() the edits and compact() new playlists, pollLog() on the main thread (e.g. every frame).
+	 * - stop() it before the application terminates (the destructor does this too), which compacts all journals.
+	 */
+	class PlaylistWriter
+	{
+	public:
+		struct Edit
+		{
+			enum class Type
+			{
+				Insert, //< inserts 'filename' at 'position'
+				Erase,  //< erases the entry at 'position'
+				Move    //< moves the entry at 'position' to 'newPosition' (the index it has afterwards)
+			};
+
+			Type         type;
+			int          position;
+			int          newPosition;
+			std::wstring filename;
+		};
+
+		static constexpr int COMPACT_EDIT_COUNT = 512;
+
+		~PlaylistWriter();
+		void start();
+		/** Writes and compacts all pending edits and stops the thread. */
+		void stop();
+		/** 'playlistFilePath' has to be the same path for all edits of a playlist. */
+		void append(const fs::path& playlistFilePath, Edit edit);
+		/** Compacts the journal into the playlist file soon; creates the (empty) playlist file if it does not exist. */
+		void compact(const fs::path& playlistFilePath);
+		/** Logs the errors of the background thread. Must be called on the main thread, because log() is not thread safe. */
+		void pollLog();
+
+		/** Applies the edits of a valid journal of the playlist file to its entries. Returns false if there is no valid journal. */
+		static bool applyJournal(const fs::path& playlistFilePath, std::vector<std::wstring>& musicFilenames);
+		/** One music filename per line (UTF-8). */
+		static std::vector<std::wstring> readPlaylistFile(const fs::path& playlistFilePath);
+	private:
+		struct PendingPlaylist
+		{
+			fs::path          filePath;
+			std::vector<Edit> edits;           //< not yet in the journal
+			bool              isCompactRequested = false;
+		};
+
+		std::thread                  thread;
+		std::atomic<bool>            isRunning = false;
+		std::mutex                   mutex; //< locks 'pendingPlaylists' and 'logMessages'
+		std::condition_variable      condition;
+		std::vector<PendingPlaylist> pendingPlaylists;
+		std::vector<std::string>     logMessages; //< log() is not thread safe
+
+		void run();
+		void pushLog(std::string message);
+		/** Returns false if the journal could not be written. */
+		bool writeJournal(const fs::path& playlistFilePath, const std::vector<Edit>& edits);
+		void compactJournal(const fs::path& playlistFilePath);
+	};
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Time.hpp"
+#include <vector>
+
+namespace core
+{
+	/**
+	 * Prefix sums of the track durations in play order (Fenwick tree), so the playtime before any track is O(log n) instead
+	 * of summing all earlier tracks at each track change.
+	 * - set() (e.g. a changed duration or two swapped tracks) is O(log n).
+	 * - insert() and erase() rebuild the tree in O(n), which is not slower than inserting into the play order itself.
+	 */
+	class PlaytimeIndex
+	{
+	public:
+		/** O(n) */
+		void assign(const std::vector<Time>& durations);
+		void clear();
+		void set(size_t position, Time duration);
+		void insert(size_t position, Time duration);
+		void erase(size_t position);
+		/** Sum of the durations in [0, position); 'position' may be size(). */
+		Time getPlaytimeBefore(size_t position) const;
+		Time getDuration(size_t position) const;
+		Time getTotal() const;
+		size_t size() const;
+	private:
+		std::vector<long long> durations; //< nanoseconds
+		std::vector<long long> tree;      //< 1-based; tree[i] is the sum of the durations in (i - lowbit(i), i]
+
+		void build();
+	};
+}
@@ -3,6 +3,8 @@
 #include "Time.hpp"
 #include <map>
 #include <string>
+#include <string_view>
+#include <mutex>
 #include <filesystem>
 namespace fs = std::filesystem;
 using namespace std::string_literals;
@@ -78,8 +80,16 @@ namespace core
 	size_t getUniCodeCharCount(const std::string& utf8);
 	size_t getUniCodeCharCount(const std::wstring& utf8);
 	bool isSupportedAudioFile(fs::path filepath);
+	/** Same as isSupportedAudioFile(), but without creating a path (e.g. for each entry of a directory listing). */
+	bool isSupportedAudioFilename(std::wstring_view filename);
 	bool isAudioFile(fs::path filepath);
 	bool hasFlag(int flag, int flagList);
+	/**
+	 * Has to be locked around Mix_LoadMUS() and Mix_LoadWAV(), which are called from several threads (LibraryScanner and
+	 * AudioPlayer): SDL_mixer initializes a decoder, which Mix_Init() did not load (e.g. MOD or MIDI), on its first use
+	 * without locking.
+	 */
+	std::mutex& getMixerLoadMutex();
 
 	void setConfig(std::filesystem::path path, const std::map<std::wstring, std::wstring>& config);
 	/** File must contain in each line: varName=varValue. */
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "MusicInfo.hpp"
+#include <filesystem>
+namespace fs = std::filesystem;
+
+/**
+ * Reads metadata (title, artist, album) and the exact duration directly from the file headers, which is much
+ * faster than opening an SDL_mixer decoder. Usually only the first few KB of a file are read.
+ * Supported are:
+ * - MP3: ID3v2.2-2.4 and ID3v1 tags; duration from the Xing / Info (incl. LAME encoder delay) or VBRI frame, or from the bitrate of CBR files.
+ * - FLAC: STREAMINFO and VORBIS_COMMENT blocks.
+ * - OGG Vorbis / Opus: Vorbis comments; duration from the granule position of the last page (reads the end of the file).
+ * - WAV: RIFF fmt, fact, data and LIST/INFO chunks.
+ * Other formats (MOD, MIDI, VOC, ..) are not supported - use Mix_LoadMUS() for them.
+ */
+namespace core::tagReader
+{
+	/**
+	 * Returns false if the format is not supported or the file could not be parsed, then 'musicInfo' is unchanged.
+	 * Tags which are not found are left empty.
+	 */
+	bool read(const fs::path& musicFilePath, MusicInfo& musicInfo);
+}
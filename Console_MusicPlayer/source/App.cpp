@@ -14,6 +14,7 @@
 #include <locale>
 #include <iostream>
 #include <thread>
+#include <algorithm>
 
 intern std::vector<fs::path> getMusicDirsFromConfig(fs::path configFilePath);
 intern App::Style getStyle();
@@ -28,6 +29,11 @@ App::App() :
 	directoryState(this),
 	drawTimer(),
 	musicDirs(), // do not initialize here, because maybe config.properties does not exist.
+	scanThreadCount(0),
+	shuffleSeed(0),
+	crossfadeTime(core::Seconds(10)),
+	crossfadeCurve(core::AudioPlayer::FadeCurve::EqualPower),
+	isLatencyProbed(false),
 	style(),
 	isDrawKeyInfo(true)
 {
@@ -81,13 +87,7 @@ App::App() :
 		std::cout << "SDL mixer initialization failed! SDL Error: " << Mix_GetError() << "\n";
 		__debugbreak();
 	}
-	int frequency{ 44100 }; // 44.1KHz, which is CD audio rate (Most games use 22050, because 44100 requires too much CPU power on older computers)
-	int hardware_channels{ 2 }; // 2 for stereo
-	int chunksize{ 4096 }; // 2048
-	if (Mix_OpenAudio(frequency, MIX_DEFAULT_FORMAT, hardware_channels, chunksize) == -1) {
-		std::cout << "SDL mixer initialization failed! SDL Error: " << Mix_GetError() << "\n";
-		__debugbreak();
-	}
+	// The audio device is opened after config.properties is read.
 	// Create SDL2 window
 	// This is required to receive SDL_Event's.
 	//SDL_WINDOW_HIDDEN | SDL_WINDOW_INPUT_FOCUS | SDL_WINDOW_MOUSE_FOCUS | SDL_WINDOW_KEYBOARD_GRABBED | SDL_WINDOW_MOUSE_GRABBED
@@ -147,7 +147,29 @@ App::App() :
 			<< "# Specify the playlist loop behaviour, which can be: 'none', 'one', 'all'\n"
 			<< "playlistLoop = none\n\n"
 			<< "# Specify after which time the playlist should stop playing. Specify 'nolimit' to ignore this or the time in seconds.\n"
-			<< "totalRuntimeInSec = nolimit";
+			<< "totalRuntimeInSec = nolimit\n\n"
+			<< "# Specify how many threads should read the music metadata at startup. Specify 'auto' to use one thread per core.\n"
+			<< "scanThreadCount = auto\n\n"
+			<< "# Specify if the music can be played while the music directories are still scanned ('true') or if the start waits for the scan ('false').\n"
+			<< "progressiveStartup = true\n\n"
+			<< "# Specify the seed of the shuffle, to replay a shuffled session exactly (see data/log.txt for the seed of the last session). Specify 'random' for a new order each time.\n"
+			<< "shuffleSeed = random\n\n"
+			<< "# Specify if the shuffle should avoid playing the same artist twice in a row.\n"
+			<< "isShuffleSeparatingArtists = false\n\n"
+			<< "# Specify how many seconds the end of a music overlaps with the start of the next music. Specify '0' to play the music without gap and without crossfade.\n"
+			<< "crossfadeInSec = 10\n\n"
+			<< "# Specify the crossfade curve, which can be: 'linear', 'equalPower' (keeps the loudness during the crossfade)\n"
+			<< "crossfadeCurve = equalPower\n\n"
+			<< "# Specify the sample rate of the audio device in Hz (e.g. 44100 or 48000). Specify 'native' to use the rate of the device, so that it does not resample the music.\n"
+			<< "audioFrequency = 44100\n\n"
+			<< "# Specify the sample format of the audio device, which can be: 's16', 's32', 'f32' (keeps the music in floating point from decoding till the device, so low volumes and fades are not rounded)\n"
+			<< "audioFormat = s16\n\n"
+			<< "# Specify the number of audio channels (1 = mono, 2 = stereo, ...).\n"
+			<< "audioChannels = 2\n\n"
+			<< "# Specify the size of the audio buffer in samples. A small buffer reacts faster to pause and skip, but may crackle on a busy computer (4096 samples at 44100 Hz are 93 ms).\n"
+			<< "audioChunkSize = 4096\n\n"
+			<< "# Specify if the latency from pause, resume and skip till they are audible is written to data/log.txt ('true'), to tune audioChunkSize.\n"
+			<< "latencyProbe = false";
 		ofs.close();
 		// "D:/Data/Music/", "C:/Users/Jonas/Music/", "music/"
 	}
@@ -181,7 +203,15 @@ App::App() :
 			<< "TrackSkipBackward = 68\n"
 			<< "TrackSkipForward = 69\n"
 			<< "KeyInfo = 10\n"
-			<< "Select = 59\n";
+			<< "Select = 59\n"
+			<< "ShowQueue = 16\n"
+			<< "EnqueueNext = 13\n"
+			<< "EnqueueLast = 0\n"
+			<< "RemoveEntry = 67\n"
+			<< "MoveEntryUp = 62\n"
+			<< "MoveEntryDown = 63\n"
+			<< "ExportPlaylist = 4\n"
+			<< "RescanPlaylists = 92\n";
 		ofs.close();
 	}
 
@@ -191,6 +221,57 @@ App::App() :
 	// Set music directories:
 	// Note set this after config.properties is created and before State::init() is called.
 	musicDirs = getMusicDirsFromConfig(configFilePath);
+	// Optional, so older configuration files stay valid:
+	if (config.count(L"scanThreadCount") && config[L"scanThreadCount"] != L"auto") {
+		scanThreadCount = std::stoi(config[L"scanThreadCount"]);
+	}
+	if (config.count(L"shuffleSeed") && config[L"shuffleSeed"] != L"random") {
+		shuffleSeed = (unsigned int)std::stoul(config[L"shuffleSeed"]);
+	}
+	if (config.count(L"crossfadeInSec")) {
+		crossfadeTime = core::Milliseconds((long long)(std::stod(config[L"crossfadeInSec"]) * 1000));
+	}
+	if (config.count(L"crossfadeCurve")) {
+		crossfadeCurve = config[L"crossfadeCurve"] == L"linear" ? core::AudioPlayer::FadeCurve::Linear : core::AudioPlayer::FadeCurve::EqualPower;
+	}
+	isLatencyProbed = config[L"latencyProbe"] == L"true";
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Init audio device
+	///////////////////////////////////////////////////////////////////////////////
+	// Optional, so older configuration files stay valid:
+	int frequency{ 44100 }; // 44.1KHz, which is CD audio rate (Most games use 22050, because 44100 requires too much CPU power on older computers)
+	Uint16 format{ MIX_DEFAULT_FORMAT };
+	int hardware_channels{ 2 }; // 2 for stereo
+	int chunksize{ 4096 }; // 2048
+	int allowedChanges{ 0 }; // SDL converts the music to the requested device parameters
+	if (config.count(L"audioFrequency") && config[L"audioFrequency"] == L"native") {
+		SDL_AudioSpec nativeSpec;
+		if (SDL_GetDefaultAudioInfo(nullptr, &nativeSpec, 0) == 0) {
+			frequency = nativeSpec.freq;
+		}
+		allowedChanges = SDL_AUDIO_ALLOW_FREQUENCY_CHANGE; // ..the device keeps its rate, if the default device is unknown
+	}
+	else if (config.count(L"audioFrequency")) {
+		frequency = std::stoi(config[L"audioFrequency"]);
+	}
+	if (config.count(L"audioFormat")) {
+		format = config[L"audioFormat"] == L"s32" ? AUDIO_S32SYS : (config[L"audioFormat"] == L"f32" ? AUDIO_F32SYS : AUDIO_S16SYS);
+	}
+	if (config.count(L"audioChannels")) {
+		hardware_channels = std::stoi(config[L"audioChannels"]);
+	}
+	if (config.count(L"audioChunkSize")) {
+		chunksize = std::stoi(config[L"audioChunkSize"]);
+	}
+	if (Mix_OpenAudioDevice(frequency, format, hardware_channels, chunksize, nullptr, allowedChanges) == -1) {
+		std::cout << "SDL mixer initialization failed! SDL Error: " << Mix_GetError() << "\n";
+		__debugbreak();
+	}
+	// The opened device may differ from the requested one:
+	Mix_QuerySpec(&frequency, &format, &hardware_channels);
+	core::log("Audio device: " + std::to_string(frequency) + " Hz, " + std::to_string(SDL_AUDIO_BITSIZE(format)) + (SDL_AUDIO_ISFLOAT(format) ? " bit float, " : " bit, ")
+		+ std::to_string(hardware_channels) + " channels, " + std::to_string(chunksize) + " samples buffer (" + std::to_string(chunksize * 1000 / frequency) + " ms)");
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Init music player
@@ -202,14 +283,12 @@ App::App() :
 	int musicPlayer_options =
 		(config[L"isPlaylistShuffled"] == L"true" ? core::MusicPlayer::Shuffle : 0) |
 		(config[L"playlistLoop"] == L"none" ? 0 : (config[L"playlistLoop"] == L"one" ? core::MusicPlayer::LoopOne : core::MusicPlayer::LoopAll)) |
-		core::MusicPlayer::FadeOut;
+		(config.count(L"progressiveStartup") == 0 || config[L"progressiveStartup"] == L"true" ? core::MusicPlayer::ProgressiveLoad : 0) | // optional, so older configuration files stay valid
+		(config[L"isShuffleSeparatingArtists"] == L"true" ? core::MusicPlayer::SeparateArtists : 0) |
+		(crossfadeTime > 0ns ? core::MusicPlayer::FadeOut : 0);
 	musicPlayer.init(this, musicPlayer_options, musicPlayer_sleepTime);
 	// Add all playlists:
-	for (auto& it : fs::directory_iterator("data")) {
-		if (it.is_regular_file() && it.path().extension() == ".pl") {
-			musicPlayer.addPlaylist(it.path().u8string());
-		}
-	}
+	musicPlayer.scanPlaylists();
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Init rest
@@ -366,28 +445,37 @@ intern std::vector<fs::path> getMusicDirsFromConfig(fs::path configFilePath)
 			musicDir = normalizedPath;
 		}
 	}
-	for (auto subPathIt = musicDirs.begin(); subPathIt != musicDirs.end();) {
-		fs::path subPath = std::filesystem::weakly_canonical(*subPathIt);
-		bool isSubpath = false;
-		for (auto rootPathIt = musicDirs.begin(); rootPathIt != musicDirs.end(); ++rootPathIt) {
-			if (subPathIt == rootPathIt) {
-				// ..is same directory, skip.
-				continue;
-			}
-			fs::path rootPath = std::filesystem::weakly_canonical(*rootPathIt);
-			auto [rootIT, subIT] = std::mismatch(rootPath.begin(), rootPath.end(), subPath.begin());
-			if (rootIT == rootPath.end()) {
-				// ..rootPath is really a root path of subPath
+	// weakly_canonical() needs file system requests, so it is called once per directory. fs::path compares element-wise,
+	// so after sorting each sub path follows its root path (or another sub path of it), e.g. "C:/a", "C:/a/b", "C:/a b".
+	// Directories which are the same through links inside of a music directory are skipped by the LibraryScanner.
+	std::vector<std::pair<fs::path, size_t>> canonicalPaths; //< second: index in musicDirs
+	canonicalPaths.reserve(musicDirs.size());
+	for (size_t i = 0; i < musicDirs.size(); ++i) {
+		canonicalPaths.push_back({ std::filesystem::weakly_canonical(musicDirs[i]), i });
+	}
+	std::sort(canonicalPaths.begin(), canonicalPaths.end());
+	std::vector<bool> isSubPath(musicDirs.size(), false);
+	const fs::path* rootPath = nullptr;
+	for (auto& [canonicalPath, musicDirIndex] : canonicalPaths) {
+		if (rootPath) {
+			auto [rootIT, subIT] = std::mismatch(rootPath->begin(), rootPath->end(), canonicalPath.begin(), canonicalPath.end());
+			if (rootIT == rootPath->end()) {
+				// ..rootPath is really a root path of canonicalPath (or the same directory)
 				// To avoid adding music twice we have to delete the sub path.
-				subPathIt = musicDirs.erase(subPathIt);
-				isSubpath = true;
-				break;
+				isSubPath[musicDirIndex] = true;
+				continue;
 			}
 		}
-		if (!isSubpath) {
-			++subPathIt;
+		rootPath = &canonicalPath;
+	}
+	// Keep the order of the configuration (it is the order of the music in the library):
+	std::vector<fs::path> rootDirs;
+	for (size_t i = 0; i < musicDirs.size(); ++i) {
+		if (!isSubPath[i]) {
+			rootDirs.push_back(std::move(musicDirs[i]));
 		}
 	}
+	musicDirs = std::move(rootDirs);
 
 	// Set default music directory:
 	// Should not be added automatically, because user should control what he wants. I add this only if config file does not exist.
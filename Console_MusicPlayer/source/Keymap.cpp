@@ -18,6 +18,14 @@ intern std::wstring actionToStr(Keymap::Action action)
 	if (action == Keymap::Action::TrackSkipForward) return L"TrackSkipForward";
 	if (action == Keymap::Action::KeyInfo) return L"KeyInfo";
 	if (action == Keymap::Action::Select) return L"Select";
+	if (action == Keymap::Action::ShowQueue) return L"ShowQueue";
+	if (action == Keymap::Action::EnqueueNext) return L"EnqueueNext";
+	if (action == Keymap::Action::EnqueueLast) return L"EnqueueLast";
+	if (action == Keymap::Action::RemoveEntry) return L"RemoveEntry";
+	if (action == Keymap::Action::MoveEntryUp) return L"MoveEntryUp";
+	if (action == Keymap::Action::MoveEntryDown) return L"MoveEntryDown";
+	if (action == Keymap::Action::ExportPlaylist) return L"ExportPlaylist";
+	if (action == Keymap::Action::RescanPlaylists) return L"RescanPlaylists";
 	__debugbreak();
 	return L"";
 }
@@ -25,8 +33,25 @@ intern std::wstring actionToStr(Keymap::Action action)
 void Keymap::init()
 {
 	std::map<std::wstring, std::wstring> config = core::getConfig("data/keymap.properties");
+	// The keys of the play queue and the playlist editor are optional, so older keymap files stay valid:
+	std::map<Action, core::inputDevice::Key> defaultKeys = {
+		{ Action::ShowQueue,       core::inputDevice::Key::Q },
+		{ Action::EnqueueNext,     core::inputDevice::Key::N },
+		{ Action::EnqueueLast,     core::inputDevice::Key::A },
+		{ Action::RemoveEntry,     core::inputDevice::Key::Delete },
+		{ Action::MoveEntryUp,     core::inputDevice::Key::PageUp },
+		{ Action::MoveEntryDown,   core::inputDevice::Key::PageDown },
+		{ Action::ExportPlaylist,  core::inputDevice::Key::E },
+		{ Action::RescanPlaylists, core::inputDevice::Key::F5 }
+	};
 	for (int i = 0; i < data.size(); ++i) {
-		data[i] = (core::inputDevice::Key)stoi(config.at(actionToStr((Action)i)));
+		std::wstring actionStr = actionToStr((Action)i);
+		if (config.count(actionStr) == 0 && defaultKeys.count((Action)i)) {
+			data[i] = defaultKeys[(Action)i];
+		}
+		else {
+			data[i] = (core::inputDevice::Key)stoi(config.at(actionStr));
+		}
 	}
 
 	symbolMap[(int)core::inputDevice::Key::A] = "A";
@@ -60,10 +60,10 @@ void DirectoryState::update()
 {
 	list.update();
 
-	// Update border color:
-	if (!Mix_PlayingMusic())                           list.style.border = core::Color::Light_Red; // stopped
-	else if (Mix_PausedMusic())                        list.style.border = core::Color::Light_Aqua; // paused
-	else if (Mix_PlayingMusic() && !Mix_PausedMusic()) list.style.border = core::Color::Light_Green; // playing
+	// Update border color (Mix_PlayingMusic() only tells whether the AudioPlayer streams music at the moment):
+	if (app->musicPlayer.isStopped())     list.style.border = core::Color::Light_Red; // stopped
+	else if (app->musicPlayer.isPaused()) list.style.border = core::Color::Light_Aqua; // paused
+	else                                  list.style.border = core::Color::Light_Green; // playing
 
 	if (list.isTrappedOnTop()) {
 		list.loseFocus();
@@ -5,6 +5,7 @@
 #include "core/InputDevice.hpp"
 #include "core/MusicPlayer.hpp"
 #include <map>
+#include <unordered_set>
 #include <Windows.h>
 #include <iostream>
 
@@ -39,13 +40,8 @@ void PlaylistState::init()
 	sliInfo.sizeInside          = { 60, 20 };
 	sliInfo.hover               = 0; // selectedPlaylist;
 	playlistList.init(sliInfo);
-	// Fill list:
-	for (auto& it : fs::directory_iterator("data")) {
-		if (it.is_regular_file() && it.path().extension() == ".pl") {
-			// Set playlist list:
-			playlistList.push_back({ it.path().stem().string() });
-		}
-	}
+	// Fill list (afterwards it is only updated on Message::PLAYLISTS_CHANGED):
+	updatePlaylistList();
 	// Calculate everything new (important):
 	playlistList.onConsoleResize();
 
@@ -75,21 +71,6 @@ void PlaylistState::update()
 	// playlist list:
 	if (state == State::PlaylistList) 
 	{
-		std::string selectedPlaylistName = playlistList.getSelectedIndex() == core::DrawableList::NOINDEX ? "" : playlistList.getSelected()[0];
-		// Update data:
-		playlistList.clear();
-		int i = 0;
-		for (auto& it : fs::directory_iterator("data")) {
-			if (it.is_regular_file() && it.path().extension() == ".pl") {
-				playlistList.push_back({ it.path().stem().string() });
-				// Select old playlist:
-				// Order can change, so this is necessary.
-				if (selectedPlaylistName == it.path().stem().string()) {
-					playlistList.select(i);
-				}
-				++i; // increase i here, because in data/ can be other files.
-			}
-		}
 		// Update border color:
 		if (app->musicPlayer.isStopped())      playlistList.style.border = core::Color::Light_Red;
 		else if (app->musicPlayer.isPaused())  playlistList.style.border = core::Color::Light_Aqua;
@@ -124,6 +105,10 @@ void PlaylistState::handleEvent()
 	{
 		playlistList.handleEvent();
 
+		if (playlistList.hasFocus() && core::inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::RescanPlaylists).key)) {
+			app->musicPlayer.scanPlaylists();
+		}
+
 		if (playlistList.hasFocus() && core::inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::Select).key))
 		{
 			// Clear the key state, so that musicPlayer does not automatically play the first / hovered track.
@@ -187,12 +172,42 @@ void PlaylistState::scrollToTop()
 	}
 }
 
+void PlaylistState::updatePlaylistList()
+{
+	std::unordered_set<std::string> rowNames;
+	for (const std::string& playlistName : app->musicPlayer.getPlaylistNames()) {
+		rowNames.insert(playlistName.substr(0, playlistName.length() - 3)); // remove ".pl"
+	}
+	for (size_t i = playlistList.size(); i-- > 0;) {
+		if (rowNames.erase(playlistList.get()[i][0]) == 0) {
+			playlistList.erase(i);
+		}
+	}
+	// ..'rowNames' contains only the new playlists
+	for (const std::string& playlistName : app->musicPlayer.getPlaylistNames()) {
+		std::string rowName = playlistName.substr(0, playlistName.length() - 3);
+		if (rowNames.count(rowName)) {
+			playlistList.push_back({ rowName });
+		}
+	}
+}
+
 void PlaylistState::onMessage(core::Message message)
 {
 	if (message.id == core::MessageID::CONSOLE_RESIZE) {
 		playlistList.onConsoleResize();
 	}
 
+	if (message.id == Message::PLAYLISTS_CHANGED) {
+		std::string drawnPlaylistName = state == State::Playlist ? playlistList.getHover()[0] : "";
+		updatePlaylistList();
+		if (state == State::Playlist && (playlistList.size() == 0 || playlistList.getHover()[0] != drawnPlaylistName)) {
+			//.. drawn playlist was removed
+			state = State::PlaylistList;
+			app->musicPlayer.setDrawnPlaylist("");
+		}
+	}
+
 	if (message.id == Message::NAVBAR_SHORTCUT_TRIGGERED) {
 		app->musicPlayer.stopDrawableListEvents();
 		playlistList.loseFocus();
@@ -0,0 +1,695 @@
+#include "core/AudioPlayer.hpp"
+#include "core/SmallTools.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+std::atomic<bool> core::AudioPlayer::isMusicFinished(false);
+
+core::AudioPlayer::~AudioPlayer()
+{
+	terminate();
+}
+
+void core::AudioPlayer::init()
+{
+	terminate();
+	int channels = 0;
+	if (Mix_QuerySpec(&frequency, &format, &channels) == 0) {
+		log("Error: AudioPlayer requires an opened audio device!");
+		return;
+	}
+	frameSize = SDL_AUDIO_BITSIZE(format) / 8 * channels;
+	events.reserve(16);
+	isRunning = true;
+	loaderThread = std::thread(&AudioPlayer::runLoader, this);
+	// SDL_mixer decodes the streamed music into the audio buffer before the post mix callback, which takes it from there:
+	Mix_VolumeMusic(MIX_MAX_VOLUME); // ..so the samples are not changed
+	Mix_HookMusicFinished(&AudioPlayer::onMusicFinished);
+	Mix_SetPostMix(&AudioPlayer::mix, this);
+	isHooked = true;
+}
+
+void core::AudioPlayer::terminate()
+{
+	if (isHooked) {
+		Mix_SetPostMix(nullptr, nullptr); // waits for a running audio callback
+		Mix_HookMusicFinished(nullptr);
+		Mix_HaltMusic();
+		isHooked = false;
+	}
+	isRunning = false;
+	condition.notify_one();
+	if (loaderThread.joinable()) {
+		loaderThread.join();
+	}
+	for (Track* track : tracks) {
+		freeTrack(track);
+	}
+	tracks.clear();
+	current = nullptr;
+	next = nullptr;
+	position = 0;
+	fading = nullptr;
+	fadeInLength = 0;
+	crossfadeLength = 0;
+	streaming = nullptr;
+	isStreamPaused = false;
+	isEnded = false;
+	isNextReplayed = false;
+	isPaused_ = false;
+	currentLoadID = 0;
+	nextLoadID = 0;
+	loadingID = 0;
+	logMessages.clear();
+	events.clear();
+	probeAction = nullptr;
+	probedAction = nullptr;
+	currentPath.clear();
+	nextPath.clear();
+}
+
+void core::AudioPlayer::play(const fs::path& musicFilePath)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (current && current->path == musicFilePath) {
+		// ..replay
+	}
+	else if (next && next->path == musicFilePath) {
+		current = next;
+	}
+	else if (nextLoadID != 0 && nextLoadPath == musicFilePath) {
+		// ..the loader thread continues with it
+		current = nullptr;
+		currentLoadID = nextLoadID;
+		currentLoadPath = musicFilePath;
+	}
+	else {
+		current = nullptr;
+		currentLoadID = ++lastLoadID;
+		currentLoadPath = musicFilePath;
+		condition.notify_one();
+	}
+	if (current) {
+		currentLoadID = 0;
+	}
+	next = nullptr;
+	nextLoadID = 0;
+	isNextReplayed = false;
+	position = 0; // ..a streamed music is decoded again, if its start is not decoded anymore (see mixLocked())
+	fading = nullptr;
+	fadeInLength = 0;
+	isEnded = false;
+	isPaused_ = false;
+	events.clear();
+	currentPath = musicFilePath;
+	nextPath.clear();
+}
+
+void core::AudioPlayer::setNext(const fs::path& musicFilePath)
+{
+	if (musicFilePath == nextPath) {
+		return;
+	}
+	nextPath = musicFilePath;
+	std::lock_guard<std::mutex> lock(mutex);
+	next = nullptr;
+	nextLoadID = 0;
+	isNextReplayed = false;
+	if (musicFilePath.empty()) {
+		return;
+	}
+	if (musicFilePath == currentPath) {
+		isNextReplayed = true;
+		return;
+	}
+	auto it = std::find_if(tracks.begin(), tracks.end(), [&](const Track* track) { return track->path == musicFilePath; });
+	if (it != tracks.end()) {
+		next = *it; // ..e.g. the previous music is played next again
+		return;
+	}
+	nextLoadID = ++lastLoadID;
+	nextLoadPath = musicFilePath;
+	condition.notify_one();
+}
+
+void core::AudioPlayer::stop()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	current = nullptr;
+	next = nullptr;
+	position = 0;
+	fading = nullptr;
+	fadeInLength = 0;
+	isEnded = false;
+	isNextReplayed = false;
+	isPaused_ = false;
+	currentLoadID = 0;
+	nextLoadID = 0;
+	events.clear();
+	currentPath.clear();
+	nextPath.clear();
+}
+
+void core::AudioPlayer::pause()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	isPaused_ = true;
+	startLatencyProbe("pause");
+}
+
+void core::AudioPlayer::resume()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	isPaused_ = false;
+	startLatencyProbe("resume");
+}
+
+void core::AudioPlayer::seek(Time time)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!current) {
+		return;
+	}
+	long double frame = time.asSeconds() * frequency;
+	Uint64 frameCount = current->length / frameSize;
+	position = frame <= 0 ? 0 : (frame >= frameCount ? frameCount : (Uint64)frame) * frameSize;
+	fading = nullptr; // ..the skipped music is played with full volume
+	fadeInLength = 0;
+	isEnded = false;
+	startLatencyProbe("seek");
+}
+
+void core::AudioPlayer::setVolume(float volume)
+{
+	this->volume = volume < 0 ? 0 : (volume > MIX_MAX_VOLUME ? MIX_MAX_VOLUME : volume);
+}
+
+void core::AudioPlayer::setCrossfade(Time duration, FadeCurve curve)
+{
+	long double frameCount = duration.asSeconds() * frequency;
+	std::lock_guard<std::mutex> lock(mutex);
+	crossfadeLength = frameCount <= 0 ? 0 : (Uint64)frameCount * frameSize;
+	fadeCurve = curve;
+}
+
+void core::AudioPlayer::setLatencyProbe(bool isEnabled)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	isLatencyProbed = isEnabled;
+	probeAction = nullptr;
+	probedAction = nullptr;
+}
+
+void core::AudioPlayer::update()
+{
+	std::vector<Track*> unusedTracks;
+	std::vector<std::string> polledLogMessages;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (probedAction) {
+			double callbackLatency = std::chrono::duration<double, std::milli>(probeMixTime - probeStartTime).count();
+			double bufferLatency = 1000.0 * probeBufferLength / frameSize / frequency;
+			std::ostringstream oss;
+			oss << std::fixed << std::setprecision(1) << "Latency probe (" << probedAction << "): " << callbackLatency << " ms till the audio callback + "
+				<< bufferLatency << " ms buffer = " << callbackLatency + bufferLatency << " ms";
+			polledLogMessages.push_back(oss.str());
+			probedAction = nullptr;
+		}
+		for (auto it = tracks.begin(); it != tracks.end();) {
+			if (*it != current && *it != next && *it != fading) {
+				if (*it == streaming) {
+					streaming = nullptr; // ..Mix_FreeMusic() halts it
+				}
+				unusedTracks.push_back(*it);
+				it = tracks.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		polledLogMessages.swap(logMessages);
+	}
+	// The audio callback only reaches music through 'current', 'next', 'fading' and 'streaming', so it can be freed without lock:
+	for (Track* track : unusedTracks) {
+		freeTrack(track);
+	}
+	for (auto& message : polledLogMessages) {
+		log(message);
+	}
+}
+
+bool core::AudioPlayer::pollEvent(Event& event)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (events.empty()) {
+			return false;
+		}
+		event = events.front();
+		events.erase(events.begin());
+	}
+	if (event == Event::NextStarted) {
+		currentPath = nextPath;
+		nextPath.clear();
+	}
+	return true;
+}
+
+const fs::path& core::AudioPlayer::getPath() const
+{
+	return currentPath;
+}
+
+core::Time core::AudioPlayer::getPosition() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!current || frameSize == 0) {
+		return Time();
+	}
+	long long frame = (long long)(position / frameSize);
+	return Time(Nanoseconds(frame * 1000000000 / frequency));
+}
+
+bool core::AudioPlayer::isPaused() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return isPaused_;
+}
+
+bool core::AudioPlayer::isStopped() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return (!current || isEnded) && currentLoadID == 0;
+}
+
+bool core::AudioPlayer::isNextLoaded() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return nextLoadID == 0;
+}
+
+void SDLCALL core::AudioPlayer::mix(void* userData, Uint8* stream, int length)
+{
+	AudioPlayer* player = (AudioPlayer*)userData;
+	std::lock_guard<std::mutex> lock(player->mutex);
+	if (player->probeAction) {
+		player->probeMixTime = std::chrono::steady_clock::now();
+		player->probeBufferLength = (Uint32)length;
+		player->probedAction = player->probeAction;
+		player->probeAction = nullptr;
+	}
+	player->bufferLength = (Uint32)length;
+	player->receiveStream(stream, (Uint32)length);
+	SDL_memset(stream, 0, length);
+	player->mixLocked(stream, length);
+	player->controlStream();
+}
+
+void core::AudioPlayer::mixLocked(Uint8* stream, int length)
+{
+	float volume = this->volume;
+	Uint32 streamLength = (Uint32)length;
+	Uint32 mixedLength = 0;
+	while (mixedLength < streamLength && current && !isEnded && !isPaused_) {
+		if (current->music) {
+			// After seek(), play() or a replay the music is decoded again, if 'position' is not decoded:
+			Uint64 decodedEnd = current->streamPosition + current->streamBuffer.size();
+			if (position < current->streamPosition || position > decodedEnd) {
+				restartStream(current, position);
+			}
+			else if (current->isStreamEnded || decodedEnd - position >= STREAM_START_COUNT * bufferLength) {
+				current->isStreamBuffering = false;
+			}
+			if (current->isStreamBuffering) {
+				break; // ..the rest of the buffer stays silent
+			}
+		}
+
+		Uint64 remainingLength = current->length - position;
+		Uint64 fadeOutLength = getFadeOutLength(current);
+		// The next music starts when the current one is faded out, if it lasts till the end of the crossfade (and SDL_mixer
+		// does not have to decode both):
+		bool isNextStreamed = next ? next->music != nullptr : current->music != nullptr;
+		if (!fading && remainingLength > 0 && remainingLength <= fadeOutLength && (next || isNextReplayed) && !(current->music && isNextStreamed)) {
+			Uint64 nextLength = next ? next->length : current->length;
+			if (nextLength >= remainingLength) {
+				fading = current;
+				fadingPosition = position;
+				startNext();
+				fadeInLength = remainingLength; // ..ends together with the fade out
+				continue;
+			}
+		}
+
+		Uint32 count = streamLength - mixedLength < remainingLength ? streamLength - mixedLength : (Uint32)remainingLength;
+		// ..stops at the start of the fade out, so that the crossfade starts at the exact sample:
+		if (!fading && remainingLength > fadeOutLength && remainingLength - fadeOutLength < count) {
+			count = (Uint32)(remainingLength - fadeOutLength);
+		}
+		Uint64 decodedLength = getDecodedLength(current, position);
+		if (decodedLength < count) {
+			count = (Uint32)decodedLength; // ..SDL_mixer did not decode the streamed music in time
+		}
+		if (count == 0 && !isTrackEnded(current, position)) {
+			break;
+		}
+		mixTrack(stream + mixedLength, current, position, count, fadeInLength, volume);
+		if (fading) {
+			Uint64 fadingLength = std::min({ fading->length - fadingPosition, (Uint64)count, getDecodedLength(fading, fadingPosition) });
+			mixTrack(stream + mixedLength, fading, fadingPosition, (Uint32)fadingLength, 0, volume);
+			fadingPosition += fadingLength;
+			discardStream(fading, fadingPosition);
+			if (fadingPosition >= fading->length) {
+				fading = nullptr;
+			}
+		}
+		position += count;
+		mixedLength += count;
+		discardStream(current, position);
+		if (isTrackEnded(current, position)) {
+			// The next music continues at the next sample of this buffer:
+			if (next || isNextReplayed) {
+				startNext();
+				fadeInLength = 0;
+			}
+			else {
+				isEnded = true;
+				events.push_back(Event::Ended);
+			}
+		}
+	}
+}
+
+void core::AudioPlayer::startNext()
+{
+	if (next) {
+		current = next;
+		next = nullptr;
+		if (!current->streamBuffer.empty()) {
+			current->isStreamBuffering = false; // ..a streamed music which is decoded ahead starts at once (waiting would be a gap)
+		}
+	}
+	isNextReplayed = false;
+	position = 0;
+	events.push_back(Event::NextStarted);
+}
+
+void core::AudioPlayer::mixTrack(Uint8* stream, const Track* track, Uint64 position, Uint32 length, Uint64 fadeInLength, float volume) const
+{
+	const Uint8* source = getSamples(track, position);
+	bool isFaded = position < fadeInLength || position + length > track->length - getFadeOutLength(track);
+	if (!isFaded && format == AUDIO_F32SYS) {
+		// SDL_MixAudioFormat() would round the volume to an integer:
+		float gain = volume / MIX_MAX_VOLUME;
+		float* out = (float*)stream;
+		const float* in = (const float*)source;
+		for (Uint32 i = 0; i < length / sizeof(float); ++i) {
+			float sample = out[i] + in[i] * gain;
+			out[i] = sample < -1.f ? -1.f : (sample > 1.f ? 1.f : sample);
+		}
+		return;
+	}
+	if (!isFaded) {
+		SDL_MixAudioFormat(stream, source, format, length, (int)(volume + 0.5f));
+		return;
+	}
+	// The gain changes with each sample, which SDL_MixAudioFormat() can not do. The sum is clamped like it does:
+	int channelCount = frameSize / (SDL_AUDIO_BITSIZE(format) / 8);
+	for (Uint32 offset = 0; offset < length; offset += frameSize) {
+		float gain = getFadeGain(track, position + offset, fadeInLength) * volume / MIX_MAX_VOLUME;
+		if (format == AUDIO_S16SYS) {
+			Sint16* out = (Sint16*)(stream + offset);
+			const Sint16* in = (const Sint16*)(source + offset);
+			for (int channel = 0; channel < channelCount; ++channel) {
+				float sample = out[channel] + in[channel] * gain;
+				out[channel] = (Sint16)(sample < -32768.f ? -32768.f : (sample > 32767.f ? 32767.f : sample));
+			}
+		}
+		else if (format == AUDIO_F32SYS) {
+			float* out = (float*)(stream + offset);
+			const float* in = (const float*)(source + offset);
+			for (int channel = 0; channel < channelCount; ++channel) {
+				float sample = out[channel] + in[channel] * gain;
+				out[channel] = sample < -1.f ? -1.f : (sample > 1.f ? 1.f : sample);
+			}
+		}
+		else {
+			SDL_MixAudioFormat(stream + offset, source + offset, format, frameSize, (int)(gain * MIX_MAX_VOLUME)); // ..other formats fade in volume steps
+		}
+	}
+}
+
+float core::AudioPlayer::getFadeGain(const Track* track, Uint64 position, Uint64 fadeInLength) const
+{
+	// Fading in and out use the same curve from 0 (silence) to 1, so the gains of a crossfade add up to 1 (linear) or their squares do (equal power):
+	auto applyCurve = [this](float x) { return fadeCurve == FadeCurve::EqualPower ? std::sin(x * 1.57079633f) : x; };
+	float gain = 1.f;
+	if (position < fadeInLength) {
+		gain *= applyCurve((float)position / fadeInLength);
+	}
+	Uint64 fadeOutLength = getFadeOutLength(track);
+	Uint64 remainingLength = track->length - position;
+	if (remainingLength < fadeOutLength) {
+		gain *= applyCurve((float)remainingLength / fadeOutLength);
+	}
+	return gain;
+}
+
+Uint64 core::AudioPlayer::getFadeOutLength(const Track* track) const
+{
+	if (!track->isLengthKnown) {
+		return 0;
+	}
+	return crossfadeLength < track->length ? crossfadeLength : track->length;
+}
+
+const Uint8* core::AudioPlayer::getSamples(const Track* track, Uint64 position) const
+{
+	if (track->chunk) {
+		return track->chunk->abuf + position;
+	}
+	return track->streamBuffer.data() + (position - track->streamPosition);
+}
+
+Uint64 core::AudioPlayer::getDecodedLength(const Track* track, Uint64 position) const
+{
+	if (track->chunk) {
+		return track->chunk->alen - position;
+	}
+	return track->streamPosition + track->streamBuffer.size() - position;
+}
+
+bool core::AudioPlayer::isTrackEnded(const Track* track, Uint64 position) const
+{
+	return position >= track->length && (track->chunk || track->isStreamEnded);
+}
+
+void core::AudioPlayer::receiveStream(const Uint8* stream, Uint32 length)
+{
+	bool isFinished = isMusicFinished.exchange(false);
+	if (!streaming || isStreamPaused) {
+		return; // ..SDL_mixer did not decode anything
+	}
+	std::vector<Uint8>& buffer = streaming->streamBuffer;
+	size_t receivedBegin = buffer.size();
+	buffer.insert(buffer.end(), stream, stream + length);
+	if (isFinished) {
+		// The music ended in this buffer (or at the end of the previous one) and SDL_mixer left the rest silent. The end is
+		// the position at which SDL_mixer finished the music; a codec which can not tell it keeps the silence:
+		Uint64 receivedEnd = streaming->streamPosition + buffer.size();
+		Uint64 end = receivedEnd;
+		double endTime = Mix_GetMusicPosition(streaming->music);
+		if (endTime >= 0) {
+			Uint64 endFrame = (Uint64)std::llround(endTime * frequency);
+			end = std::clamp<Uint64>(endFrame * frameSize, streaming->streamPosition + receivedBegin, receivedEnd);
+		}
+		buffer.resize((size_t)(end - streaming->streamPosition));
+		streaming->isStreamEnded = true;
+		streaming->length = end;
+		streaming->isStreamStarted = false;
+		streaming = nullptr;
+		return;
+	}
+	Uint64 decodedEnd = streaming->streamPosition + buffer.size();
+	if (streaming->length < decodedEnd) {
+		streaming->length = decodedEnd; // ..Mix_MusicDuration() was too short
+	}
+}
+
+void core::AudioPlayer::controlStream()
+{
+	// SDL_mixer decodes one music at a time: the streamed music which is played, else the next one is decoded ahead:
+	auto isDecoded = [](const Track* track) { return track && track->music && !track->isStreamEnded; };
+	Track* track = isDecoded(fading) ? fading : (isDecoded(current) ? current : (isDecoded(next) ? next : nullptr));
+	if (!track) {
+		if (streaming) {
+			streaming->isStreamStarted = false;
+			streaming = nullptr;
+			Mix_HaltMusic();
+			isMusicFinished = false;
+		}
+		return;
+	}
+	if (track != streaming || !track->isStreamStarted) {
+		if (streaming) {
+			streaming->isStreamStarted = false; // ..continues at the end of its buffer, when it is decoded again
+		}
+		// Mix_PlayMusic() may be called from the audio callback (see Mix_HookMusicFinished()); the decoding starts with the next buffer:
+		Uint64 decodedEnd = track->streamPosition + track->streamBuffer.size();
+		bool isStarted = Mix_PlayMusic(track->music, 0) == 0;
+		if (isStarted && decodedEnd > 0 && Mix_SetMusicPosition((double)(decodedEnd / frameSize) / frequency) != 0) {
+			// ..e.g. MIDI can not seek, so it starts again:
+			track->streamBuffer.clear();
+			track->streamPosition = 0;
+			if (track == current) {
+				position = 0;
+			}
+		}
+		Mix_ResumeMusic();
+		isStreamPaused = false;
+		isMusicFinished = false; // ..Mix_PlayMusic() halted the previous music
+		if (!isStarted) {
+			logMessages.push_back("Error: Music (" + track->path.u8string() + ") can not be streamed! SDL_mixer Error: " + Mix_GetError());
+			track->isStreamEnded = true;
+			track->length = decodedEnd;
+			streaming = nullptr;
+			return;
+		}
+		track->isStreamStarted = true;
+		streaming = track;
+	}
+	// The decoding pauses while enough is decoded ahead, e.g. while the music is paused or is the next one:
+	bool isFull = streaming->streamBuffer.size() >= STREAM_BUFFER_COUNT * bufferLength;
+	if (isFull != isStreamPaused) {
+		if (isFull) {
+			Mix_PauseMusic();
+		}
+		else {
+			Mix_ResumeMusic();
+		}
+		isStreamPaused = isFull;
+	}
+}
+
+void core::AudioPlayer::restartStream(Track* track, Uint64 position)
+{
+	track->streamBuffer.clear();
+	track->streamPosition = position;
+	track->isStreamStarted = false;
+	track->isStreamBuffering = true;
+	track->isStreamEnded = false;
+}
+
+void core::AudioPlayer::discardStream(Track* track, Uint64 position)
+{
+	if (!track->music || position <= track->streamPosition) {
+		return;
+	}
+	track->streamBuffer.erase(track->streamBuffer.begin(), track->streamBuffer.begin() + (size_t)(position - track->streamPosition));
+	track->streamPosition = position;
+}
+
+void SDLCALL core::AudioPlayer::onMusicFinished()
+{
+	isMusicFinished = true;
+}
+
+void core::AudioPlayer::freeTrack(Track* track)
+{
+	if (track->chunk) {
+		Mix_FreeChunk(track->chunk);
+	}
+	if (track->music) {
+		Mix_FreeMusic(track->music); // ..halts it, if SDL_mixer still decodes it
+	}
+	delete track;
+}
+
+void core::AudioPlayer::startLatencyProbe(const char* action)
+{
+	if (isLatencyProbed) {
+		probeAction = action;
+		probeStartTime = std::chrono::steady_clock::now();
+	}
+}
+
+void core::AudioPlayer::runLoader()
+{
+	while (isRunning) {
+		int loadID = 0;
+		fs::path loadPath;
+		bool isCurrent = false;
+		Uint32 reservedLength = 0;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() {
+				return !isRunning || (currentLoadID != 0 && currentLoadID != loadingID) || (nextLoadID != 0 && nextLoadID != loadingID);
+			});
+			if (!isRunning) {
+				break;
+			}
+			// The current music is loaded first:
+			loadID = currentLoadID != 0 && currentLoadID != loadingID ? currentLoadID : nextLoadID;
+			loadPath = loadID == currentLoadID ? currentLoadPath : nextLoadPath;
+			isCurrent = loadID == currentLoadID;
+			loadingID = loadID;
+			reservedLength = (STREAM_BUFFER_COUNT + 1) * bufferLength;
+		}
+
+		// The current music is streamed, so that it starts without decoding it completely. The next music is decoded
+		// completely, if it is not too long, so that it can be crossfaded with a streamed current music:
+		Mix_Music* music = nullptr;
+		Mix_Chunk* chunk = nullptr;
+		double duration = -1.0;
+		{
+			std::lock_guard<std::mutex> loadLock(getMixerLoadMutex()); // ..the LibraryScanner may load music at the same time
+			music = Mix_LoadMUS(loadPath.u8string().c_str());
+			duration = music ? Mix_MusicDuration(music) : -1.0;
+			if (music && !isCurrent && duration > 0 && duration * frequency * frameSize <= MAX_DECODED_LENGTH) {
+				Mix_FreeMusic(music);
+				music = nullptr;
+				chunk = Mix_LoadWAV(loadPath.u8string().c_str());
+			}
+		}
+		std::string error = chunk || music ? "" : Mix_GetError();
+		Track* track = nullptr;
+		if (chunk || music) {
+			track = new Track{ loadPath, chunk, music }; // freed by update(), if it is not wanted anymore
+			if (chunk) {
+				track->length = chunk->alen;
+			}
+			else {
+				track->isLengthKnown = duration > 0;
+				track->length = duration > 0 ? (Uint64)std::llround(duration * frequency) * frameSize : SDL_MAX_UINT64;
+				track->streamBuffer.reserve(reservedLength);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		loadingID = 0;
+		if (!track) {
+			logMessages.push_back("Error: Music (" + loadPath.u8string() + ") can not be loaded! SDL_mixer Error: " + error);
+			if (loadID == currentLoadID) {
+				currentLoadID = 0; // ..is stopped
+				events.push_back(Event::Ended);
+			}
+			if (loadID == nextLoadID) {
+				nextLoadID = 0;
+			}
+			continue;
+		}
+		tracks.push_back(track);
+		if (loadID == currentLoadID) {
+			current = track;
+			currentLoadID = 0;
+			position = 0;
+			isEnded = false;
+		}
+		else if (loadID == nextLoadID) {
+			next = track;
+			nextLoadID = 0;
+		}
+	}
+}
@@ -11,6 +11,15 @@
 
 const size_t core::DrawableList::NOINDEX = -1;
 
+int core::DrawableList::RowProvider::getMaxLength(size_t columnIndex) const
+{
+	int maxLength = 0;
+	for (size_t i = 0; i < size(); ++i) {
+		maxLength = std::max(maxLength, (int)getRow(i).at(columnIndex).length());
+	}
+	return maxLength;
+}
+
 void core::DrawableList::init(InitInfo info)
 {
 	this->name = info.name;
@@ -27,6 +36,7 @@ void core::DrawableList::init(InitInfo info)
 	startDrawIndex = 0;
 	hasFocus_ = true;
 	paddingX = 2;
+	isLayoutOutdated = false;
 
 	if (columnLayout.empty()) {
 		// Set number column:
@@ -59,6 +69,7 @@ void core::DrawableList::init(InitInfo info)
 void core::DrawableList::terminate()
 {
 	list.clear();
+	rowProvider = nullptr;
 	startDrawIndex = 0;
 	hover = 0;
 	posX = 0;
@@ -75,8 +86,6 @@ void core::DrawableList::update()
 	if (!hasFocus_) {
 		return;
 	}
-
-	// TODO: initList every few seconds... maybe in another thread.
 }
 
 void core::DrawableList::handleEvent()
@@ -119,13 +128,13 @@ void core::DrawableList::move(bool up)
 				isTrappedOnTop_ = true;
 			}
 
-			if (startDrawIndex > 0 && hover < list.size() - sizeInside.y && drawnItemsSelectionPos == 0)
+			if (startDrawIndex > 0 && hover < size() - sizeInside.y && drawnItemsSelectionPos == 0)
 				--startDrawIndex;
 			if (drawnItemsSelectionPos > 0)
 				--drawnItemsSelectionPos;
 		}
 		else {
-			if (hover < list.size() - 1) {
+			if (hover < size() - 1) {
 				++hover;
 				isTrappedOnTop_ = false;
 			}
@@ -133,7 +142,7 @@ void core::DrawableList::move(bool up)
 				isTrappedOnBottom_ = true;
 			}
 
-			if (startDrawIndex < list.size() - sizeInside.y && hover >= sizeInside.y && drawnItemsSelectionPos == sizeInside.y - 1)
+			if (startDrawIndex < size() - sizeInside.y && hover >= sizeInside.y && drawnItemsSelectionPos == sizeInside.y - 1)
 				++startDrawIndex;
 			if (drawnItemsSelectionPos < sizeInside.y - 1)
 				++drawnItemsSelectionPos;
@@ -147,7 +156,7 @@ void core::DrawableList::move(bool up)
 				--startDrawIndex;
 		}
 		else {
-			if (startDrawIndex < list.size() - sizeInside.y)
+			if (startDrawIndex < size() - sizeInside.y)
 				++startDrawIndex;
 		}
 	}
@@ -157,10 +166,11 @@ void core::DrawableList::draw()
 {
 	PROFILE_FUNC
 
-	if (isFirstDraw) {
+	if (isFirstDraw || isLayoutOutdated) {
 		// Make sure everything is updated:
 		calcColumnRawLength();
 		isFirstDraw = false;
+		isLayoutOutdated = false;
 	}
 
 	drawBorder(true);
@@ -169,7 +179,7 @@ void core::DrawableList::draw()
 	if (sizeInside.y <= 0) {
 		// do nothing (but can cause an error if used bellow.)
 	}
-	else if (list.empty()) {
+	else if (size() == 0) {
 		std::cout << std::string(posX, ' ') << "Nothing found!" << core::endl();
 	}
 	else {
@@ -179,7 +189,7 @@ void core::DrawableList::draw()
 		
 
 		// Prepare drawing empty rows:
-		if (hasFlag(Options::YSizeFitItemCount, options) && list.size() < sizeInside.y) {
+		if (hasFlag(Options::YSizeFitItemCount, options) && size() < sizeInside.y) {
 			// TODO
 		}
 
@@ -187,7 +197,7 @@ void core::DrawableList::draw()
 		core::Text columnText("");
 		std::stringstream ss;
 		bool colorState = true;
-		int drawnItemCount = list.size() < sizeInside.y ? list.size() : sizeInside.y;
+		int drawnItemCount = size() < sizeInside.y ? size() : sizeInside.y;
 		for (size_t i = startDrawIndex; i < startDrawIndex + drawnItemCount; ++i, colorState = !colorState) 
 		{
 			// Draw left border:
@@ -204,7 +214,8 @@ void core::DrawableList::draw()
 				if (column.isVisible && column._rawLength > 0)
 					++endColumnIndex;
 			}
-			list[i].insert(list[i].begin(), std::to_string(i + 1)); // because first column is for item numbers and thats not inside ScrollableList::list - its kinda virtual.
+			Row row = getRow(i);
+			row.insert(row.begin(), std::to_string(i + 1)); // because first column is for item numbers and thats not inside ScrollableList::list - its kinda virtual.
 			for (int j = 0; j < (int)columnLayout.size(); ++j)
 			{
 				if (!columnLayout[j].isVisible) {
@@ -213,12 +224,12 @@ void core::DrawableList::draw()
 
 				// (1) Set column text:
 				{
-					std::string str = list[i][j].substr(0, columnLayout[j]._rawLength); // core::toStr(core::toWStr(list[i][j]).substr(0, columnLayout[j]._rawLength));
+					std::string str = row[j].substr(0, columnLayout[j]._rawLength); // core::toStr(core::toWStr(row[j]).substr(0, columnLayout[j]._rawLength));
 					
-					if (str.length() >= 2 && list[i][j].length() > columnLayout[j]._rawLength) {
+					if (str.length() >= 2 && row[j].length() > columnLayout[j]._rawLength) {
 						str.replace(str.length() - 2, 2, "..");
 					}
-					else if (list[i][j].length() < columnLayout[j]._rawLength) {
+					else if (row[j].length() < columnLayout[j]._rawLength) {
 						// ..fill left over space, so column aligns nicely
 						// Attention - just let it be and do it bellow.
 						// The string length is unknown, because there are utf8 strings which return a wrong size like "이루마". Its 3, but 6 on the console.
@@ -245,8 +256,8 @@ void core::DrawableList::draw()
 					bool isFirstDrawn = i == startDrawIndex;
 					bool isFirstItem = i == 0;
 					bool isLastDrawn = i == LAST_DRAWN_ITEM_INDEX;
-					bool isLastItem = i == list.size() - 1;
-					if (((isFirstDrawn && !isFirstItem) || (isLastDrawn && !isLastItem)) && list.size() > sizeInside.y) {
+					bool isLastItem = i == size() - 1;
+					if (((isFirstDrawn && !isFirstItem) || (isLastDrawn && !isLastItem)) && size() > sizeInside.y) {
 						// ...drawn item is at the top or bottom, but you can scroll higher or lower.
 						columnText.fgcolor = style.borderItem;
 						columnText.bgcolor = core::Color::None;
@@ -282,7 +293,6 @@ void core::DrawableList::draw()
 					std::cout << core::Text(std::string(spaceBetweenColumns, ' '), core::Color::None, columnText.bgcolor);
 				}
 			}
-			list[i].erase(list[i].begin());
 
 			// Padding:
 			// You could just do: 'std::cout << std::string(paddingX, ' ');', but that below is better for debugging.
@@ -302,11 +312,11 @@ void core::DrawableList::draw()
 			//   2. scrollbarSize: How large the scrollbar needs to be.
 			//   3. scrollbarTop_itemIndex, scrollbarBottom_itemIndex: Start draw position and end draw position on the y axis.
 			int middleDrawnItemIndex = round(startDrawIndex + sizeInside.y / 2.f); // using 'hover' is a bit of a strange behaviour comparedc to websites, but 'middleDrawnItemIndex' causes sometimes the scrollbar to not completly scroll down..
-			float scrollbarPosFactor = hover / (float)list.size(); // 0..1; middleDrawnItemIndex or hover
+			float scrollbarPosFactor = hover / (float)size(); // 0..1; middleDrawnItemIndex or hover
 			float scrollbarOriginPosRaw = (drawnItemCount - 1) * scrollbarPosFactor; // 0..drawnItemCount-1; Position if scrollbarSize==1
-			int scrollbarOriginPos = (startDrawIndex + scrollbarOriginPosRaw) > list.size() / 2.f ? round(scrollbarOriginPosRaw) : scrollbarOriginPosRaw;
+			int scrollbarOriginPos = (startDrawIndex + scrollbarOriginPosRaw) > size() / 2.f ? round(scrollbarOriginPosRaw) : scrollbarOriginPosRaw;
 			// (sizeInside.y-1): This is neccessray, because we want 'sizeInside.y' positions (0..MDI-1) and not 'sizeInside.y+1' positions.
-			float scrollbarSizeFactor = drawnItemCount / (float)list.size();
+			float scrollbarSizeFactor = drawnItemCount / (float)size();
 			int scrollbarSize = std::clamp((int)round(sizeInside.y * scrollbarSizeFactor), 1, drawnItemCount); // min: 1, max: drawnItemCount
 			float scrollbarHalfSize = scrollbarSize / 2.f; // We try to draw half before 'i' and the other half after. If the result can not be cast to int, then
 														   // before or after element 'i' needs to be one more [(int)2.5=2, (int)round(2.5)=3].
@@ -340,7 +350,7 @@ void core::DrawableList::draw()
 
 int core::DrawableList::getItemNumberDrawSize() const
 {
-	return std::to_string(list.size()).length();
+	return std::to_string(size()).length();
 }
 
 void core::DrawableList::drawBorder(bool isTop) const
@@ -374,14 +384,90 @@ void core::DrawableList::onConsoleResize()
 	calcColumnRawLength(); // call this after sizeInside is updated
 }
 
+void core::DrawableList::setName(std::string name)
+{
+	this->name = name;
+}
+
 void core::DrawableList::clear()
 {
 	list.clear();
+	isLayoutOutdated = true;
 }
 
 void core::DrawableList::push_back(Row item)
 {
 	list.push_back(item);
+	isLayoutOutdated = true;
+}
+
+void core::DrawableList::erase(size_t index)
+{
+	assert(index < list.size());
+	list.erase(list.begin() + index);
+	onRowErased(index);
+}
+
+void core::DrawableList::set(size_t index, Row item)
+{
+	list.at(index) = item;
+	isLayoutOutdated = true;
+}
+
+void core::DrawableList::setRowProvider(const RowProvider* rowProvider)
+{
+	this->rowProvider = rowProvider;
+	list.clear();
+	isLayoutOutdated = true;
+}
+
+void core::DrawableList::onRowsChanged()
+{
+	isLayoutOutdated = true;
+}
+
+void core::DrawableList::onRowErased(size_t index)
+{
+	if (selected == index) {
+		selected = NOINDEX;
+	}
+	else if (selected != NOINDEX && selected > index) {
+		--selected;
+	}
+	if (hover > 0 && (hover > index || hover == size())) {
+		--hover;
+	}
+	// Do not draw empty rows at the bottom if there are items above:
+	if (startDrawIndex > 0 && startDrawIndex + sizeInside.y > size()) {
+		--startDrawIndex;
+	}
+	if (hover < startDrawIndex) {
+		startDrawIndex = hover;
+	}
+	drawnItemsSelectionPos = hover - startDrawIndex;
+	isLayoutOutdated = true;
+}
+
+void core::DrawableList::onRowMoved(size_t from, size_t to)
+{
+	auto getMovedIndex = [&](size_t index) {
+		if (index == from)                   return to;
+		if (from < index && index <= to)     return index - 1;
+		if (to <= index && index < from)     return index + 1;
+		return index;
+	};
+	if (selected != NOINDEX) {
+		selected = getMovedIndex(selected);
+	}
+	hover = getMovedIndex(hover);
+	// Keep the hovered item visible:
+	if (hover < startDrawIndex) {
+		startDrawIndex = hover;
+	}
+	else if (hover >= startDrawIndex + sizeInside.y) {
+		startDrawIndex = hover - sizeInside.y + 1;
+	}
+	drawnItemsSelectionPos = hover - startDrawIndex;
 }
 
 void core::DrawableList::calcColumnRawLength()
@@ -399,6 +485,9 @@ void core::DrawableList::calcColumnRawLength()
 				// ..item number column is a virtual column and the first.
 				columnLayout[i]._rawLength = getItemNumberDrawSize();
 			}
+			else if (rowProvider) {
+				columnLayout[i]._rawLength = rowProvider->getMaxLength(i - 1); // -1 because the rows do not have the virtual column
+			}
 			else {
 				int maxLength = 0;
 				for (const Row& row : list) {
@@ -525,7 +614,7 @@ void core::DrawableList::scrollToTop()
 
 size_t core::DrawableList::size() const
 {
-	return list.size();
+	return rowProvider ? rowProvider->size() : list.size();
 }
 
 size_t core::DrawableList::getSelectedIndex() const
@@ -536,7 +625,7 @@ size_t core::DrawableList::getSelectedIndex() const
 core::DrawableList::Row core::DrawableList::getSelected() const
 {
 	assert(selected != NOINDEX);
-	return list.at(selected);
+	return getRow(selected);
 }
 
 size_t core::DrawableList::getHoverIndex() const
@@ -548,11 +637,12 @@ size_t core::DrawableList::getHoverIndex() const
 core::DrawableList::Row core::DrawableList::getHover() const
 {
 	assert(hover != NOINDEX);
-	return list.at(hover);
+	return getRow(hover);
 }
 
 const std::vector<core::DrawableList::Row>& core::DrawableList::get() const
 {
+	assert(!rowProvider);
 	return list;
 }
 
@@ -588,4 +678,9 @@ bool core::DrawableList::isTrappedOnBottom() const
 bool core::DrawableList::hasFocus() const
 {
 	return hasFocus_;
+}
+
+core::DrawableList::Row core::DrawableList::getRow(size_t index) const
+{
+	return rowProvider ? rowProvider->getRow(index) : list.at(index);
 }
\ No newline at end of file
@@ -0,0 +1,487 @@
+#include "core/LibraryIndex.hpp"
+#include "core/MusicLibrary.hpp"
+#include "core/SmallTools.hpp"
+#include <fstream>
+#include <map>
+#include <unordered_map>
+#include <cstring>
+#include <Windows.h>
+
+/*
+	File layout (native byte order, every section starts 8 byte aligned):
+	- Header
+	- Track[trackCount]
+	- StringRef[internedCount]                          artists and albums; Track::artistId and Track::albumId are indices
+	- DirectoryRecord[directoryCount]                   sorted by path; each path ends with a separator
+	- uint32[directoryEntryCount]                       music indices of the directories
+	- PlaylistRecord[playlistCount]
+	- uint32[playlistEntryCount]                        music indices of the playlists
+	- uint32[pathSlotCount]                             music index or EMPTY_SLOT; linear probing with hashPath()
+	- char[stringsSize]                                 utf-8 strings; StringRef::offset is relative to the section
+*/
+static const char     INDEX_MAGIC[4] = { 'C', 'M', 'P', 'I' };
+static const uint32_t INDEX_VERSION  = 1;
+static const uint32_t EMPTY_SLOT     = 0xFFFFFFFF;
+static const uint32_t TRACK_REMOVED  = 1 << 0; //< Track::flags
+
+struct core::LibraryIndex::StringRef
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct core::LibraryIndex::Header
+{
+	char     magic[4];
+	uint32_t version;
+	uint64_t fileSize;
+	uint32_t trackCount;
+	uint32_t removedCount;
+	uint32_t internedCount;
+	uint32_t directoryCount;
+	uint32_t directoryEntryCount;
+	uint32_t playlistCount;
+	uint32_t playlistEntryCount;
+	uint32_t pathSlotCount; //< power of two
+	uint64_t tracksOffset;
+	uint64_t internedOffset;
+	uint64_t directoriesOffset;
+	uint64_t directoryEntriesOffset;
+	uint64_t playlistsOffset;
+	uint64_t playlistEntriesOffset;
+	uint64_t pathSlotsOffset;
+	uint64_t stringsOffset;
+	uint64_t stringsSize;
+};
+
+struct core::LibraryIndex::Track
+{
+	int64_t   duration;      //< nanoseconds
+	uint64_t  fileSize;
+	int64_t   lastWriteTime;
+	StringRef title;
+	StringRef path;
+	uint32_t  artistId;
+	uint32_t  albumId;
+	uint32_t  flags;
+	uint32_t  reserved;
+};
+
+struct core::LibraryIndex::DirectoryRecord
+{
+	StringRef path;
+	uint32_t  firstEntry;
+	uint32_t  entryCount;
+};
+
+struct core::LibraryIndex::PlaylistRecord
+{
+	StringRef name;
+	uint64_t  fileSize;
+	int64_t   lastWriteTime;
+	uint32_t  firstEntry;
+	uint32_t  entryCount;
+};
+
+/** FNV-1a, because std::hash may differ between builds and the hash is stored in the file. */
+intern uint64_t hashPath(std::string_view path)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : path) {
+		hash ^= (unsigned char)c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+intern bool isSectionValid(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize)
+{
+	return offset % 8 == 0 && offset <= fileSize && count <= (fileSize - offset) / elementSize;
+}
+
+core::LibraryIndex::~LibraryIndex()
+{
+	close();
+}
+
+bool core::LibraryIndex::open(const fs::path& filePath)
+{
+	close();
+
+	HANDLE file = CreateFileW(filePath.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false; // ..first start
+	}
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header)) {
+		CloseHandle(file);
+		log("Warning: Library index (" + filePath.u8string() + ") is corrupted and will be rebuilt.");
+		return false;
+	}
+	// The mapping keeps the file open, so the file handle is not needed anymore. FILE_SHARE_DELETE allows to rename the file while it is mapped.
+	mappingHandle = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mappingHandle) {
+		log("Error: Library index (" + filePath.u8string() + ") could not be mapped (error " + std::to_string(GetLastError()) + ").");
+		return false;
+	}
+	data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		log("Error: Library index (" + filePath.u8string() + ") could not be mapped (error " + std::to_string(GetLastError()) + ").");
+		close();
+		return false;
+	}
+	dataSize = (size_t)fileSize.QuadPart;
+	header   = reinterpret_cast<const Header*>(data);
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Check header
+	///////////////////////////////////////////////////////////////////////////////
+	if (std::memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header->version != INDEX_VERSION) {
+		log("Warning: Library index (" + filePath.u8string() + ") is outdated and will be rebuilt.");
+		close();
+		return false;
+	}
+	bool isValid = header->fileSize == dataSize
+		&& header->removedCount <= header->trackCount
+		&& (header->pathSlotCount & (header->pathSlotCount - 1)) == 0
+		&& header->pathSlotCount >= header->trackCount
+		&& isSectionValid(header->tracksOffset,           header->trackCount,          sizeof(Track),           dataSize)
+		&& isSectionValid(header->internedOffset,         header->internedCount,       sizeof(StringRef),       dataSize)
+		&& isSectionValid(header->directoriesOffset,      header->directoryCount,      sizeof(DirectoryRecord), dataSize)
+		&& isSectionValid(header->directoryEntriesOffset, header->directoryEntryCount, sizeof(uint32_t),        dataSize)
+		&& isSectionValid(header->playlistsOffset,        header->playlistCount,       sizeof(PlaylistRecord),  dataSize)
+		&& isSectionValid(header->playlistEntriesOffset,  header->playlistEntryCount,  sizeof(uint32_t),        dataSize)
+		&& isSectionValid(header->pathSlotsOffset,        header->pathSlotCount,       sizeof(uint32_t),        dataSize)
+		&& isSectionValid(header->stringsOffset,          header->stringsSize,         sizeof(char),            dataSize);
+	if (!isValid) {
+		log("Warning: Library index (" + filePath.u8string() + ") is corrupted and will be rebuilt.");
+		close();
+		return false;
+	}
+	return true;
+}
+
+void core::LibraryIndex::close()
+{
+	if (data) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle) {
+		CloseHandle(mappingHandle);
+	}
+	mappingHandle = nullptr;
+	data          = nullptr;
+	dataSize      = 0;
+	header        = nullptr;
+}
+
+bool core::LibraryIndex::write(const fs::path& filePath, const MusicLibrary& library, const std::vector<Playlist>& playlists, bool isCompacted)
+{
+	///////////////////////////////////////////////////////////////////////////////
+	// Collect
+	///////////////////////////////////////////////////////////////////////////////
+	std::string strings;
+	auto addString = [&strings](std::string_view str) {
+		StringRef stringRef = { (uint32_t)strings.size(), (uint32_t)str.size() };
+		strings.append(str);
+		return stringRef;
+	};
+	std::vector<StringRef> interned;
+	std::unordered_map<std::string_view, uint32_t> internedIds; // views into 'library', which does not change while writing
+	auto internString = [&](std::string_view str) {
+		auto [it, isInserted] = internedIds.emplace(str, (uint32_t)interned.size());
+		if (isInserted) {
+			interned.push_back(addString(str));
+		}
+		return it->second;
+	};
+
+	// Tracks:
+	std::vector<int> newMusicIndices(library.size(), -1); // only differs from the library if compacted
+	std::vector<Track> tracks;
+	tracks.reserve(library.size());
+	uint32_t removedCount = 0;
+	for (int musicIndex = 0; musicIndex < (int)library.size(); ++musicIndex) {
+		bool isRemoved = library.isRemoved(musicIndex);
+		if (isRemoved && isCompacted) {
+			continue;
+		}
+		newMusicIndices[musicIndex] = (int)tracks.size();
+		Track track = {};
+		track.duration      = library.getDuration(musicIndex).asNanoSeconds();
+		track.fileSize      = library.getFileSize(musicIndex);
+		track.lastWriteTime = library.getLastWriteTime(musicIndex);
+		track.title         = addString(library.getTitle(musicIndex));
+		track.path          = addString(library.getPathStr(musicIndex));
+		track.artistId      = internString(library.getArtist(musicIndex));
+		track.albumId       = internString(library.getAlbum(musicIndex));
+		track.flags         = isRemoved ? TRACK_REMOVED : 0;
+		removedCount       += isRemoved ? 1 : 0;
+		tracks.push_back(track);
+	}
+
+	// Directories:
+	std::map<std::string, std::vector<uint32_t>> musicIndicesByDirectory; // key: path with trailing separator; sorted, so that all subdirectories of a directory are next to each other
+	for (uint32_t i = 0; i < (uint32_t)tracks.size(); ++i) {
+		std::string_view path(strings.data() + tracks[i].path.offset, tracks[i].path.length);
+		size_t separatorPos = path.find_last_of("\\/");
+		musicIndicesByDirectory[std::string(path.substr(0, separatorPos == std::string_view::npos ? 0 : separatorPos + 1))].push_back(i);
+	}
+	std::vector<DirectoryRecord> directories;
+	std::vector<uint32_t> directoryEntries;
+	directoryEntries.reserve(tracks.size());
+	for (auto& [path, musicIndices] : musicIndicesByDirectory) {
+		directories.push_back({ addString(path), (uint32_t)directoryEntries.size(), (uint32_t)musicIndices.size() });
+		directoryEntries.insert(directoryEntries.end(), musicIndices.begin(), musicIndices.end());
+	}
+
+	// Playlists:
+	std::vector<PlaylistRecord> playlistRecords;
+	std::vector<uint32_t> playlistEntries;
+	for (auto& playlist : playlists) {
+		PlaylistRecord record = {};
+		record.name          = addString(playlist.name);
+		record.fileSize      = playlist.fileSize;
+		record.lastWriteTime = playlist.lastWriteTime;
+		record.firstEntry    = (uint32_t)playlistEntries.size();
+		for (int musicIndex : playlist.musicIndexList) {
+			if (newMusicIndices[musicIndex] != -1) {
+				playlistEntries.push_back((uint32_t)newMusicIndices[musicIndex]);
+			}
+		}
+		record.entryCount = (uint32_t)playlistEntries.size() - record.firstEntry;
+		playlistRecords.push_back(record);
+	}
+
+	// Path table (at most half full, so that probing stays short):
+	uint32_t pathSlotCount = 16;
+	while (pathSlotCount < tracks.size() * 2) {
+		pathSlotCount *= 2;
+	}
+	std::vector<uint32_t> pathSlots(pathSlotCount, EMPTY_SLOT);
+	for (uint32_t i = 0; i < (uint32_t)tracks.size(); ++i) {
+		if (tracks[i].flags & TRACK_REMOVED) {
+			continue;
+		}
+		size_t slot = hashPath(std::string_view(strings.data() + tracks[i].path.offset, tracks[i].path.length)) & (pathSlotCount - 1);
+		while (pathSlots[slot] != EMPTY_SLOT) {
+			slot = (slot + 1) & (pathSlotCount - 1);
+		}
+		pathSlots[slot] = i;
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Write
+	///////////////////////////////////////////////////////////////////////////////
+	Header header = {};
+	std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	header.version             = INDEX_VERSION;
+	header.trackCount          = (uint32_t)tracks.size();
+	header.removedCount        = removedCount;
+	header.internedCount       = (uint32_t)interned.size();
+	header.directoryCount      = (uint32_t)directories.size();
+	header.directoryEntryCount = (uint32_t)directoryEntries.size();
+	header.playlistCount       = (uint32_t)playlistRecords.size();
+	header.playlistEntryCount  = (uint32_t)playlistEntries.size();
+	header.pathSlotCount       = pathSlotCount;
+	header.stringsSize         = strings.size();
+	uint64_t offset = sizeof(Header);
+	auto placeSection = [&offset](uint64_t& sectionOffset, uint64_t byteCount) {
+		offset = (offset + 7) & ~7ull;
+		sectionOffset = offset;
+		offset += byteCount;
+	};
+	placeSection(header.tracksOffset,           tracks.size()           * sizeof(Track));
+	placeSection(header.internedOffset,         interned.size()         * sizeof(StringRef));
+	placeSection(header.directoriesOffset,      directories.size()      * sizeof(DirectoryRecord));
+	placeSection(header.directoryEntriesOffset, directoryEntries.size() * sizeof(uint32_t));
+	placeSection(header.playlistsOffset,        playlistRecords.size()  * sizeof(PlaylistRecord));
+	placeSection(header.playlistEntriesOffset,  playlistEntries.size()  * sizeof(uint32_t));
+	placeSection(header.pathSlotsOffset,        pathSlots.size()        * sizeof(uint32_t));
+	placeSection(header.stringsOffset,          strings.size());
+	header.fileSize = offset;
+
+	std::ofstream ofs(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!ofs) {
+		log("Error: Library index (" + filePath.u8string() + ") could not be written!");
+		return false;
+	}
+	auto writeSection = [&ofs](uint64_t sectionOffset, const void* sectionData, size_t byteCount) {
+		static const char padding[8] = {};
+		ofs.write(padding, sectionOffset - (uint64_t)ofs.tellp());
+		ofs.write(static_cast<const char*>(sectionData), byteCount);
+	};
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	writeSection(header.tracksOffset,           tracks.data(),           tracks.size()           * sizeof(Track));
+	writeSection(header.internedOffset,         interned.data(),         interned.size()         * sizeof(StringRef));
+	writeSection(header.directoriesOffset,      directories.data(),      directories.size()      * sizeof(DirectoryRecord));
+	writeSection(header.directoryEntriesOffset, directoryEntries.data(), directoryEntries.size() * sizeof(uint32_t));
+	writeSection(header.playlistsOffset,        playlistRecords.data(),  playlistRecords.size()  * sizeof(PlaylistRecord));
+	writeSection(header.playlistEntriesOffset,  playlistEntries.data(),  playlistEntries.size()  * sizeof(uint32_t));
+	writeSection(header.pathSlotsOffset,        pathSlots.data(),        pathSlots.size()        * sizeof(uint32_t));
+	writeSection(header.stringsOffset,          strings.data(),          strings.size());
+	if (!ofs) {
+		log("Error: Library index (" + filePath.u8string() + ") could not be written!");
+		return false;
+	}
+	return true;
+}
+
+size_t core::LibraryIndex::size() const
+{
+	return header ? header->trackCount : 0;
+}
+
+size_t core::LibraryIndex::getRemovedCount() const
+{
+	return header ? header->removedCount : 0;
+}
+
+size_t core::LibraryIndex::getFileSize() const
+{
+	return dataSize;
+}
+
+int core::LibraryIndex::find(std::string_view path) const
+{
+	if (!header || header->trackCount == 0) {
+		return -1;
+	}
+	const uint32_t* pathSlots = getSection<uint32_t>(header->pathSlotsOffset);
+	uint32_t mask = header->pathSlotCount - 1;
+	// The table is at most half full, so there is always an empty slot which ends the search.
+	for (uint32_t slot = hashPath(path) & mask, probeCount = 0; probeCount < header->pathSlotCount; slot = (slot + 1) & mask, ++probeCount) {
+		uint32_t musicIndex = pathSlots[slot];
+		if (musicIndex == EMPTY_SLOT || musicIndex >= header->trackCount) {
+			return -1;
+		}
+		if (getPath(musicIndex) == path) {
+			return musicIndex;
+		}
+	}
+	return -1;
+}
+
+bool core::LibraryIndex::isRemoved(int musicIndex) const
+{
+	return getTrack(musicIndex).flags & TRACK_REMOVED;
+}
+
+std::string_view core::LibraryIndex::getTitle(int musicIndex) const
+{
+	return getString(getTrack(musicIndex).title);
+}
+
+std::string_view core::LibraryIndex::getArtist(int musicIndex) const
+{
+	return getInternedString(getTrack(musicIndex).artistId);
+}
+
+std::string_view core::LibraryIndex::getAlbum(int musicIndex) const
+{
+	return getInternedString(getTrack(musicIndex).albumId);
+}
+
+std::string_view core::LibraryIndex::getPath(int musicIndex) const
+{
+	return getString(getTrack(musicIndex).path);
+}
+
+core::Time core::LibraryIndex::getDuration(int musicIndex) const
+{
+	return Time(Nanoseconds(getTrack(musicIndex).duration));
+}
+
+uintmax_t core::LibraryIndex::getMusicFileSize(int musicIndex) const
+{
+	return getTrack(musicIndex).fileSize;
+}
+
+long long core::LibraryIndex::getLastWriteTime(int musicIndex) const
+{
+	return getTrack(musicIndex).lastWriteTime;
+}
+
+core::MusicInfo core::LibraryIndex::getMusicInfo(int musicIndex) const
+{
+	MusicInfo musicInfo;
+	musicInfo.path          = fs::u8path(getPath(musicIndex));
+	musicInfo.title         = getTitle(musicIndex);
+	musicInfo.artist        = getArtist(musicIndex);
+	musicInfo.album         = getAlbum(musicIndex);
+	musicInfo.duration      = getDuration(musicIndex);
+	musicInfo.fileSize      = getMusicFileSize(musicIndex);
+	musicInfo.lastWriteTime = getLastWriteTime(musicIndex);
+	return musicInfo;
+}
+
+size_t core::LibraryIndex::getDirectoryCount() const
+{
+	return header ? header->directoryCount : 0;
+}
+
+core::LibraryIndex::Directory core::LibraryIndex::getDirectory(size_t directoryIndex) const
+{
+	const DirectoryRecord& record = getSection<DirectoryRecord>(header->directoriesOffset)[directoryIndex];
+	Directory directory = { getString(record.path), nullptr, 0 };
+	if ((uint64_t)record.firstEntry + record.entryCount <= header->directoryEntryCount) {
+		directory.musicIndices = getSection<uint32_t>(header->directoryEntriesOffset) + record.firstEntry;
+		directory.musicCount   = record.entryCount;
+	}
+	return directory;
+}
+
+bool core::LibraryIndex::findPlaylist(const std::string& name, uintmax_t fileSize, long long lastWriteTime, std::vector<int>& musicIndexList) const
+{
+	if (!header) {
+		return false;
+	}
+	const PlaylistRecord* records = getSection<PlaylistRecord>(header->playlistsOffset);
+	for (uint32_t i = 0; i < header->playlistCount; ++i) {
+		const PlaylistRecord& record = records[i];
+		if (getString(record.name) != name) {
+			continue;
+		}
+		if (record.fileSize != fileSize || record.lastWriteTime != lastWriteTime || (uint64_t)record.firstEntry + record.entryCount > header->playlistEntryCount) {
+			return false;
+		}
+		const uint32_t* entries = getSection<uint32_t>(header->playlistEntriesOffset) + record.firstEntry;
+		musicIndexList.clear();
+		musicIndexList.reserve(record.entryCount);
+		for (uint32_t j = 0; j < record.entryCount; ++j) {
+			if (entries[j] < header->trackCount) {
+				musicIndexList.push_back((int)entries[j]);
+			}
+		}
+		return true;
+	}
+	return false;
+}
+
+const core::LibraryIndex::Track& core::LibraryIndex::getTrack(int musicIndex) const
+{
+	return getSection<Track>(header->tracksOffset)[musicIndex];
+}
+
+std::string_view core::LibraryIndex::getString(const StringRef& stringRef) const
+{
+	if ((uint64_t)stringRef.offset + stringRef.length > header->stringsSize) {
+		return std::string_view();
+	}
+	return std::string_view(data + header->stringsOffset + stringRef.offset, stringRef.length);
+}
+
+std::string_view core::LibraryIndex::getInternedString(uint32_t id) const
+{
+	if (id >= header->internedCount) {
+		return std::string_view();
+	}
+	return getString(getSection<StringRef>(header->internedOffset)[id]);
+}
+
+template <typename T>
+const T* core::LibraryIndex::getSection(uint64_t offset) const
+{
+	return reinterpret_cast<const T*>(data + offset);
+}
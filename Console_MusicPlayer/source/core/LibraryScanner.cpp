@@ -0,0 +1,343 @@
+#include "core/LibraryScanner.hpp"
+#include "core/SmallTools.hpp"
+#include "core/Timer.hpp"
+#include "core/TagReader.hpp"
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <Windows.h>
+
+static const size_t BATCH_SIZE       = 256;       //< files which are probed and delivered at once
+static const DWORD  LIST_BUFFER_SIZE = 64 * 1024; //< bytes of directory entries which are listed per request
+
+/**
+ * The tags and the duration are read from the file headers (see TagReader). Only if that fails (e.g. MOD, MIDI),
+ * the music is opened with SDL_mixer, which is much slower, because it initializes the decoder.
+ */
+core::LibraryScanner::ProbeResult core::LibraryScanner::probe(const fs::path& musicFilePath)
+{
+	ProbeResult result;
+	result.isDecoded = false;
+	MusicInfo& musicInfo = result.musicInfo;
+	if (!tagReader::read(musicFilePath, musicInfo)) {
+		Mix_Music* music = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(getMixerLoadMutex()); // ..the workers and the AudioPlayer load music at the same time
+			music = Mix_LoadMUS(musicFilePath.u8string().c_str());
+		}
+		if (!music) {
+			result.error = "Failed to load music! SDL_mixer Error: " + std::string(Mix_GetError()); // SDL errors are stored per thread.
+			return result;
+		}
+		musicInfo.path     = musicFilePath;
+		musicInfo.title    = Mix_GetMusicTitleTag(music);
+		musicInfo.artist   = Mix_GetMusicArtistTag(music);
+		musicInfo.album    = Mix_GetMusicAlbumTag(music);
+		musicInfo.duration = Time(Nanoseconds((long long)(Mix_MusicDuration(music) * 1'000'000'000.0))); // IMPORTANT!: needs to be set once. IF this is called frequently, then the played music stutters!!!
+		Mix_FreeMusic(music);
+		result.isDecoded = true;
+	}
+
+	if (musicInfo.title.empty())  musicInfo.title  = musicFilePath.stem().u8string();
+	if (musicInfo.artist.empty()) musicInfo.artist = "unknown";
+	if (musicInfo.album.empty())  musicInfo.album  = "unknown";
+	return result;
+}
+
+std::vector<core::MusicInfo> core::LibraryScanner::scan(const std::vector<fs::path>& musicDirs, int threadCount /*= 0*/, const LibraryIndex* index /*= nullptr*/)
+{
+	std::vector<MusicInfo> musicInfoList;
+	scan(musicDirs, threadCount, index, [&musicInfoList](Batch&& batch) {
+		for (auto& message : batch.logMessages) {
+			log(message);
+		}
+		musicInfoList.insert(musicInfoList.end(), std::make_move_iterator(batch.musicInfoList.begin()), std::make_move_iterator(batch.musicInfoList.end()));
+	});
+	return musicInfoList;
+}
+
+void core::LibraryScanner::scan(const std::vector<fs::path>& musicDirs, int threadCount, const LibraryIndex* index, const BatchCallback& onBatch)
+{
+	stats = {};
+	isCanceled = false;
+	if (threadCount <= 0) {
+		threadCount = std::thread::hardware_concurrency() == 0 ? 1 : std::thread::hardware_concurrency();
+	}
+	stats.threadCount = threadCount;
+
+	Timer scanTimer;
+	std::vector<FileEntry> fileEntries;
+	Batch batch;
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Start workers
+	///////////////////////////////////////////////////////////////////////////////
+	// The workers are started once per scan and wait for the batches, so that no thread is created per batch.
+	// Each worker takes the next unprobed file of the batch and writes into its own slot, so no locking is required
+	// while probing and the slots keep the walk order.
+	std::mutex                 workerMutex;
+	std::condition_variable    batchStartedCondition;
+	std::condition_variable    batchFinishedCondition;
+	int                        batchID = 0;              //< is increased for each batch, which the workers have to probe
+	int                        finishedWorkerCount = 0;  //< workers which finished the current batch
+	bool                       isScanFinished = false;
+	std::vector<ProbeResult>*  batchResults = nullptr;
+	const std::vector<size_t>* batchProbeIndices = nullptr;
+	std::atomic<size_t>        nextIndex = 0;
+	auto probeBatch = [&]() {
+		for (size_t i = nextIndex++; i < batchProbeIndices->size(); i = nextIndex++) {
+			(*batchResults)[(*batchProbeIndices)[i]] = probe(fileEntries[(*batchProbeIndices)[i]].path);
+		}
+	};
+	int workerCount = threadCount - 1; // the calling thread probes too
+	std::vector<std::thread> workers;
+	for (int i = 0; i < workerCount; ++i) {
+		workers.emplace_back([&]() {
+			int probedBatchID = 0;
+			std::unique_lock<std::mutex> lock(workerMutex);
+			while (true) {
+				batchStartedCondition.wait(lock, [&]() { return isScanFinished || batchID != probedBatchID; });
+				if (isScanFinished) {
+					return;
+				}
+				probedBatchID = batchID;
+				lock.unlock();
+				probeBatch();
+				lock.lock();
+				// Every worker finishes every batch, so none of them can still read it, when the next one is started:
+				if (++finishedWorkerCount == workerCount) {
+					batchFinishedCondition.notify_one();
+				}
+			}
+		});
+	}
+
+	auto processBatch = [&]() {
+		///////////////////////////////////////////////////////////////////////////////
+		// Lookup index
+		///////////////////////////////////////////////////////////////////////////////
+		std::vector<ProbeResult> results(fileEntries.size());
+		std::vector<size_t> probeIndices; // indices of new or changed files
+		for (size_t i = 0; i < fileEntries.size(); ++i) {
+			int musicIndex = index ? index->find(fileEntries[i].path.u8string()) : -1;
+			if (musicIndex != -1 && !index->isRemoved(musicIndex)
+				&& index->getMusicFileSize(musicIndex) == fileEntries[i].fileSize && index->getLastWriteTime(musicIndex) == fileEntries[i].lastWriteTime) {
+				results[i].musicInfo = index->getMusicInfo(musicIndex);
+				++stats.cachedCount;
+			}
+			else {
+				probeIndices.push_back(i);
+			}
+		}
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Probe
+		///////////////////////////////////////////////////////////////////////////////
+		Timer probeTimer;
+		if (!probeIndices.empty()) {
+			{
+				std::lock_guard<std::mutex> lock(workerMutex);
+				batchResults = &results;
+				batchProbeIndices = &probeIndices;
+				nextIndex = 0;
+				finishedWorkerCount = 0;
+				++batchID;
+			}
+			batchStartedCondition.notify_all();
+			probeBatch(); // calling thread helps instead of waiting idle
+			std::unique_lock<std::mutex> lock(workerMutex);
+			batchFinishedCondition.wait(lock, [&]() { return finishedWorkerCount == workerCount; });
+		}
+		stats.probeTime += probeTimer.getElapsedTime();
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Merge
+		///////////////////////////////////////////////////////////////////////////////
+		for (size_t i = 0; i < results.size(); ++i) {
+			if (!results[i].error.empty()) {
+				batch.logMessages.push_back(results[i].error);
+				++stats.failedCount;
+				continue;
+			}
+			if (results[i].isDecoded) {
+				++stats.decodedCount;
+			}
+			results[i].musicInfo.fileSize      = fileEntries[i].fileSize;
+			results[i].musicInfo.lastWriteTime = fileEntries[i].lastWriteTime;
+			batch.musicInfoList.push_back(std::move(results[i].musicInfo));
+		}
+		stats.fileCount += fileEntries.size();
+		fileEntries.clear();
+	};
+
+	// Files are probed in batches while walking, so that the first music is available long before the walk is finished.
+	walk(musicDirs, batch.logMessages, [&](FileEntry&& fileEntry) {
+		fileEntries.push_back(std::move(fileEntry));
+		if (fileEntries.size() >= BATCH_SIZE) {
+			processBatch();
+			onBatch(std::move(batch));
+			batch = {};
+		}
+		return !isCanceled;
+	});
+	processBatch();
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		isScanFinished = true;
+	}
+	batchStartedCondition.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	stats.walkTime = scanTimer.getElapsedTime() - stats.probeTime;
+	float scanSeconds = scanTimer.getElapsedTime().asSeconds();
+	stats.filesPerSecond = scanSeconds > 0 ? stats.fileCount / scanSeconds : 0;
+	std::stringstream ss;
+	ss << "Library: scanned " << stats.fileCount << " files (" << stats.cachedCount << " cached, " << stats.decodedCount << " decoded, " << stats.failedCount << " failed) with " << stats.threadCount << " threads; "
+		<< "walk: " << stats.walkTime.asSeconds() << "s, probe: " << stats.probeTime.asSeconds() << "s, " << stats.filesPerSecond << " files/s"
+		<< (isCanceled ? " (canceled)" : "");
+	batch.logMessages.push_back(ss.str());
+	onBatch(std::move(batch)); // always called, because it contains the stats
+}
+
+void core::LibraryScanner::cancel()
+{
+	isCanceled = true;
+}
+
+/**
+ * Each directory is opened once and listed with GetFileInformationByHandleEx(FileIdBothDirectoryInfo), which returns name,
+ * attributes, size, write time and file id of many entries per file system request. Nothing else is requested per file and a
+ * path is only created for supported audio files.
+ * Every directory and file is identified by its volume serial number and file id, so the same physical directory or file is
+ * only walked once, even if it is reachable through several music directories, directory links (junctions, symlinks) or
+ * hard links. This also stops link cycles. Linked directories are walked after all music directories, so that music is found
+ * by its real path if possible. Skipped duplicates are logged. Directories which can not be listed (e.g. access denied,
+ * broken link) are skipped.
+ */
+void core::LibraryScanner::walk(const std::vector<fs::path>& musicDirs, std::vector<std::string>& logMessages, const std::function<bool(FileEntry&&)>& onFile)
+{
+	struct FileKey
+	{
+		DWORD     volumeSerialNumber;
+		ULONGLONG fileId;
+		bool operator==(const FileKey& other) const { return volumeSerialNumber == other.volumeSerialNumber && fileId == other.fileId; }
+	};
+	struct FileKeyHash
+	{
+		size_t operator()(const FileKey& key) const { return std::hash<ULONGLONG>()(key.fileId ^ ((ULONGLONG)key.volumeSerialNumber << 32)); }
+	};
+	std::unordered_map<FileKey, std::wstring, FileKeyHash> visitedDirs; //< value: path, to name the original in the log
+	std::unordered_set<FileKey, FileKeyHash>               visitedFiles;
+	std::vector<std::wstring>                              linkedDirs;  //< directory links, which are walked last
+	std::vector<ULONGLONG> buffer(LIST_BUFFER_SIZE / sizeof(ULONGLONG)); //< ULONGLONG, because FILE_ID_BOTH_DIR_INFO has to be 8 byte aligned
+
+	// Returns false if 'onFile' canceled the walk.
+	auto walkTree = [&](std::wstring rootPath) {
+		std::vector<std::wstring> dirStack = { std::move(rootPath) }; // depth first
+		while (!dirStack.empty()) {
+			std::wstring dirPath = std::move(dirStack.back());
+			dirStack.pop_back();
+			// The handle of a directory link is the handle of its target (no FILE_FLAG_OPEN_REPARSE_POINT), so links are followed.
+			HANDLE dirHandle = CreateFileW((dirPath.back() == L':' ? dirPath + L'\\' : dirPath).c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+				NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+			if (dirHandle == INVALID_HANDLE_VALUE) {
+				continue;
+			}
+			BY_HANDLE_FILE_INFORMATION dirInfo;
+			if (!GetFileInformationByHandle(dirHandle, &dirInfo)) {
+				CloseHandle(dirHandle);
+				continue;
+			}
+			FileKey dirKey = { dirInfo.dwVolumeSerialNumber, ((ULONGLONG)dirInfo.nFileIndexHigh << 32) | dirInfo.nFileIndexLow };
+			auto [visitedDirIt, isNewDir] = visitedDirs.emplace(dirKey, dirPath);
+			if (!isNewDir) {
+				if (visitedDirIt->second != dirPath) { // otherwise a music directory is listed twice
+					logMessages.push_back("Warning: Directory '" + fs::path(dirPath).u8string() + "' is skipped, because it is the same as '" + fs::path(visitedDirIt->second).u8string() + "'.\n");
+				}
+				CloseHandle(dirHandle);
+				continue;
+			}
+
+			size_t firstSubDirIndex = dirStack.size();
+			bool isCanceled = false;
+			for (FILE_INFO_BY_HANDLE_CLASS infoClass = FileIdBothDirectoryRestartInfo;
+				!isCanceled && GetFileInformationByHandleEx(dirHandle, infoClass, buffer.data(), LIST_BUFFER_SIZE);
+				infoClass = FileIdBothDirectoryInfo) {
+				for (DWORD offset = 0; ; ) {
+					const FILE_ID_BOTH_DIR_INFO* info = reinterpret_cast<const FILE_ID_BOTH_DIR_INFO*>(reinterpret_cast<const BYTE*>(buffer.data()) + offset);
+					std::wstring_view name(info->FileName, info->FileNameLength / sizeof(WCHAR));
+					if (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+						if (info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+							linkedDirs.push_back(dirPath + L'\\' + std::wstring(name));
+						}
+						else if (name != L"." && name != L"..") {
+							dirStack.push_back(dirPath + L'\\' + std::wstring(name));
+						}
+					}
+					else if (isSupportedAudioFilename(name)) {
+						FileEntry fileEntry;
+						fileEntry.path = dirPath + L'\\' + std::wstring(name); // IMPORTANT: wstring is required for unicode paths (see MusicPlayer::init()).
+						// File ids are 0 if the file system has none (e.g. some network drives), then files can not be compared.
+						FileKey fileKey = { dirInfo.dwVolumeSerialNumber, (ULONGLONG)info->FileId.QuadPart };
+						if (fileKey.fileId != 0 && !visitedFiles.insert(fileKey).second) {
+							logMessages.push_back("Warning: Music file '" + fileEntry.path.u8string() + "' is skipped, because it is a hard link to a music file which was already found.\n");
+						}
+						else {
+							fileEntry.fileSize = (uintmax_t)info->EndOfFile.QuadPart;
+							// fs::file_time_type (MSVC) counts 100ns intervals since 1601 like FILETIME, so the ticks are the same as fs::last_write_time() returns.
+							fileEntry.lastWriteTime = info->LastWriteTime.QuadPart;
+							if (!onFile(std::move(fileEntry))) {
+								isCanceled = true;
+								break;
+							}
+						}
+					}
+					if (info->NextEntryOffset == 0) {
+						break;
+					}
+					offset += info->NextEntryOffset;
+				}
+			}
+			CloseHandle(dirHandle);
+			if (isCanceled) {
+				return false;
+			}
+			std::reverse(dirStack.begin() + firstSubDirIndex, dirStack.end()); // so that the subdirectories are walked in listing order
+		}
+		return true;
+	};
+
+	for (auto& musicDirPath : musicDirs) {
+		std::wstring rootPath = fs::path(musicDirPath).make_preferred().wstring();
+		while (rootPath.size() > 1 && rootPath.back() == L'\\') {
+			rootPath.pop_back(); // "C:\" -> "C:", because the separator is added to each entry
+		}
+		DWORD rootAttributes = GetFileAttributesW((rootPath + L'\\').c_str()); // "C:" alone would be the current directory of drive C
+		if (rootAttributes == INVALID_FILE_ATTRIBUTES || !(rootAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+			logMessages.push_back("Error: Music directory '" + musicDirPath.u8string() + "' could not be found!\n");
+			continue;
+		}
+		if (!walkTree(std::move(rootPath))) {
+			return;
+		}
+	}
+	for (size_t i = 0; i < linkedDirs.size(); ++i) { // walking a linked directory can find further links
+		if (!walkTree(linkedDirs[i])) {
+			return;
+		}
+	}
+}
+
+const core::LibraryScanner::Stats& core::LibraryScanner::getStats() const
+{
+	return stats;
+}
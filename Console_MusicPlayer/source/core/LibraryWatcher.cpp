@@ -0,0 +1,268 @@
+#include "core/LibraryWatcher.hpp"
+#include "core/LibraryScanner.hpp"
+#include "core/SmallTools.hpp"
+#include <map>
+#include <chrono>
+#include <Windows.h>
+
+static const DWORD WATCH_BUFFER_SIZE = 64 * 1024;                //< larger buffers do not work on network drives
+static const DWORD WAIT_TIMEOUT_MS   = 250;                      //< how often pending files and 'isRunning' are checked
+static const auto  SETTLE_TIME       = std::chrono::seconds(1); //< time without events before a file is read (files are often written in many steps, e.g. while copying)
+
+core::LibraryWatcher::~LibraryWatcher()
+{
+	stop();
+}
+
+void core::LibraryWatcher::start(const std::vector<fs::path>& musicDirs)
+{
+	stop();
+	isRunning = true;
+	thread = std::thread(&LibraryWatcher::run, this, musicDirs);
+}
+
+void core::LibraryWatcher::stop()
+{
+	isRunning = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+std::vector<core::LibraryWatcher::Change> core::LibraryWatcher::pollChanges()
+{
+	std::vector<Change> polledChanges;
+	std::vector<std::string> polledLogMessages;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		polledChanges.swap(changes);
+		polledLogMessages.swap(logMessages);
+	}
+	for (auto& message : polledLogMessages) {
+		log(message);
+	}
+	return polledChanges;
+}
+
+void core::LibraryWatcher::push(Change change)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	changes.push_back(std::move(change));
+}
+
+void core::LibraryWatcher::pushLog(std::string message)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	logMessages.push_back(std::move(message));
+}
+
+void core::LibraryWatcher::pushAdded(const fs::path& musicFilePath)
+{
+	LibraryScanner::ProbeResult result = LibraryScanner::probe(musicFilePath);
+	if (!result.error.empty()) {
+		pushLog(result.error + " (" + musicFilePath.u8string() + ")");
+		return;
+	}
+	std::error_code ec;
+	result.musicInfo.fileSize      = fs::file_size(musicFilePath, ec);
+	result.musicInfo.lastWriteTime = fs::last_write_time(musicFilePath, ec).time_since_epoch().count();
+	Change change;
+	change.type      = Change::Type::Added;
+	change.path      = musicFilePath;
+	change.musicInfo = std::move(result.musicInfo);
+	push(std::move(change));
+}
+
+void core::LibraryWatcher::pushAddedDirectory(const fs::path& dirPath)
+{
+	std::vector<std::string> walkLogMessages; // not logged, because the directory may be removed in the meantime
+	LibraryScanner::walk({ dirPath }, walkLogMessages, [this](LibraryScanner::FileEntry&& fileEntry) {
+		pushAdded(fileEntry.path);
+		return isRunning.load();
+	});
+}
+
+void core::LibraryWatcher::run(std::vector<fs::path> musicDirs)
+{
+	struct WatchedDir
+	{
+		fs::path           path;
+		HANDLE             handle;
+		OVERLAPPED         overlapped;
+		std::vector<DWORD> buffer;    //< DWORD, because FILE_NOTIFY_INFORMATION has to be DWORD aligned
+		bool               isPending; //< a ReadDirectoryChangesW() request is running
+	};
+	struct PendingFile
+	{
+		std::chrono::steady_clock::time_point lastChange;
+		bool                                  isAdded; //< otherwise it was modified
+	};
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Open directories
+	///////////////////////////////////////////////////////////////////////////////
+	std::vector<WatchedDir> watchedDirs;
+	watchedDirs.reserve(musicDirs.size()); // OVERLAPPED must not move while a request is pending
+	for (auto& musicDirPath : musicDirs) {
+		if (watchedDirs.size() == MAXIMUM_WAIT_OBJECTS) {
+			pushLog("Warning: Only " + std::to_string(MAXIMUM_WAIT_OBJECTS) + " music directories can be watched, '" + musicDirPath.u8string() + "' is ignored.");
+			continue;
+		}
+		HANDLE handle = CreateFileW(musicDirPath.wstring().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+			NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			pushLog("Error: Music directory '" + musicDirPath.u8string() + "' can not be watched (error " + std::to_string(GetLastError()) + ").");
+			continue;
+		}
+		WatchedDir watchedDir;
+		watchedDir.path               = musicDirPath;
+		watchedDir.handle             = handle;
+		watchedDir.overlapped         = {};
+		watchedDir.overlapped.hEvent  = CreateEventW(NULL, TRUE, FALSE, NULL);
+		watchedDir.isPending          = false;
+		watchedDir.buffer.resize(WATCH_BUFFER_SIZE / sizeof(DWORD));
+		watchedDirs.push_back(std::move(watchedDir));
+	}
+
+	// If a request fails, then its event is never set again and the directory is no longer watched.
+	auto readChanges = [this](WatchedDir& watchedDir) {
+		ResetEvent(watchedDir.overlapped.hEvent);
+		watchedDir.isPending = ReadDirectoryChangesW(watchedDir.handle, watchedDir.buffer.data(), WATCH_BUFFER_SIZE, TRUE,
+			FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+			NULL, &watchedDir.overlapped, NULL);
+		if (!watchedDir.isPending) {
+			pushLog("Error: Music directory '" + watchedDir.path.u8string() + "' can not be watched (error " + std::to_string(GetLastError()) + ").");
+		}
+	};
+	std::vector<HANDLE> events; //< same order as 'watchedDirs'
+	for (auto& watchedDir : watchedDirs) {
+		readChanges(watchedDir);
+		events.push_back(watchedDir.overlapped.hEvent);
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Watch
+	///////////////////////////////////////////////////////////////////////////////
+	std::map<std::wstring, PendingFile> pendingFiles; //< key: path; added or modified files, which are read after SETTLE_TIME
+	fs::path renamedOldPath;
+	while (isRunning && !events.empty()) {
+		DWORD waitResult = WaitForMultipleObjects((DWORD)events.size(), events.data(), FALSE, WAIT_TIMEOUT_MS);
+		if (waitResult >= WAIT_OBJECT_0 && waitResult < WAIT_OBJECT_0 + events.size()) {
+			WatchedDir& watchedDir = watchedDirs[waitResult - WAIT_OBJECT_0];
+			DWORD byteCount = 0;
+			watchedDir.isPending = false;
+			if (!GetOverlappedResult(watchedDir.handle, &watchedDir.overlapped, &byteCount, FALSE)) {
+				pushLog("Error: Watching music directory '" + watchedDir.path.u8string() + "' failed (error " + std::to_string(GetLastError()) + ").");
+			}
+			else if (byteCount == 0) {
+				// ..buffer overflow - the events are lost
+				pushLog("Warning: Too many changes in music directory '" + watchedDir.path.u8string() + "', it is read again.");
+				pushAddedDirectory(watchedDir.path);
+				Change change;
+				change.type = Change::Type::Rescan;
+				change.path = watchedDir.path;
+				push(std::move(change));
+			}
+			else {
+				const BYTE* data = reinterpret_cast<const BYTE*>(watchedDir.buffer.data());
+				for (DWORD offset = 0; ; ) {
+					const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(data + offset);
+					fs::path path = (watchedDir.path / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR))).make_preferred();
+					std::wstring key = path.wstring();
+					switch (info->Action) {
+					case FILE_ACTION_ADDED:
+					case FILE_ACTION_MODIFIED: {
+						PendingFile& pendingFile = pendingFiles[key]; // isAdded is false for new entries
+						pendingFile.lastChange = std::chrono::steady_clock::now();
+						pendingFile.isAdded |= info->Action == FILE_ACTION_ADDED;
+						break;
+					}
+					case FILE_ACTION_REMOVED: {
+						pendingFiles.erase(key);
+						Change change;
+						change.type = Change::Type::Removed;
+						change.path = path;
+						push(std::move(change));
+						break;
+					}
+					case FILE_ACTION_RENAMED_OLD_NAME:
+						renamedOldPath = path;
+						break;
+					case FILE_ACTION_RENAMED_NEW_NAME: {
+						// A file which is still written, is read with its new name.
+						auto it = pendingFiles.find(renamedOldPath.wstring());
+						if (it != pendingFiles.end()) {
+							pendingFiles[key] = it->second;
+							pendingFiles.erase(it);
+						}
+						// Directories are always renamed (also "Vol. 1" -> "Vol. 2"); the main thread renames the music the library has under the old path.
+						// The old path does not exist anymore, so it is a directory, if the new one is.
+						std::error_code ec;
+						bool isDirectory = fs::is_directory(path, ec);
+						bool isOldSupported = isDirectory || isSupportedAudioFile(renamedOldPath);
+						bool isNewSupported = isDirectory || isSupportedAudioFile(path);
+						Change change;
+						if (isOldSupported && isNewSupported) {
+							change.type    = Change::Type::Renamed;
+							change.path    = path;
+							change.oldPath = renamedOldPath;
+							push(std::move(change));
+						}
+						else if (isOldSupported) {
+							change.type = Change::Type::Removed; // e.g. "music.mp3" -> "music.mp3.bak"
+							change.path = renamedOldPath;
+							push(std::move(change));
+						}
+						else if (isNewSupported) {
+							pendingFiles[key] = { std::chrono::steady_clock::now(), true }; // e.g. "music.mp3.part" -> "music.mp3" (download finished)
+						}
+						break;
+					}
+					}
+					if (info->NextEntryOffset == 0) {
+						break;
+					}
+					offset += info->NextEntryOffset;
+				}
+			}
+			readChanges(watchedDir);
+		}
+
+		///////////////////////////////////////////////////////////////////////////////
+		// Read settled files
+		///////////////////////////////////////////////////////////////////////////////
+		auto now = std::chrono::steady_clock::now();
+		for (auto it = pendingFiles.begin(); it != pendingFiles.end();) {
+			if (now - it->second.lastChange < SETTLE_TIME) {
+				++it;
+				continue;
+			}
+			fs::path path = it->first;
+			bool isAdded = it->second.isAdded;
+			it = pendingFiles.erase(it);
+
+			std::error_code ec;
+			if (fs::is_directory(path, ec)) {
+				if (isAdded) { // modified directories just had some changes inside
+					pushAddedDirectory(path);
+				}
+			}
+			else if (isSupportedAudioFile(path) && fs::exists(path, ec)) {
+				pushAdded(path); // if this fails (e.g. file is still locked), then the next write triggers another try
+			}
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Close directories
+	///////////////////////////////////////////////////////////////////////////////
+	for (auto& watchedDir : watchedDirs) {
+		if (watchedDir.isPending) {
+			CancelIoEx(watchedDir.handle, &watchedDir.overlapped);
+			DWORD byteCount = 0;
+			GetOverlappedResult(watchedDir.handle, &watchedDir.overlapped, &byteCount, TRUE); // wait till the request is canceled, because it writes into 'buffer'
+		}
+		CloseHandle(watchedDir.overlapped.hEvent);
+		CloseHandle(watchedDir.handle);
+	}
+}
@@ -0,0 +1,433 @@
+#include "core/MusicLibrary.hpp"
+#include <algorithm>
+
+void core::MusicLibrary::attach(std::unique_ptr<LibraryIndex> index)
+{
+	clear();
+	this->index  = std::move(index);
+	indexSize    = this->index->size();
+	removedCount = this->index->getRemovedCount();
+}
+
+const core::LibraryIndex* core::MusicLibrary::getIndex() const
+{
+	return index.get();
+}
+
+bool core::MusicLibrary::isModified() const
+{
+	return isModified_;
+}
+
+int core::MusicLibrary::add(const MusicInfo& musicInfo)
+{
+	int musicIndex = (int)size();
+	std::string path = musicInfo.path.u8string();
+	durations.push_back(musicInfo.duration.asNanoSeconds());
+	fileSizes.push_back(musicInfo.fileSize);
+	lastWriteTimes.push_back(musicInfo.lastWriteTime);
+	titles.push_back(addString(musicInfo.title));
+	paths.push_back(addString(path));
+	artistIds.push_back(internString(musicInfo.artist));
+	albumIds.push_back(internString(musicInfo.album));
+	pathIndices.emplace(hashPath(path), musicIndex);
+	if (isFilenameIndexBuilt) {
+		filenameIndices.emplace(hashPath(getFilename(path)), musicIndex);
+	}
+	isModified_ = true;
+	return musicIndex;
+}
+
+void core::MusicLibrary::set(int musicIndex, const MusicInfo& musicInfo)
+{
+	std::string path = musicInfo.path.u8string();
+	bool isPathChanged = getPathStr(musicIndex) != path;
+	bool isIndexed     = (size_t)musicIndex < indexSize && !findChanged(musicIndex); // path is still found through the index
+	if ((isPathChanged || isIndexed) && !isRemoved(musicIndex)) {
+		erasePathIndex(musicIndex);
+		pathIndices.emplace(hashPath(path), musicIndex);
+	}
+	if (isPathChanged && isFilenameIndexBuilt && !isRemoved(musicIndex)) {
+		eraseFilenameIndex(musicIndex);
+		filenameIndices.emplace(hashPath(getFilename(path)), musicIndex);
+	}
+
+	if ((size_t)musicIndex < indexSize) {
+		ChangedMusic& changed = changedMusic[musicIndex];
+		changed.path          = path;
+		changed.title         = musicInfo.title;
+		changed.artistId      = internString(musicInfo.artist);
+		changed.albumId       = internString(musicInfo.album);
+		changed.duration      = musicInfo.duration.asNanoSeconds();
+		changed.fileSize      = musicInfo.fileSize;
+		changed.lastWriteTime = musicInfo.lastWriteTime;
+	}
+	else {
+		size_t i = musicIndex - indexSize;
+		if (isPathChanged) {
+			paths[i] = addString(path);
+		}
+		if (getString(titles[i]) != musicInfo.title) {
+			titles[i] = addString(musicInfo.title);
+		}
+		durations[i]      = musicInfo.duration.asNanoSeconds();
+		fileSizes[i]      = musicInfo.fileSize;
+		lastWriteTimes[i] = musicInfo.lastWriteTime;
+		artistIds[i]      = internString(musicInfo.artist);
+		albumIds[i]       = internString(musicInfo.album);
+	}
+	isModified_ = true;
+}
+
+void core::MusicLibrary::remove(int musicIndex)
+{
+	if (isRemoved(musicIndex)) {
+		return;
+	}
+	erasePathIndex(musicIndex);
+	if (isFilenameIndexBuilt) {
+		eraseFilenameIndex(musicIndex);
+	}
+	removedFlags.resize(size());
+	removedFlags[musicIndex] = true;
+	++removedCount;
+	isModified_ = true;
+}
+
+void core::MusicLibrary::clear()
+{
+	*this = MusicLibrary();
+}
+
+void core::MusicLibrary::reserve(size_t musicCount)
+{
+	size_t addedCount = musicCount > indexSize ? musicCount - indexSize : 0;
+	durations.reserve(addedCount);
+	fileSizes.reserve(addedCount);
+	lastWriteTimes.reserve(addedCount);
+	titles.reserve(addedCount);
+	paths.reserve(addedCount);
+	artistIds.reserve(addedCount);
+	albumIds.reserve(addedCount);
+	pathIndices.reserve(addedCount);
+}
+
+int core::MusicLibrary::find(const fs::path& musicFilePath) const
+{
+	std::string path = musicFilePath.u8string();
+	auto range = pathIndices.equal_range(hashPath(path));
+	for (auto it = range.first; it != range.second; ++it) {
+		if (getPathStr(it->second) == path) {
+			return it->second;
+		}
+	}
+	if (index) {
+		int musicIndex = index->find(path);
+		if (musicIndex != -1 && !isRemoved(musicIndex) && !findChanged(musicIndex)) {
+			return musicIndex;
+		}
+	}
+	return -1;
+}
+
+std::vector<int> core::MusicLibrary::findInDirectory(const fs::path& dirPath) const
+{
+	std::string prefix = (dirPath / "").u8string(); // with trailing separator, so that "music" does not match "music2"
+	auto isInDirectory = [&prefix](std::string_view path) {
+		return path.compare(0, prefix.size(), prefix) == 0;
+	};
+	std::vector<int> musicIndices;
+
+	// The directories of the index are sorted, so the directory and all its subdirectories are next to each other.
+	if (index) {
+		size_t first = 0;
+		size_t last  = index->getDirectoryCount();
+		while (first < last) {
+			size_t middle = (first + last) / 2;
+			if (index->getDirectory(middle).path < prefix) {
+				first = middle + 1;
+			}
+			else {
+				last = middle;
+			}
+		}
+		for (size_t i = first; i < index->getDirectoryCount(); ++i) {
+			LibraryIndex::Directory directory = index->getDirectory(i);
+			if (!isInDirectory(directory.path)) {
+				break;
+			}
+			for (size_t j = 0; j < directory.musicCount; ++j) {
+				int musicIndex = (int)directory.musicIndices[j];
+				if ((size_t)musicIndex < indexSize && !isRemoved(musicIndex) && !findChanged(musicIndex)) {
+					musicIndices.push_back(musicIndex);
+				}
+			}
+		}
+	}
+	for (auto& [musicIndex, changed] : changedMusic) {
+		if (!isRemoved(musicIndex) && isInDirectory(changed.path)) {
+			musicIndices.push_back(musicIndex);
+		}
+	}
+	for (size_t i = 0; i < paths.size(); ++i) {
+		int musicIndex = (int)(indexSize + i);
+		if (!isRemoved(musicIndex) && isInDirectory(getString(paths[i]))) {
+			musicIndices.push_back(musicIndex);
+		}
+	}
+	std::sort(musicIndices.begin(), musicIndices.end());
+	return musicIndices;
+}
+
+std::vector<int> core::MusicLibrary::findByFilename(std::string_view filename) const
+{
+	buildFilenameIndex();
+	std::vector<int> musicIndices;
+	auto range = filenameIndices.equal_range(hashPath(filename));
+	for (auto it = range.first; it != range.second; ++it) {
+		if (getFilename(getPathStr(it->second)) == filename) {
+			musicIndices.push_back(it->second);
+		}
+	}
+	std::sort(musicIndices.begin(), musicIndices.end()); // the order of equal keys is not defined
+	return musicIndices;
+}
+
+void core::MusicLibrary::buildFilenameIndex() const
+{
+	if (isFilenameIndexBuilt) {
+		return;
+	}
+	filenameIndices.reserve(getMusicCount());
+	for (int musicIndex = 0; musicIndex < (int)size(); ++musicIndex) {
+		if (!isRemoved(musicIndex)) {
+			filenameIndices.emplace(hashPath(getFilename(getPathStr(musicIndex))), musicIndex);
+		}
+	}
+	isFilenameIndexBuilt = true;
+}
+
+bool core::MusicLibrary::equals(int musicIndex, const MusicInfo& musicInfo) const
+{
+	return getDuration(musicIndex) == musicInfo.duration
+		&& getFileSize(musicIndex) == musicInfo.fileSize
+		&& getLastWriteTime(musicIndex) == musicInfo.lastWriteTime
+		&& getTitle(musicIndex) == musicInfo.title
+		&& getArtist(musicIndex) == musicInfo.artist
+		&& getAlbum(musicIndex) == musicInfo.album
+		&& getPathStr(musicIndex) == musicInfo.path.u8string();
+}
+
+core::MusicInfo core::MusicLibrary::get(int musicIndex) const
+{
+	MusicInfo musicInfo;
+	musicInfo.path          = getPath(musicIndex);
+	musicInfo.title         = getTitle(musicIndex);
+	musicInfo.artist        = getArtist(musicIndex);
+	musicInfo.album         = getAlbum(musicIndex);
+	musicInfo.duration      = getDuration(musicIndex);
+	musicInfo.fileSize      = getFileSize(musicIndex);
+	musicInfo.lastWriteTime = getLastWriteTime(musicIndex);
+	return musicInfo;
+}
+
+std::string_view core::MusicLibrary::getTitle(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return getString(titles[musicIndex - indexSize]);
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? changed->title : index->getTitle(musicIndex);
+}
+
+std::string_view core::MusicLibrary::getArtist(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return internedStrings[artistIds[musicIndex - indexSize]];
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? internedStrings[changed->artistId] : index->getArtist(musicIndex);
+}
+
+std::string_view core::MusicLibrary::getAlbum(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return internedStrings[albumIds[musicIndex - indexSize]];
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? internedStrings[changed->albumId] : index->getAlbum(musicIndex);
+}
+
+core::Time core::MusicLibrary::getDuration(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return Time(Nanoseconds(durations[musicIndex - indexSize]));
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? Time(Nanoseconds(changed->duration)) : index->getDuration(musicIndex);
+}
+
+fs::path core::MusicLibrary::getPath(int musicIndex) const
+{
+	return fs::u8path(getPathStr(musicIndex));
+}
+
+std::string_view core::MusicLibrary::getPathStr(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return getString(paths[musicIndex - indexSize]);
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? changed->path : index->getPath(musicIndex);
+}
+
+uintmax_t core::MusicLibrary::getFileSize(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return fileSizes[musicIndex - indexSize];
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? changed->fileSize : index->getMusicFileSize(musicIndex);
+}
+
+long long core::MusicLibrary::getLastWriteTime(int musicIndex) const
+{
+	if ((size_t)musicIndex >= indexSize) {
+		return lastWriteTimes[musicIndex - indexSize];
+	}
+	const ChangedMusic* changed = findChanged(musicIndex);
+	return changed ? changed->lastWriteTime : index->getLastWriteTime(musicIndex);
+}
+
+bool core::MusicLibrary::isRemoved(int musicIndex) const
+{
+	return ((size_t)musicIndex < removedFlags.size() && removedFlags[musicIndex])
+		|| ((size_t)musicIndex < indexSize && index->isRemoved(musicIndex));
+}
+
+size_t core::MusicLibrary::size() const
+{
+	return indexSize + durations.size();
+}
+
+size_t core::MusicLibrary::getMusicCount() const
+{
+	return size() - removedCount;
+}
+
+core::MusicLibrary::MemoryReport core::MusicLibrary::getMemoryReport() const
+{
+	// Heap sizes are estimated from the capacities; allocator overhead is ignored.
+	const size_t smallStringSize = std::string().capacity(); // strings up to this length are stored inside the object
+	auto heapSize = [smallStringSize](size_t length, size_t charSize) {
+		return length > smallStringSize / charSize ? (length + 1) * charSize : 0;
+	};
+	const size_t bucketSize = sizeof(void*);
+	const size_t nodeSize   = 2 * sizeof(void*); // next pointer and cached hash (or prev pointer)
+
+	MemoryReport report = {};
+	report.musicCount  = getMusicCount();
+	report.mappedBytes = index ? index->getFileSize() : 0;
+	report.bytes = sizeof(*this)
+		+ durations.capacity()      * sizeof(long long)
+		+ fileSizes.capacity()      * sizeof(uintmax_t)
+		+ lastWriteTimes.capacity() * sizeof(long long)
+		+ titles.capacity()         * sizeof(StringRef)
+		+ paths.capacity()          * sizeof(StringRef)
+		+ artistIds.capacity()      * sizeof(uint32_t)
+		+ albumIds.capacity()       * sizeof(uint32_t)
+		+ removedFlags.capacity()   / 8
+		+ arena.capacity()
+		+ internedStrings.capacity() * sizeof(std::string)
+		+ internedStringIds.bucket_count() * bucketSize
+		+ pathIndices.bucket_count() * bucketSize
+		+ pathIndices.size() * (nodeSize + sizeof(std::pair<const size_t, int>))
+		+ filenameIndices.bucket_count() * bucketSize
+		+ filenameIndices.size() * (nodeSize + sizeof(std::pair<const size_t, int>))
+		+ changedMusic.bucket_count() * bucketSize;
+	for (auto& [str, id] : internedStringIds) {
+		report.bytes += nodeSize + sizeof(std::pair<const std::string, uint32_t>) + 2 * heapSize(str.size(), sizeof(char));
+	}
+	for (auto& [musicIndex, changed] : changedMusic) {
+		report.bytes += nodeSize + sizeof(std::pair<const int, ChangedMusic>) + heapSize(changed.path.size(), sizeof(char)) + heapSize(changed.title.size(), sizeof(char));
+	}
+
+	// The same music as std::vector<MusicInfo> with an std::unordered_map<std::wstring, int> to find paths.
+	report.musicInfoBytes = sizeof(std::vector<MusicInfo>) + sizeof(std::unordered_map<std::wstring, int>)
+		+ report.musicCount * (sizeof(MusicInfo) + bucketSize + nodeSize + sizeof(std::pair<const std::wstring, int>));
+	for (int musicIndex = 0; musicIndex < (int)size(); ++musicIndex) {
+		if (isRemoved(musicIndex)) {
+			continue;
+		}
+		size_t pathLength = getPath(musicIndex).native().size();
+		report.musicInfoBytes += heapSize(pathLength, sizeof(fs::path::value_type)) // MusicInfo::path
+			+ heapSize(pathLength, sizeof(wchar_t))                                 // key of the path map
+			+ heapSize(getTitle(musicIndex).size(), sizeof(char))
+			+ heapSize(getArtist(musicIndex).size(), sizeof(char))
+			+ heapSize(getAlbum(musicIndex).size(), sizeof(char));
+	}
+	return report;
+}
+
+const core::MusicLibrary::ChangedMusic* core::MusicLibrary::findChanged(int musicIndex) const
+{
+	if (changedMusic.empty()) {
+		return nullptr;
+	}
+	auto it = changedMusic.find(musicIndex);
+	return it == changedMusic.end() ? nullptr : &it->second;
+}
+
+void core::MusicLibrary::erasePathIndex(int musicIndex)
+{
+	auto range = pathIndices.equal_range(hashPath(getPathStr(musicIndex)));
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == musicIndex) {
+			pathIndices.erase(it);
+			return;
+		}
+	}
+}
+
+void core::MusicLibrary::eraseFilenameIndex(int musicIndex)
+{
+	auto range = filenameIndices.equal_range(hashPath(getFilename(getPathStr(musicIndex))));
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == musicIndex) {
+			filenameIndices.erase(it);
+			return;
+		}
+	}
+}
+
+core::MusicLibrary::StringRef core::MusicLibrary::addString(std::string_view str)
+{
+	StringRef stringRef = { (uint32_t)arena.size(), (uint32_t)str.size() };
+	arena.append(str);
+	return stringRef;
+}
+
+std::string_view core::MusicLibrary::getString(StringRef stringRef) const
+{
+	return std::string_view(arena.data() + stringRef.offset, stringRef.length);
+}
+
+uint32_t core::MusicLibrary::internString(const std::string& str)
+{
+	auto [it, isInserted] = internedStringIds.emplace(str, (uint32_t)internedStrings.size());
+	if (isInserted) {
+		internedStrings.push_back(str);
+	}
+	return it->second;
+}
+
+size_t core::MusicLibrary::hashPath(std::string_view path)
+{
+	return std::hash<std::string_view>()(path);
+}
+
+std::string_view core::MusicLibrary::getFilename(std::string_view path)
+{
+	size_t separator = path.find_last_of("\\/");
+	return separator == std::string_view::npos ? path : path.substr(separator + 1);
+}
@@ -2,15 +2,43 @@
 #include "core/SmallTools.hpp"
 #include "core/Profiler.hpp"
 #include "core/InputDevice.hpp"
+#include "core/LibraryScanner.hpp"
+#include "core/LibraryIndex.hpp"
+#include "core/PlaylistFile.hpp"
 #include "App.hpp"
+#include "Messages.hpp"
 #include <filesystem>
 #include <fstream>
 #include <random>
+#include <unordered_set>
 #include <iostream>
 #include <cassert>
 #include <Windows.h>
 
 const std::string core::MusicPlayer::ALL_PLAYLIST_NAME = "__all8756234875.pl"; //< should be a name nobody chooses for his playlists.
+static const char* LIBRARY_INDEX_PATH = "data/library.index";
+static const char* EXPORT_DIR_PATH    = "data/export";
+
+/** Calls 'function' for each index in [0, count) on all cores; the calling thread helps instead of waiting idle. */
+template <typename Function>
+intern void runParallel(size_t count, const Function& function)
+{
+	int threadCount = std::thread::hardware_concurrency() == 0 ? 1 : std::thread::hardware_concurrency();
+	std::atomic<size_t> nextIndex = 0;
+	auto worker = [&]() {
+		for (size_t i = nextIndex++; i < count; i = nextIndex++) {
+			function(i);
+		}
+	};
+	std::vector<std::thread> workers;
+	for (int i = 1; i < std::min(threadCount, (int)count); ++i) {
+		workers.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : workers) {
+		thread.join();
+	}
+}
 
 void core::MusicPlayer::init(App* app, int options /*= 0*/, Time sleepTime /*= 0ns*/)
 {
@@ -18,19 +46,43 @@ void core::MusicPlayer::init(App* app, int options /*= 0*/, Time sleepTime /*= 0
 	// Reset all values
 	///////////////////////////////////////////////////////////////////////////////
 	this->app = app;
-	music = nullptr;
-	musicInfoList.clear();
+	audioPlayer.init();
+	audioPlayer.setLatencyProbe(app->isLatencyProbed);
+	prefetchedMusicIndex = -1;
+	isNextStarted = false;
+	library.clear();
+	deferredMusicIndices.clear();
+	scanBatches.clear();
+	isScanThreadRunning = false;
+	isScanning_ = false;
+	isLibraryIncomplete = false;
+	isLibraryIndexOutdated = false;
+	scannedMusic.clear();
+	isAutoStartPending = false;
 	playlists.clear();
+	playlistWriter.start();
 	activePlaylist = nullptr;
 	drawnPlaylist = nullptr;
 	playingOrder.clear();
+	playingOrderPlaytime.clear();
+	isPlayingOrderDeferred = false;
+	deferredOrderPositions.clear();
 	playingOrder_currentIndex = -1;
-	trackPlaytime;
+	playQueue = PlayQueue();
+	isPlayQueueShown_ = false;
+	queuedMusicIndex = -1;
 	this->sleepTime = sleepTime;
 	playtime;
 	fadeOutEnabled = false;
 	volume = 100;
 	isShuffled_ = false;
+	isSameArtistSeparated = false;
+	{
+		// The seed is logged, so that it can be set in the configuration to replay a shuffled session.
+		unsigned int shuffleSeed = app->shuffleSeed != 0 ? app->shuffleSeed : std::random_device()();
+		rng.seed(shuffleSeed);
+		log("Shuffle seed: " + std::to_string(shuffleSeed));
+	}
 	replayStatus = Replay::None;
 	cooldownSkipReport;
 	cooldownVolumeReport;
@@ -78,43 +130,58 @@ void core::MusicPlayer::init(App* app, int options /*= 0*/, Time sleepTime /*= 0
 	drawableList_initInfo.hover               = 0;
 
 	///////////////////////////////////////////////////////////////////////////////
-	// Load music
+	// Set play queue
 	///////////////////////////////////////////////////////////////////////////////
-	for (auto& musicDirPath : app->musicDirs) {
-		if (fs::exists(musicDirPath)) {
-			for (auto& it : fs::recursive_directory_iterator(musicDirPath)) {
-				addMusic(it.path().wstring()); // IMPORTANT use here u8string to support Dvořák, but for something like 音楽 you need wstring.
-			}
-		}
-		else {
-			log("Error: Music directory '" + musicDirPath.string() + "' could not be found!\n");
-		}
-	}
+	playQueueRows = PlayQueueRows(&library, &playQueue);
+	playQueueList.init(drawableList_initInfo);
+	playQueueList.setName("up next");
+	playQueueList.setRowProvider(&playQueueRows);
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Set default playlist
 	///////////////////////////////////////////////////////////////////////////////
-	// Init playlist:
+	// The music is added by applyScanBatches().
 	Playlist allPlaylist; // a playlist which plays all available music
 	allPlaylist.name = ALL_PLAYLIST_NAME;
-	allPlaylist.musicIndexList.reserve(musicInfoList.size());
-	for (int i = 0; i < musicInfoList.size(); ++i)
-		allPlaylist.musicIndexList.push_back(i);
-	// Set drawable list:
 	allPlaylist.drawableList.init(drawableList_initInfo);
-	for (int musicIndex : allPlaylist.musicIndexList) {
-		MusicInfo& musicInfo = musicInfoList[musicIndex];
-		allPlaylist.drawableList.push_back({ musicInfo.title, core::getTimeStr(musicInfo.duration) });
-	}
-	// Set duration:
 	allPlaylist.duration = 0s;
-	for (int musicIndex : allPlaylist.musicIndexList) {
-		MusicInfo& musicInfo = musicInfoList[musicIndex];
-		allPlaylist.duration += musicInfo.duration;
-	}
 	allPlaylist.oldTracksPlaytime = 0s;
-	playlists.push_back(allPlaylist);
-	drawnPlaylist = &playlists.back();
+	drawnPlaylist = registerPlaylist(std::move(allPlaylist));
+
+	///////////////////////////////////////////////////////////////////////////////
+	// Load music
+	///////////////////////////////////////////////////////////////////////////////
+	// The library index of the last run is mapped, so all music is available immediately. The music directories are scanned
+	// anyway to find the changes since then; the metadata is read on multiple threads (see LibraryScanner), but only for new
+	// or changed files. The watcher is started first, so that no change gets lost. Its changes are applied after the scan.
+	libraryWatcher.start(app->musicDirs);
+	auto libraryIndex = std::make_unique<LibraryIndex>();
+	if (libraryIndex->open(LIBRARY_INDEX_PATH)) {
+		library.attach(std::move(libraryIndex));
+		for (int musicIndex = 0; musicIndex < (int)library.size(); ++musicIndex) {
+			if (!library.isRemoved(musicIndex)) {
+				insertIntoPlaylist(getAllPlaylist(), musicIndex);
+			}
+		}
+	}
+	isLibraryIncomplete = library.size() == 0;
+	isScanning_ = true;
+	isScanThreadRunning = true;
+	auto scan = [this, musicDirs = app->musicDirs, threadCount = app->scanThreadCount, libraryIndex = library.getIndex()]() {
+		libraryScanner.scan(musicDirs, threadCount, libraryIndex, [this](LibraryScanner::Batch&& batch) {
+			std::lock_guard<std::mutex> lock(scanMutex);
+			scanBatches.push_back(std::move(batch));
+		});
+		isScanThreadRunning = false;
+	};
+	if (hasFlag(ProgressiveLoad, options)) {
+		getAllPlaylist().drawableList.setName(drawableList_initInfo.name + " (scanning..)");
+		scanThread = std::thread(scan);
+	}
+	else {
+		scan();
+		applyScanBatches();
+	}
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Options
@@ -122,6 +189,9 @@ void core::MusicPlayer::init(App* app, int options /*= 0*/, Time sleepTime /*= 0
 	if (hasFlag(Shuffle, options)) {
 		isShuffled_ = true; // shuffle() will be called in playPlaylist()
 	}
+	if (hasFlag(SeparateArtists, options)) {
+		isSameArtistSeparated = true;
+	}
 	if (hasFlag(LoopAll, options)) {
 		replayStatus = Replay::All;
 	}
@@ -130,135 +200,526 @@ void core::MusicPlayer::init(App* app, int options /*= 0*/, Time sleepTime /*= 0
 	}
 	if (hasFlag(FadeOut, options)) {
 		fadeOutEnabled = true;
+		audioPlayer.setCrossfade(app->crossfadeTime, app->crossfadeCurve);
 	}
 	if (hasFlag(AutoStart, options)) {
-		playPlaylist(ALL_PLAYLIST_NAME);
+		if (empty()) {
+			isAutoStartPending = true;
+		}
+		else {
+			playPlaylist(ALL_PLAYLIST_NAME);
+		}
 	}
 }
 
-void core::MusicPlayer::addMusic(std::filesystem::path musicFilePath)
+void core::MusicPlayer::applyScanBatches()
 {
-	if (!fs::exists(musicFilePath)) {
-		log("File (" + musicFilePath.string() + ") not found!\n");
+	if (!isScanning_) {
 		return;
 	}
 
-	// Is music file?:
-	if (!isSupportedAudioFile(musicFilePath)) {
-		return;
+	// Read this before taking the batches, because the scan thread pushes its last batch before it finishes.
+	bool isScanFinished = !isScanThreadRunning;
+	std::vector<LibraryScanner::Batch> batches;
+	{
+		std::lock_guard<std::mutex> lock(scanMutex);
+		batches.swap(scanBatches);
 	}
 
-	// Open music to get its metadata:
-	Mix_Music* music = Mix_LoadMUS(musicFilePath.make_preferred().u8string().c_str());
-	if (!music) {
-		log("Failed to load music! SDL_mixer Error: " + std::string(Mix_GetError()) + "\n");
-		//__debugbreak();
-		return;
+	///////////////////////////////////////////////////////////////////////////////
+	// Add music
+	///////////////////////////////////////////////////////////////////////////////
+	Playlist& allPlaylist = getAllPlaylist();
+	// If the active playlist gets music (e.g. ALL_PLAYLIST_NAME while the library streams in), its play order is updated once.
+	isPlayingOrderDeferred = true;
+	for (auto& batch : batches) {
+		for (auto& message : batch.logMessages) {
+			log(message);
+		}
+		for (auto& musicInfo : batch.musicInfoList) {
+			int musicIndex = library.find(musicInfo.path); // is also found, if the same music directory is specified twice
+			if (musicIndex == -1) {
+				musicIndex = library.add(musicInfo);
+				if (isLibraryIncomplete) {
+					insertIntoPlaylist(allPlaylist, musicIndex); // other playlists are resolved at the end
+				}
+				else {
+					updatePlaylistMembership(musicIndex);
+				}
+			}
+			else if (!library.equals(musicIndex, musicInfo)) {
+				updateMusic(musicIndex, musicInfo);
+			}
+			if (scannedMusic.size() <= (size_t)musicIndex) {
+				scannedMusic.resize(library.size());
+			}
+			scannedMusic[musicIndex] = true;
+		}
+	}
+	isPlayingOrderDeferred = false;
+	insertDeferredOrderPositions();
+	if (isAutoStartPending && !empty()) {
+		isAutoStartPending = false;
+		playPlaylist(ALL_PLAYLIST_NAME);
 	}
 
-	std::string filenameStem = musicFilePath.stem().u8string();
-	MusicInfo musicInfo = {};
-	musicInfo.path      = musicFilePath.make_preferred().wstring();
-	musicInfo.title     = strcmp(Mix_GetMusicTitle(music), "") == 0 ? filenameStem : Mix_GetMusicTitle(music); // SDL2 does not return filename as mentioned, so I do it manually.
-	musicInfo.artist    = strcmp(Mix_GetMusicArtistTag(music), "") == 0 ? "unknown" : Mix_GetMusicTitle(music);
-	musicInfo.album     = strcmp(Mix_GetMusicAlbumTag(music), "") == 0 ? "unknown" : Mix_GetMusicTitle(music);
-	musicInfo.duration  = Time(Seconds((int)Mix_MusicDuration(music))); // IMPORTANT!: needs to be set once. IF this is called frequently, then the played music stutters!!!
-	musicInfoList.push_back(musicInfo);
-	Mix_FreeMusic(music);
+	///////////////////////////////////////////////////////////////////////////////
+	// Finish
+	///////////////////////////////////////////////////////////////////////////////
+	if (!isScanFinished) {
+		allPlaylist.drawableList.setName(drawableList_initInfo.name + " (scanning.. " + std::to_string(allPlaylist.musicIndexList.size()) + ")");
+		return;
+	}
+	if (scanThread.joinable()) {
+		scanThread.join();
+	}
+	// Music of the library index, which was not found, has been removed while the player was not running.
+	for (int musicIndex = 0; musicIndex < (int)library.size(); ++musicIndex) {
+		if (!library.isRemoved(musicIndex) && (musicIndex >= (int)scannedMusic.size() || !scannedMusic[musicIndex])) {
+			removeMusic(musicIndex);
+		}
+	}
+	scannedMusic.clear();
+	if (isLibraryIncomplete) {
+		isLibraryIncomplete = false;
+		resolvePlaylists();
+	}
+	if (library.isModified() || isLibraryIndexOutdated) {
+		saveLibraryIndex(false);
+	}
+	MusicLibrary::MemoryReport memoryReport = library.getMemoryReport();
+	if (memoryReport.musicCount > 0) {
+		log("Library: " + std::to_string(memoryReport.musicCount) + " tracks use " + std::to_string(memoryReport.bytes / 1024) + " KB and "
+			+ std::to_string(memoryReport.mappedBytes / 1024) + " KB mapped index (" + std::to_string(memoryReport.bytes / memoryReport.musicCount) + " bytes per track, "
+			+ std::to_string(memoryReport.musicInfoBytes / memoryReport.musicCount) + " bytes as MusicInfo).");
+	}
+	allPlaylist.drawableList.setName(drawableList_initInfo.name);
+	isScanning_ = false;
+	updateListSelection();
 }
 
 void core::MusicPlayer::addPlaylist(fs::path playlistFilePath)
 {
-	PROFILE_FUNC;
+	addPlaylists({ playlistFilePath });
+}
 
-	if (!fs::exists(playlistFilePath)) {
-		std::cout << "Error: Playlist (" << playlistFilePath << ") not found!\n";
-		system("PAUSE");
-	}
+void core::MusicPlayer::addPlaylists(const std::vector<fs::path>& playlistFilePaths)
+{
+	PROFILE_FUNC;
 
-	for (Playlist& playlist : playlists) {
-		if (playlist.name == playlistFilePath.filename().string()) {
+	///////////////////////////////////////////////////////////////////////////////
+	// Setup playlists
+	///////////////////////////////////////////////////////////////////////////////
+	std::unordered_set<std::string> names; // of the new playlists
+	std::vector<fs::path> filePaths;
+	std::vector<Playlist> newPlaylists;
+	for (const fs::path& playlistFilePath : playlistFilePaths) {
+		if (!fs::exists(playlistFilePath)) {
+			std::cout << "Error: Playlist (" << playlistFilePath << ") not found!\n";
+			system("PAUSE");
+		}
+		if (playlists.isValid(playlists.find(playlistFilePath.filename().string())) || !names.insert(playlistFilePath.filename().string()).second) {
 			// ..playlist is already set
-			return;
+			continue;
 		}
+		Playlist newPlaylist;
+		newPlaylist.name = playlistFilePath.filename().string();
+		newPlaylist.filePath = playlistFilePath;
+		newPlaylist.drawableList.init(drawableList_initInfo);
+		newPlaylist.duration = 0s;
+		newPlaylist.oldTracksPlaytime = 0s;
+		filePaths.push_back(playlistFilePath);
+		newPlaylists.push_back(std::move(newPlaylist));
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
-	// Load music file names
+	// Load and resolve playlists
 	///////////////////////////////////////////////////////////////////////////////
-	std::vector<std::wstring> musicFilenames;
-	{
-		std::wifstream ifs(playlistFilePath, std::ios::in);
-		std::wstring nextFilename;
-		while (std::getline(ifs, nextFilename)) {
-			musicFilenames.push_back(nextFilename); // Playlist should only hold filenames, so that music files can be moved without editing the playlist file.
+	// Without library index the library is incomplete while scanning, so the playlists are resolved after the scan (see applyScanBatches()).
+	// Each worker only writes into its own playlist, so no locking is required.
+	library.buildFilenameIndex();
+	std::vector<std::vector<std::string>> warnings(newPlaylists.size());
+	std::vector<char> isResolvedByIndex(newPlaylists.size(), false); // std::vector<bool> can not be written concurrently
+	runParallel(newPlaylists.size(), [&](size_t i) {
+		newPlaylists[i].musicFilenames = PlaylistWriter::readPlaylistFile(filePaths[i]);
+		std::error_code ec;
+		newPlaylists[i].fileSize = fs::file_size(filePaths[i], ec);
+		newPlaylists[i].lastWriteTime = fs::last_write_time(filePaths[i], ec).time_since_epoch().count();
+		// The edits of the last run were not compacted into the playlist file (e.g. after a crash):
+		if (PlaylistWriter::applyJournal(filePaths[i], newPlaylists[i].musicFilenames)) {
+			newPlaylists[i].isEdited = true;
 		}
-		ifs.close();
-	}
+		newPlaylists[i].musicFilenameSet.insert(newPlaylists[i].musicFilenames.begin(), newPlaylists[i].musicFilenames.end());
+		if (!isLibraryIncomplete) {
+			isResolvedByIndex[i] = resolvePlaylist(newPlaylists[i], warnings[i]);
+		}
+	});
 
 	///////////////////////////////////////////////////////////////////////////////
-	// Setup playlist
+	// Add playlists
 	///////////////////////////////////////////////////////////////////////////////
-	// Store old playlist:
-	// This is neccessary, because if std::vector playlists allocates new memory, then all pointers are invalid.
-	std::string activePlaylistName = activePlaylist ? activePlaylist->name : "";
-	std::string drawnPlaylistName = drawnPlaylist ? drawnPlaylist->name : "";
-	// Add new playlist:
-	Playlist newPlaylist;
-	newPlaylist.name = playlistFilePath.filename().string();
-	newPlaylist.musicIndexList.reserve(musicFilenames.size());
-	for (int i = 0; i < musicInfoList.size(); ++i) {
-		if (std::find(musicFilenames.begin(), musicFilenames.end(), musicInfoList[i].path.filename().wstring()) != musicFilenames.end()) {
-			// ..playlist requires this music
-			newPlaylist.musicIndexList.push_back(i);
+	for (size_t i = 0; i < newPlaylists.size(); ++i) {
+		if (newPlaylists[i].isEdited) {
+			playlistWriter.compact(filePaths[i]);
+		}
+		registerPlaylist(std::move(newPlaylists[i]));
+		for (const std::string& warning : warnings[i]) {
+			log(warning);
+		}
+		if (!isLibraryIncomplete && !isResolvedByIndex[i]) {
+			isLibraryIndexOutdated = true;
 		}
 	}
-	// Set drawable list:
-	newPlaylist.drawableList.init(drawableList_initInfo);
-	for (int musicIndex : newPlaylist.musicIndexList) {
-		MusicInfo& musicInfo = musicInfoList[musicIndex];
-		newPlaylist.drawableList.push_back({ musicInfo.title, core::getTimeStr(musicInfo.duration) });
+	if (!newPlaylists.empty()) {
+		app->messageBus.send(::Message::PLAYLISTS_CHANGED);
 	}
-	// Set duration:
-	newPlaylist.duration = 0s;
-	for (int musicIndex : newPlaylist.musicIndexList) {
-		MusicInfo& musicInfo = musicInfoList[musicIndex];
-		newPlaylist.duration += musicInfo.duration;
+}
+
+core::MusicPlayer::Playlist* core::MusicPlayer::registerPlaylist(Playlist playlist)
+{
+	Playlist* registeredPlaylist = playlists.get(playlists.add(std::move(playlist)));
+	if (registeredPlaylist) {
+		registeredPlaylist->rows = PlaylistRows(&library, &registeredPlaylist->musicIndexList);
+		registeredPlaylist->drawableList.setRowProvider(&registeredPlaylist->rows);
+	}
+	return registeredPlaylist;
+}
+
+bool core::MusicPlayer::removePlaylist(const std::string& playlistName)
+{
+	PlaylistRegistry::Handle handle = playlists.find(playlistName);
+	Playlist* playlist = playlists.get(handle);
+	if (!playlist || playlistName == ALL_PLAYLIST_NAME) {
+		return false;
+	}
+	if (activePlaylist == playlist) {
+		stop();
+		updateListSelection();
+	}
+	if (drawnPlaylist == playlist) {
+		drawnPlaylist = nullptr;
+	}
+	playlists.remove(handle);
+	isLibraryIndexOutdated = true;
+	app->messageBus.send(::Message::PLAYLISTS_CHANGED);
+	return true;
+}
+
+void core::MusicPlayer::scanPlaylists()
+{
+	// Import the playlists of other tools, which have no playlist file yet (delete the playlist file to import it again):
+	std::vector<fs::path> importFilePaths;
+	std::vector<fs::path> playlistFilePaths;
+	for (auto& it : fs::directory_iterator("data")) {
+		if (it.is_regular_file() && getPlaylistFileFormat(it.path()) != PlaylistFileFormat::Unknown) {
+			importFilePaths.push_back(it.path());
+		}
+		else if (it.is_regular_file() && it.path().extension() == ".pl") {
+			playlistFilePaths.push_back(it.path());
+		}
 	}
+	for (const fs::path& importFilePath : importFilePaths) {
+		fs::path playlistFilePath = fs::path(importFilePath).replace_extension(".pl");
+		if (!fs::exists(playlistFilePath)) {
+			std::vector<std::string> warnings;
+			if (importPlaylistFile(importFilePath, playlistFilePath, app->musicDirs, warnings)) {
+				playlistFilePaths.push_back(playlistFilePath);
+			}
+			for (const std::string& warning : warnings) {
+				log(warning);
+			}
+		}
+	}
+	addPlaylists(playlistFilePaths); // skips the playlists, which are already added
+
+	// A playlist which was created in this run may not be written yet:
+	std::vector<std::string> removedPlaylistNames;
+	for (const Playlist& playlist : playlists) {
+		if (!playlist.filePath.empty() && !playlist.isEdited && !fs::exists(playlist.filePath)) {
+			removedPlaylistNames.push_back(playlist.name);
+		}
+	}
+	for (const std::string& playlistName : removedPlaylistNames) {
+		removePlaylist(playlistName);
+	}
+}
+
+bool core::MusicPlayer::createPlaylist(const std::string& playlistName)
+{
+	fs::path playlistFilePath = fs::path("data") / playlistName;
+	if (playlists.isValid(playlists.find(playlistName)) || fs::exists(playlistFilePath)) {
+		return false;
+	}
+	Playlist newPlaylist;
+	newPlaylist.name = playlistName;
+	newPlaylist.filePath = playlistFilePath;
+	newPlaylist.drawableList.init(drawableList_initInfo);
+	newPlaylist.duration = 0s;
 	newPlaylist.oldTracksPlaytime = 0s;
-	playlists.push_back(newPlaylist);
-	// Restore pointers:
+	newPlaylist.fileSize = 0;
+	newPlaylist.lastWriteTime = 0;
+	newPlaylist.isEdited = true;
+	registerPlaylist(std::move(newPlaylist));
+	playlistWriter.compact(playlistFilePath); // creates the file
+	isLibraryIndexOutdated = true;
+	app->messageBus.send(::Message::PLAYLISTS_CHANGED);
+	return true;
+}
+
+bool core::MusicPlayer::addTrack(const std::string& playlistName, const fs::path& musicFilePath, int position /*= -1*/)
+{
+	Playlist* playlist = getEditablePlaylist(playlistName);
+	int musicIndex = library.find(musicFilePath);
+	if (!playlist || musicIndex == -1 || library.isRemoved(musicIndex) || position < -1 || position > (int)playlist->musicIndexList.size()) {
+		return false;
+	}
+	std::wstring musicFilename = musicFilePath.filename().wstring();
+	if (playlist->musicFilenameSet.count(musicFilename) != 0) {
+		return false;
+	}
+
+	// The playlist file is in the order of the rows, so the music is inserted in front of the filename of the track at 'position':
+	int entryIndex = (int)playlist->musicFilenames.size();
+	if (position != -1 && position != (int)playlist->musicIndexList.size()) {
+		std::wstring nextFilename = library.getPath(playlist->musicIndexList[position]).filename().wstring();
+		entryIndex = (int)(std::find(playlist->musicFilenames.begin(), playlist->musicFilenames.end(), nextFilename) - playlist->musicFilenames.begin());
+	}
+	playlist->musicFilenames.insert(playlist->musicFilenames.begin() + entryIndex, musicFilename);
+	playlist->musicFilenameSet.insert(musicFilename);
+	playlistWriter.append(playlist->filePath, { PlaylistWriter::Edit::Type::Insert, entryIndex, 0, musicFilename });
+	playlist->isEdited = true;
+	isLibraryIndexOutdated = true;
+
+	// Music with the same filename in other directories is added too (see resolvePlaylist()):
+	for (int filenameMusicIndex : library.findByFilename(toStr(musicFilename))) {
+		if (!library.isRemoved(filenameMusicIndex)) {
+			insertIntoPlaylist(*playlist, filenameMusicIndex, position);
+			position += position == -1 ? 0 : 1;
+		}
+	}
+	return true;
+}
+
+bool core::MusicPlayer::removeTrack(const std::string& playlistName, int position)
+{
+	Playlist* playlist = getEditablePlaylist(playlistName);
+	if (!playlist || position < 0 || position >= (int)playlist->musicIndexList.size()) {
+		return false;
+	}
+	std::wstring musicFilename = library.getPath(playlist->musicIndexList[position]).filename().wstring();
+	for (int entryIndex = (int)playlist->musicFilenames.size() - 1; entryIndex >= 0; --entryIndex) {
+		if (playlist->musicFilenames[entryIndex] == musicFilename) {
+			playlist->musicFilenames.erase(playlist->musicFilenames.begin() + entryIndex);
+			playlistWriter.append(playlist->filePath, { PlaylistWriter::Edit::Type::Erase, entryIndex });
+		}
+	}
+	playlist->musicFilenameSet.erase(musicFilename);
+	playlist->isEdited = true;
+	isLibraryIndexOutdated = true;
+
+	// Removes all music with this filename; a playing music is removed after it was played:
+	for (int filenameMusicIndex : library.findByFilename(toStr(musicFilename))) {
+		updatePlaylistMembership(filenameMusicIndex);
+	}
+	return true;
+}
+
+bool core::MusicPlayer::moveTrack(const std::string& playlistName, int position, int newPosition)
+{
+	Playlist* playlist = getEditablePlaylist(playlistName);
+	int size = playlist ? (int)playlist->musicIndexList.size() : 0;
+	if (!playlist || position < 0 || position >= size || newPosition < 0 || newPosition >= size || position == newPosition) {
+		return false;
+	}
+
+	// Playlist file:
+	auto findEntry = [&](int rowPosition) {
+		std::wstring musicFilename = library.getPath(playlist->musicIndexList[rowPosition]).filename().wstring();
+		return (int)(std::find(playlist->musicFilenames.begin(), playlist->musicFilenames.end(), musicFilename) - playlist->musicFilenames.begin());
+	};
+	PlaylistWriter::Edit edit = { PlaylistWriter::Edit::Type::Move, findEntry(position), findEntry(newPosition) };
+	if (edit.position != edit.newPosition) {
+		auto from = playlist->musicFilenames.begin() + edit.position;
+		auto to   = playlist->musicFilenames.begin() + edit.newPosition;
+		if (from < to) std::rotate(from, from + 1, to + 1);
+		else           std::rotate(to, from, from + 1);
+		playlistWriter.append(playlist->filePath, edit);
+	}
+	playlist->isEdited = true;
+	isLibraryIndexOutdated = true;
+
+	// Rows:
+	auto from = playlist->musicIndexList.begin() + position;
+	auto to   = playlist->musicIndexList.begin() + newPosition;
+	if (from < to) std::rotate(from, from + 1, to + 1);
+	else           std::rotate(to, from, from + 1);
+	playlist->drawableList.onRowMoved(position, newPosition);
+	if (playlist == activePlaylist) {
+		// The music keeps its place in the play order, only the playlist positions in between move by one (see PlayOrder::insert()).
+		int orderIndex = playingOrder.getOrderIndex(position);
+		playingOrder.erase(orderIndex);
+		playingOrder.insert(orderIndex, newPosition);
+	}
+	return true;
+}
+
+bool core::MusicPlayer::exportPlaylist(const std::string& playlistName, const fs::path& filePath) const
+{
+	const Playlist* playlist = playlists.get(playlists.find(playlistName));
+	PlaylistFileWriter writer;
+	if (!playlist || !writer.open(filePath)) {
+		return false;
+	}
+	fs::path exportDirPath = fs::absolute(filePath).parent_path().lexically_normal();
+	for (int musicIndex : playlist->musicIndexList) {
+		fs::path musicFilePath = fs::absolute(library.getPath(musicIndex)).lexically_normal();
+		fs::path relativePath = musicFilePath.lexically_relative(exportDirPath);
+		bool isRelative = !relativePath.empty() && *relativePath.begin() != "..";
+		writer.write({ (isRelative ? relativePath : musicFilePath).wstring(), std::string(library.getTitle(musicIndex)), (int)library.getDuration(musicIndex).asSeconds() });
+	}
+	return writer.close();
+}
+
+core::MusicPlayer::Playlist* core::MusicPlayer::getEditablePlaylist(const std::string& playlistName)
+{
+	Playlist* playlist = playlists.get(playlists.find(playlistName));
+	return playlist && !playlist->filePath.empty() ? playlist : nullptr;
+}
+
+void core::MusicPlayer::resolvePlaylists()
+{
+	std::vector<Playlist*> unresolvedPlaylists;
 	for (Playlist& playlist : playlists) {
-		if (playlist.name == activePlaylistName) {
-			activePlaylist = &playlist;
+		if (playlist.name != ALL_PLAYLIST_NAME) {
+			unresolvedPlaylists.push_back(&playlist);
+		}
+	}
+	library.buildFilenameIndex();
+	std::vector<std::vector<std::string>> warnings(unresolvedPlaylists.size());
+	std::vector<char> isResolvedByIndex(unresolvedPlaylists.size(), false);
+	runParallel(unresolvedPlaylists.size(), [&](size_t i) {
+		isResolvedByIndex[i] = resolvePlaylist(*unresolvedPlaylists[i], warnings[i]);
+	});
+	for (size_t i = 0; i < unresolvedPlaylists.size(); ++i) {
+		unresolvedPlaylists[i]->drawableList.onRowsChanged();
+		for (const std::string& warning : warnings[i]) {
+			log(warning);
 		}
-		if (playlist.name == drawnPlaylistName) {
-			drawnPlaylist = &playlist;
+		if (!isResolvedByIndex[i]) {
+			isLibraryIndexOutdated = true;
 		}
 	}
+}
 
+bool core::MusicPlayer::resolvePlaylist(Playlist& playlist, std::vector<std::string>& warnings) const
+{
 	///////////////////////////////////////////////////////////////////////////////
-	// Log missing files
+	// Setup playlist
 	///////////////////////////////////////////////////////////////////////////////
-	for (std::wstring& playlistFileEntry : musicFilenames) {
-		bool found = false;
-		for (int playlistEntry : newPlaylist.musicIndexList) {
-			if (musicInfoList[playlistEntry].path.filename().wstring() == playlistFileEntry) {
-				found = true;
-				break;
+	const std::vector<std::wstring>& musicFilenames = playlist.musicFilenames;
+	// The resolved music of the last run is stored in the library index. It is still valid, if neither the playlist file
+	// nor the library has changed since then.
+	const LibraryIndex* libraryIndex = library.getIndex();
+	bool isResolvedByIndex = libraryIndex && !library.isModified() && !playlist.isEdited
+		&& libraryIndex->findPlaylist(playlist.name, playlist.fileSize, playlist.lastWriteTime, playlist.musicIndexList);
+	if (isResolvedByIndex) {
+		playlist.musicIndexList.erase(std::remove_if(playlist.musicIndexList.begin(), playlist.musicIndexList.end(),
+			[this](int musicIndex) { return library.isRemoved(musicIndex); }), playlist.musicIndexList.end());
+	}
+	else {
+		// The music is in the order of the playlist file. If a filename is in several directories, all of them are added.
+		playlist.musicIndexList.reserve(musicFilenames.size());
+		std::vector<bool> isAdded(library.size()); // the playlist file may contain a filename twice
+		for (const std::wstring& musicFilename : musicFilenames) {
+			std::vector<int> musicIndices = library.findByFilename(toStr(musicFilename));
+			if (musicIndices.empty()) {
+				warnings.push_back("Warning: Playlist (" + playlist.name + ") could not find '" + toStr(musicFilename) + "'!");
+			}
+			for (int musicIndex : musicIndices) {
+				if (!isAdded[musicIndex]) {
+					isAdded[musicIndex] = true;
+					playlist.musicIndexList.push_back(musicIndex);
+				}
 			}
 		}
-		if (!found)
-			log("Warning: Playlist (" + newPlaylist.name + ") could not find '" + toStr(playlistFileEntry) + "'!");
 	}
+	// Set duration:
+	playlist.containedMusic.assign(library.size(), false);
+	for (int musicIndex : playlist.musicIndexList) {
+		playlist.duration += library.getDuration(musicIndex);
+		playlist.containedMusic[musicIndex] = true;
+	}
+	return isResolvedByIndex;
+}
+
+void core::MusicPlayer::saveLibraryIndex(bool isCompacted)
+{
+	std::vector<LibraryIndex::Playlist> indexPlaylists;
+	for (Playlist& playlist : playlists) {
+		if (playlist.name != ALL_PLAYLIST_NAME) {
+			indexPlaylists.push_back({ playlist.name, playlist.fileSize, playlist.lastWriteTime, playlist.musicIndexList });
+		}
+	}
+
+	// The index is written to a temporary file, which replaces the old index afterwards, so that a crash while writing can not corrupt
+	// the old index. The old index is still mapped by 'library' and a mapped file can not be replaced, so the library is detached before.
+	fs::path tempFilePath = LIBRARY_INDEX_PATH;
+	tempFilePath += ".tmp";
+	if (!LibraryIndex::write(tempFilePath, library, indexPlaylists, isCompacted)) {
+		return;
+	}
+	if (isCompacted) {
+		library.clear();
+	}
+	else {
+		// The new index has the same music indices, so the library reads from it from now on and releases the music it stored itself.
+		auto libraryIndex = std::make_unique<LibraryIndex>();
+		if (!libraryIndex->open(tempFilePath)) {
+			return;
+		}
+		library.attach(std::move(libraryIndex));
+	}
+	std::error_code ec;
+	fs::rename(tempFilePath, LIBRARY_INDEX_PATH, ec); // replaces the existing file
+	if (ec) {
+		log("Error: Library index (" + std::string(LIBRARY_INDEX_PATH) + ") could not be replaced: " + ec.message());
+		return;
+	}
+	isLibraryIndexOutdated = false;
 }
 
 void core::MusicPlayer::terminate()
 {
 	stop();
-	musicInfoList.clear();
+	// The edited playlist files are complete after the writer is stopped, so the library index can store their resolved music:
+	playlistWriter.stop();
+	for (Playlist& playlist : playlists) {
+		if (playlist.isEdited) {
+			std::error_code ec;
+			playlist.fileSize = fs::file_size(playlist.filePath, ec);
+			playlist.lastWriteTime = fs::last_write_time(playlist.filePath, ec).time_since_epoch().count();
+			playlist.isEdited = false;
+		}
+	}
+	// Changes of the watcher and removed music are saved compacted. An interrupted scan is not saved, because its playlists may not be resolved yet.
+	if (!isScanning() && (library.isModified() || isLibraryIndexOutdated || library.getMusicCount() != library.size())) {
+		saveLibraryIndex(true);
+	}
+	libraryScanner.cancel();
+	if (scanThread.joinable()) {
+		scanThread.join();
+	}
+	scanBatches.clear();
+	isScanning_ = false;
+	libraryWatcher.stop();
+	audioPlayer.terminate();
+	library.clear();
+	deferredMusicIndices.clear();
 	playlists.clear();
 	drawnPlaylist = nullptr;
+	playQueue = PlayQueue();
+	playQueueList.terminate();
+	isPlayQueueShown_ = false;
 	sleepTime = 0s;
 	fadeOutEnabled = false;
 	volume = 100;
@@ -269,6 +730,13 @@ void core::MusicPlayer::terminate()
 
 void core::MusicPlayer::update()
 {
+	playlistWriter.pollLog();
+	audioPlayer.update();
+	applyScanBatches();
+	if (!isScanning()) {
+		applyLibraryChanges(); // the watcher changes are newer than the scanned music
+	}
+
 	if (empty()) {
 		return;
 	}
@@ -276,66 +744,56 @@ void core::MusicPlayer::update()
 	///////////////////////////////////////////////////////////////////////////////
 	// Play next
 	///////////////////////////////////////////////////////////////////////////////
-	if (activePlaylist && isStopped()) {
-		play(true);
-		updateListSelection();
-	}
-
-	///////////////////////////////////////////////////////////////////////////////
-	// Fade out
-	///////////////////////////////////////////////////////////////////////////////
-	if (activePlaylist && fadeOutEnabled) {
-		Time remainingPlaytime = getPlayingMusicInfo().duration - trackPlaytime.getElapsedTime();
-		Time fadeOutTime = 10s;
-		float minFadeOutFactor = 0.2; // Otherwise I get error messages.
-		if (remainingPlaytime <= fadeOutTime) {
-			fadeOutActive = true;
-
-			float fadeFactor = remainingPlaytime.asSeconds() / fadeOutTime.asSeconds(); // value from 0..1 (8sec / 10sec = 0.8)
-			fadeFactor = fadeFactor < minFadeOutFactor ? minFadeOutFactor : fadeFactor;
-			Mix_VolumeMusic(volume * fadeFactor); // important do not call this->setVolume() here.
+	AudioPlayer::Event audioEvent;
+	while (audioPlayer.pollEvent(audioEvent)) {
+		if (!activePlaylist) {
+			continue;
+		}
+		// The audio callback already started the prefetched music without gap, so play() only updates the state:
+		if (audioEvent == AudioPlayer::Event::NextStarted) {
+			isNextStarted = true;
+			play(true);
+			isNextStarted = false;
 		}
-		else if (fadeOutActive && remainingPlaytime > 10s) {
-			fadeOutActive = false;
-			setVolume(volume);
+		// ..the next music was not loaded in time or failed to load:
+		else {
+			play(true);
 		}
+		updateListSelection();
 	}
+	prefetchNextMusic(); // ..the audio player also crossfades to it (see Options::FadeOut)
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Update list border color
 	///////////////////////////////////////////////////////////////////////////////
-	if (drawnPlaylist && isStopped()) {
-		drawnPlaylist->drawableList.style.border = core::Color::Light_Red;
+	DrawableList* drawnList = getDrawnList();
+	if (drawnList && isStopped()) {
+		drawnList->style.border = core::Color::Light_Red;
 	}
-	else if (drawnPlaylist && isPaused()) {
-		drawnPlaylist->drawableList.style.border = core::Color::Light_Aqua;
+	else if (drawnList && isPaused()) {
+		drawnList->style.border = core::Color::Light_Aqua;
 	}
-	else if (drawnPlaylist && isPlaying()) {
-		drawnPlaylist->drawableList.style.border = core::Color::Light_Green;
+	else if (drawnList && isPlaying()) {
+		drawnList->style.border = core::Color::Light_Green;
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Sync auto play with music list
 	///////////////////////////////////////////////////////////////////////////////
-	if (activePlaylist && isPlaying()) {
+	if (activePlaylist && isPlaying() && queuedMusicIndex == -1) { // queued music is selected by updateListSelection()
 		activePlaylist->drawableList.select(getPlaylistPlayingMusicIndex());
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Update drawn list
 	///////////////////////////////////////////////////////////////////////////////
-	if (drawnPlaylist) {
-		drawnPlaylist->drawableList.update();
+	if (drawnList) {
+		drawnList->update();
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Handle timers
 	///////////////////////////////////////////////////////////////////////////////
-	// Loop one:
-	if (activePlaylist && replayStatus == Replay::One && trackPlaytime.getElapsedTime() >= getPlayingMusicInfo().duration) {
-		// ..current music restarts automatically if loop=-1, but trackPlaytime needs to be restarted.
-		trackPlaytime.restart(); 
-	}
 	// Sleep:
 	if (sleepTime > 0s && playtime.getElapsedTime() >= sleepTime) {
 		stop();
@@ -363,13 +821,11 @@ void core::MusicPlayer::updateListSelection()
 	if (activePlaylist)
 	{
 		// ..a track is playing - select it everywhere
-		const std::string playingMusicTitle = getPlayingMusicInfo().title;
+		const int playingMusicIndex = getPlayingMusicIndex();
 		for (Playlist& playlist : playlists) {
-			for (size_t i = 0; i < playlist.drawableList.get().size(); ++i) {
-				if (playlist.drawableList.get()[i][0] == playingMusicTitle) {
-					playlist.drawableList.select(i);
-					break;
-				}
+			auto it = std::find(playlist.musicIndexList.begin(), playlist.musicIndexList.end(), playingMusicIndex);
+			if (it != playlist.musicIndexList.end()) {
+				playlist.drawableList.select((int)(it - playlist.musicIndexList.begin()));
 			}
 		}
 		
@@ -383,16 +839,246 @@ void core::MusicPlayer::updateListSelection()
 	}
 }
 
+void core::MusicPlayer::applyLibraryChanges()
+{
+	std::vector<LibraryWatcher::Change> changes = libraryWatcher.pollChanges();
+	if (changes.empty() && deferredMusicIndices.empty()) {
+		return;
+	}
+
+	// Music which was removed while it was playing:
+	std::vector<int> deferredIndices;
+	deferredIndices.swap(deferredMusicIndices);
+	for (int musicIndex : deferredIndices) {
+		updatePlaylistMembership(musicIndex); // defers again, if it is still playing
+	}
+
+	int addedCount = 0;
+	int removedCount = 0;
+	int renamedCount = 0;
+	for (auto& change : changes) {
+		int musicIndex = library.find(change.type == LibraryWatcher::Change::Type::Renamed ? change.oldPath : change.path);
+		bool isKnownMusic = musicIndex != -1;
+		switch (change.type) {
+		case LibraryWatcher::Change::Type::Added:
+			if (isKnownMusic) {
+				updateMusic(musicIndex, change.musicInfo);
+			}
+			else {
+				addMusic(change.musicInfo);
+			}
+			++addedCount;
+			break;
+		case LibraryWatcher::Change::Type::Removed:
+			if (isKnownMusic) {
+				removeMusic(musicIndex);
+				++removedCount;
+			}
+			else {
+				// ..probably a directory
+				for (int dirMusicIndex : library.findInDirectory(change.path)) {
+					removeMusic(dirMusicIndex);
+					++removedCount;
+				}
+			}
+			break;
+		case LibraryWatcher::Change::Type::Renamed:
+			if (isKnownMusic) {
+				renameMusic(musicIndex, change.path);
+				++renamedCount;
+			}
+			else {
+				// ..a directory, if the library has music under the old path
+				for (int dirMusicIndex : library.findInDirectory(change.oldPath)) {
+					renameMusic(dirMusicIndex, change.path / library.getPath(dirMusicIndex).lexically_relative(change.oldPath));
+					++renamedCount;
+				}
+			}
+			break;
+		case LibraryWatcher::Change::Type::Rescan:
+			// Existing files were added again by the watcher, so only removed files are left.
+			for (int dirMusicIndex : library.findInDirectory(change.path)) {
+				std::error_code ec;
+				if (!fs::exists(library.getPath(dirMusicIndex), ec)) {
+					removeMusic(dirMusicIndex);
+					++removedCount;
+				}
+			}
+			break;
+		}
+	}
+
+	if (activePlaylist) {
+		updateOldTracksPlaytime();
+	}
+	if (!changes.empty()) {
+		log("Library: " + std::to_string(addedCount) + " added or changed, " + std::to_string(removedCount) + " removed, " + std::to_string(renamedCount) + " renamed.");
+	}
+}
+
+void core::MusicPlayer::addMusic(const MusicInfo& musicInfo)
+{
+	int musicIndex = library.add(musicInfo);
+	updatePlaylistMembership(musicIndex);
+}
+
+void core::MusicPlayer::removeMusic(int musicIndex)
+{
+	library.remove(musicIndex);
+	updatePlaylistMembership(musicIndex);
+	// Backwards, so that the positions of the remaining entries do not change:
+	for (size_t position = playQueue.size(); position-- > 0;) {
+		PlayQueue::EntryID entryID = playQueue.getEntry(position);
+		if (playQueue.getMusicIndex(entryID) == musicIndex) {
+			playQueue.erase(entryID);
+			playQueueList.onRowErased(position);
+		}
+	}
+}
+
+void core::MusicPlayer::renameMusic(int musicIndex, const fs::path& newPath)
+{
+	MusicInfo musicInfo = library.get(musicIndex);
+	if (musicInfo.title == musicInfo.path.stem().u8string()) {
+		// ..music has no title tag
+		musicInfo.title = newPath.stem().u8string();
+	}
+	musicInfo.path = newPath;
+	updateMusic(musicIndex, musicInfo);
+	updatePlaylistMembership(musicIndex); // playlists contain filenames
+}
+
+void core::MusicPlayer::updateMusic(int musicIndex, const MusicInfo& musicInfo)
+{
+	for (Playlist& playlist : playlists) {
+		for (int position = 0; position < playlist.musicIndexList.size(); ++position) {
+			if (playlist.musicIndexList[position] == musicIndex) {
+				playlist.duration += musicInfo.duration - library.getDuration(musicIndex);
+				playlist.drawableList.onRowsChanged(); // the rows are read from the library
+				if (&playlist == activePlaylist && position < (int)playingOrder.size()) { // ..deferred positions get the duration by insertDeferredOrderPositions()
+					playingOrderPlaytime.set(playingOrder.getOrderIndex(position), musicInfo.duration);
+				}
+			}
+		}
+	}
+	playQueueList.onRowsChanged();
+	library.set(musicIndex, musicInfo);
+}
+
+void core::MusicPlayer::updatePlaylistMembership(int musicIndex)
+{
+	// O(1) per playlist; only removing the music searches its position.
+	bool isRemoved = library.isRemoved(musicIndex);
+	std::wstring filename = library.getPath(musicIndex).filename().wstring();
+	for (Playlist& playlist : playlists) {
+		bool isWanted = !isRemoved && (playlist.name == ALL_PLAYLIST_NAME || playlist.musicFilenameSet.count(filename) != 0);
+		bool isContained = musicIndex < (int)playlist.containedMusic.size() && playlist.containedMusic[musicIndex];
+
+		if (isWanted && !isContained) {
+			insertIntoPlaylist(playlist, musicIndex);
+		}
+		else if (!isWanted && isContained) {
+			if (&playlist == activePlaylist && isPlayingMusic(musicIndex)) {
+				// ..do not interrupt the music - it is removed when it is no longer played (see applyLibraryChanges())
+				if (std::find(deferredMusicIndices.begin(), deferredMusicIndices.end(), musicIndex) == deferredMusicIndices.end()) {
+					deferredMusicIndices.push_back(musicIndex);
+				}
+			}
+			else {
+				auto it = std::find(playlist.musicIndexList.begin(), playlist.musicIndexList.end(), musicIndex);
+				removeFromPlaylist(playlist, (int)(it - playlist.musicIndexList.begin()));
+			}
+		}
+	}
+}
+
+void core::MusicPlayer::insertIntoPlaylist(Playlist& playlist, int musicIndex, int position /*= -1*/)
+{
+	if (position == -1) {
+		position = (int)playlist.musicIndexList.size();
+	}
+	bool isOrderDeferred = &playlist == activePlaylist && isPlayingOrderDeferred && position == (int)playlist.musicIndexList.size();
+	if (&playlist == activePlaylist && !isOrderDeferred) {
+		insertDeferredOrderPositions(); // ..before the positions move
+	}
+	playlist.musicIndexList.insert(playlist.musicIndexList.begin() + position, musicIndex);
+	if (playlist.containedMusic.size() <= (size_t)musicIndex) {
+		playlist.containedMusic.resize(library.size());
+	}
+	playlist.containedMusic[musicIndex] = true;
+	playlist.drawableList.onRowsChanged();
+	playlist.duration += library.getDuration(musicIndex);
+
+	if (isOrderDeferred) {
+		deferredOrderPositions.push_back(position);
+	}
+	else if (&playlist == activePlaylist) {
+		// New music is played after the current one; if shuffled, at a random position.
+		int orderIndex = (int)playingOrder.size();
+		if (isShuffled_) {
+			std::uniform_int_distribution<int> distribution(playingOrder_currentIndex + 1, (int)playingOrder.size());
+			orderIndex = distribution(rng);
+		}
+		playingOrder.insert(orderIndex, position);
+		playingOrderPlaytime.insert(orderIndex, library.getDuration(musicIndex));
+	}
+}
+
+void core::MusicPlayer::insertDeferredOrderPositions()
+{
+	if (deferredOrderPositions.empty()) {
+		return;
+	}
+	// Like insertIntoPlaylist(): the new music is played after the current one; if shuffled, at random positions.
+	size_t firstOrderIndex = (size_t)std::clamp(playingOrder_currentIndex + 1, 0, (int)playingOrder.size());
+	playingOrder.append(deferredOrderPositions, isShuffled_ ? &rng : nullptr, firstOrderIndex);
+	deferredOrderPositions.clear();
+	rebuildPlayingOrderPlaytime();
+}
+
+void core::MusicPlayer::removeFromPlaylist(Playlist& playlist, int position)
+{
+	if (&playlist == activePlaylist) {
+		insertDeferredOrderPositions(); // ..before the positions move
+	}
+	playlist.duration -= library.getDuration(playlist.musicIndexList[position]);
+	playlist.containedMusic[playlist.musicIndexList[position]] = false;
+	playlist.musicIndexList.erase(playlist.musicIndexList.begin() + position);
+	playlist.drawableList.onRowErased(position);
+
+	if (&playlist == activePlaylist) {
+		// 'playingOrder' contains positions in Playlist::musicIndexList, so all positions after the removed one move by one (see PlayOrder::erase()).
+		int orderIndex = playingOrder.getOrderIndex(position);
+		playingOrder.erase(orderIndex);
+		playingOrderPlaytime.erase(orderIndex);
+		if (orderIndex <= playingOrder_currentIndex) { // if the current music is removed, play(true) continues with the music after it
+			--playingOrder_currentIndex;
+		}
+		if (playingOrder.empty()) {
+			stop();
+		}
+	}
+}
+
+bool core::MusicPlayer::isPlayingMusic(int musicIndex) const
+{
+	return activePlaylist && !isStopped() && (queuedMusicIndex != -1 || (playingOrder_currentIndex >= 0 && playingOrder_currentIndex < playingOrder.size()))
+		&& getPlayingMusicIndex() == musicIndex;
+}
+
 void core::MusicPlayer::handleEvents()
 {
 	// Enter key (Select item):
-	if (drawnPlaylist && drawnPlaylist->drawableList.hasFocus() && core::inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::Select).key))
+	if (drawnPlaylist && !isPlayQueueShown_ && drawnPlaylist->drawableList.hasFocus() && core::inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::Select).key))
 	{
 		drawnPlaylist->drawableList.selectHoveredItem();
 		int playlistMusicIndex = (int)drawnPlaylist->drawableList.getSelectedIndex();
 		if (activePlaylist == drawnPlaylist) {
-			playingOrder_currentIndex = playlistMusicIndex - 1; // -1 because play(true) will increase index by 1
-			play(true); // play next
+			// The selected music is played immediately, even if music is queued:
+			pushHistory();
+			queuedMusicIndex = -1;
+			playingOrder_currentIndex = playingOrder.getOrderIndex(playlistMusicIndex);
+			loadMusic();
 			updateListSelection();
 		}
 		else {
@@ -400,6 +1086,8 @@ void core::MusicPlayer::handleEvents()
 		}
 	}
 
+	handleEditEvents();
+
 	// Up / Down key:
 	if (!isStopped()) {
 		if (inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::NextTrack).key)) {
@@ -533,32 +1221,115 @@ void core::MusicPlayer::handleEvents()
 		}
 	}
 
-	if (drawnPlaylist) {
-		drawnPlaylist->drawableList.handleEvent();
+	DrawableList* drawnList = getDrawnList();
+	if (drawnList) {
+		drawnList->handleEvent();
 	}
 }
 
-void core::MusicPlayer::skipTime(Time skipTime)
+void core::MusicPlayer::handleEditEvents()
 {
-	Time time = trackPlaytime.getElapsedTime() + skipTime;
-	if (time < 0s) {
-		if (Mix_SetMusicPosition(0) == -1) {
-			log("Mix_SetMusicPosition failed (" + getPlayingMusicInfo().path.stem().string() + ")!");
+	// Q-Key:
+	if (drawnPlaylist && inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::ShowQueue).key)) {
+		setPlayQueueShown(!isPlayQueueShown_);
+	}
+	if (!drawnPlaylist) {
+		return;
+	}
+
+	if (!isPlayQueueShown_)
+	{
+		// E-Key (export the drawn playlist for other tools):
+		DrawableList& drawnList = drawnPlaylist->drawableList;
+		if (drawnList.hasFocus() && inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::ExportPlaylist).key)) {
+			std::string exportFilename = drawnPlaylist->name == ALL_PLAYLIST_NAME ? "all.m3u8" : fs::u8path(drawnPlaylist->name).replace_extension(".m3u8").u8string();
+			fs::path exportFilePath = fs::u8path(EXPORT_DIR_PATH) / fs::u8path(exportFilename);
+			std::error_code ec;
+			fs::create_directories(EXPORT_DIR_PATH, ec);
+			if (!exportPlaylist(drawnPlaylist->name, exportFilePath)) {
+				log("Warning: Playlist (" + drawnPlaylist->name + ") could not be exported to '" + exportFilePath.u8string() + "'!");
+			}
+		}
+
+		// N-Key / A-Key (enqueue the hovered music of the drawn playlist):
+		if (!drawnList.hasFocus() || drawnList.size() == 0) {
+			return;
+		}
+		if (inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::EnqueueNext).key)) {
+			playQueue.pushFront(drawnPlaylist->musicIndexList.at(drawnList.getHoverIndex()));
+			playQueueList.onRowsChanged();
+		}
+		else if (inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::EnqueueLast).key)) {
+			playQueue.pushBack(drawnPlaylist->musicIndexList.at(drawnList.getHoverIndex()));
+			playQueueList.onRowsChanged();
 		}
-		trackPlaytime.restart();
+
+		// Delete-Key / PageUp-Key / PageDown-Key (edit the drawn playlist; does nothing for ALL_PLAYLIST_NAME):
+		int position = (int)drawnList.getHoverIndex();
+		if (inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::RemoveEntry).key)) {
+			removeTrack(drawnPlaylist->name, position);
+		}
+		else if (position > 0 && inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::MoveEntryUp).key)) {
+			moveTrack(drawnPlaylist->name, position, position - 1);
+		}
+		else if (position + 1 < (int)drawnList.size() && inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::MoveEntryDown).key)) {
+			moveTrack(drawnPlaylist->name, position, position + 1);
+		}
+		return;
 	}
-	else {
-		if (Mix_SetMusicPosition(time.asSeconds()) == -1) {
-			log("Mix_SetMusicPosition failed (" + getPlayingMusicInfo().path.stem().string() + ")!");
+
+	if (!playQueueList.hasFocus() || playQueue.empty()) {
+		return;
+	}
+	size_t position = playQueueList.getHoverIndex();
+	PlayQueue::EntryID entryID = playQueue.getEntry(position);
+
+	// Enter key (play the hovered entry now):
+	if (inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::Select).key))
+	{
+		if (activePlaylist) {
+			pushHistory();
+			queuedMusicIndex = playQueue.getMusicIndex(entryID);
+			playQueue.erase(entryID);
+			playQueueList.onRowErased(position);
+			loadMusic();
+			updateListSelection();
 		}
-		trackPlaytime.add(skipTime);
+		else {
+			// ..nothing is playing - the drawn playlist is played after the queue, which starts with the hovered entry
+			playQueue.move(entryID, playQueue.getEntry(0));
+			playQueueList.onRowMoved(position, 0);
+			playPlaylist(drawnPlaylist->name);
+		}
+	}
+	// Delete-Key:
+	else if (inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::RemoveEntry).key)) {
+		playQueue.erase(entryID);
+		playQueueList.onRowErased(position);
 	}
+	// PageUp-Key:
+	else if (position > 0 && inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::MoveEntryUp).key)) {
+		playQueue.move(entryID, playQueue.getPrevious(entryID));
+		playQueueList.onRowMoved(position, position - 1);
+	}
+	// PageDown-Key:
+	else if (position + 1 < playQueue.size() && inputDevice::isKeyPressed(app->keymap.get(Keymap::Action::MoveEntryDown).key)) {
+		playQueue.move(entryID, playQueue.getNext(playQueue.getNext(entryID)));
+		playQueueList.onRowMoved(position, position + 1);
+	}
+}
+
+void core::MusicPlayer::skipTime(Time skipTime)
+{
+	Time time = audioPlayer.getPosition() + skipTime;
+	audioPlayer.seek(time < 0ns ? Time() : time);
 }
 
 void core::MusicPlayer::draw()
 {
-	if (drawnPlaylist) {
-		drawnPlaylist->drawableList.draw();
+	DrawableList* drawnList = getDrawnList();
+	if (drawnList) {
+		drawnList->draw();
 	}
 }
 
@@ -571,33 +1342,39 @@ void core::MusicPlayer::playPlaylist(std::string playlistName, int startTrack /*
 	///////////////////////////////////////////////////////////////////////////////
 	// Stop current playlist
 	///////////////////////////////////////////////////////////////////////////////
+	pushHistory();
 	stop();
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Select playlist
 	///////////////////////////////////////////////////////////////////////////////
-	for (Playlist& playlist : playlists) {
-		if (playlist.name == playlistName)
-			activePlaylist = &playlist;
+	activePlaylist = playlists.get(playlists.find(playlistName));
+	if (!activePlaylist) {
+		log("Warning: Playlist (" + playlistName + ") can not be played, because it is not added!");
+		return;
 	}
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Set playlist order
 	///////////////////////////////////////////////////////////////////////////////
-	playingOrder.clear();
-	for (int i = 0; i < activePlaylist->musicIndexList.size(); ++i) {
-		playingOrder.push_back(i);
-	}
+	playingOrder.reset(activePlaylist->musicIndexList.size());
 	playingOrder_currentIndex = startTrack; // required for shuffle [and play()]
 	if (isShuffled_) {
 		shuffle();
 	}
+	else {
+		rebuildPlayingOrderPlaytime();
+	}
 
 	///////////////////////////////////////////////////////////////////////////////
 	// Start playing
 	///////////////////////////////////////////////////////////////////////////////
-	playingOrder_currentIndex += playingOrder_currentIndex == -1 ? 0 : -1; // to play selected track - reduce this before playing next track.
-	play(true);
+	if (startTrack == -1 || playingOrder.empty()) {
+		play(true); // plays the queue first
+	}
+	else {
+		loadMusic(); // shuffle() moved the selected track to the front
+	}
 	playtime.restart();
 
 	///////////////////////////////////////////////////////////////////////////////
@@ -612,31 +1389,52 @@ void core::MusicPlayer::play(bool next)
 		return;
 	}
 
-	if (music != nullptr && replayStatus == Replay::One) {
-		// ..replay same track
-		Mix_PlayMusic(music, 0);
-		trackPlaytime.restart();
+	if (playingOrder.empty()) {
+		// ..all tracks of the playlist were removed
+		stop();
+		return;
+	}
+
+	if (!audioPlayer.getPath().empty() && replayStatus == Replay::One) {
+		// ..replay same track (the audio player already replays it, if it was prefetched)
+		if (!isNextStarted) {
+			audioPlayer.play(audioPlayer.getPath());
+		}
+		prefetchedMusicIndex = -1;
+		return;
+	}
+
+	if (next && !playQueue.empty()) {
+		// ..the queue is played first, 'playingOrder' continues afterwards
+		pushHistory();
+		queuedMusicIndex = playQueue.popFront();
+		playQueueList.onRowErased(0);
+		loadMusic();
+		return;
+	}
+	if (!next && !playQueue.isHistoryEmpty()) {
+		playPrevious();
 		return;
 	}
 	
 	// play next or previous track:
+	if (next) {
+		pushHistory();
+	}
+	queuedMusicIndex = -1;
 	playingOrder_currentIndex += next ? 1 : -1;
 
 	// Stop playlist:
 	if (playingOrder_currentIndex >= playingOrder.size() && replayStatus == Replay::None) 
 	{
 		// ..playlist end reached
-		trackPlaytime.restart();
-		trackPlaytime.pause();
 		playtime.pause();
 		activePlaylist = nullptr;
 		playingOrder_currentIndex = 0;
 		playingOrder.clear();
-		if (music) {
-			Mix_HaltMusic();
-			Mix_FreeMusic(music);
-			music = nullptr;
-		}
+		playingOrderPlaytime.clear();
+		audioPlayer.stop();
+		prefetchedMusicIndex = -1;
 		return;
 	}
 
@@ -651,63 +1449,135 @@ void core::MusicPlayer::play(bool next)
 		}
 	}
 
-	// Play music:
-	if (music) {
-		Mix_HaltMusic(); // required if Mix_FadeOutMusic() is used, otherwise no new music can be played till fade is finished.
-		Mix_FreeMusic(music);
-		music = nullptr;
+	loadMusic();
+}
+
+void core::MusicPlayer::playPrevious()
+{
+	PlayQueue::HistoryEntry previous = playQueue.popHistory();
+	// The current music is played again after the previous one:
+	if (queuedMusicIndex != -1) {
+		playQueue.pushFront(queuedMusicIndex);
+		playQueueList.onRowsChanged();
+	}
+	int position = -1;
+	if (!previous.isQueued) {
+		auto it = std::find(activePlaylist->musicIndexList.begin(), activePlaylist->musicIndexList.end(), previous.musicIndex);
+		position = it != activePlaylist->musicIndexList.end() ? (int)(it - activePlaylist->musicIndexList.begin()) : -1;
+	}
+
+	if (position != -1) {
+		queuedMusicIndex = -1;
+		playingOrder_currentIndex = playingOrder.getOrderIndex(position);
+	}
+	else {
+		// ..the music was queued or is not in the active playlist (anymore), so it is played like queued music
+		if (queuedMusicIndex == -1) {
+			--playingOrder_currentIndex; // 'playingOrder' continues with the current music
+		}
+		queuedMusicIndex = previous.musicIndex;
 	}
-	music = Mix_LoadMUS(getPlayingMusicInfo().path.u8string().c_str()); // 'getPlayingMusicInfo()' depends on 'playingOrder_currentIndex'
-	if (!music) {
-		log("Failed to load music! SDL_mixer Error: " + std::string(Mix_GetError()) + "\n");
-		__debugbreak();
+	loadMusic();
+}
+
+void core::MusicPlayer::loadMusic()
+{
+	// The audio player loads the music in the background; if it is the prefetched next music, it is already loaded or even playing.
+	fs::path musicFilePath = library.getPath(getPlayingMusicIndex()); // depends on 'playingOrder_currentIndex' and 'queuedMusicIndex'
+	if (!isNextStarted || audioPlayer.getPath() != musicFilePath) {
+		audioPlayer.play(musicFilePath);
 	}
-	Mix_PlayMusic(music, 0);
-	// This would start the fade out immediately and there aren't many options, so I do it manually in update().
-	//if (fadeOutEnabled) {
-	//	Mix_FadeOutMusic(10000);
-	//}
-	trackPlaytime.restart();
+	prefetchedMusicIndex = -1; // the audio player has no next music anymore
 
 	// Update duration:
-	activePlaylist->oldTracksPlaytime = 0s;
-	for (int i = 0; i < playingOrder_currentIndex; ++i) { // current music may not be calculated
-		activePlaylist->oldTracksPlaytime += musicInfoList[activePlaylist->musicIndexList[playingOrder[i]]].duration;
+	updateOldTracksPlaytime();
+}
+
+int core::MusicPlayer::getNextMusicIndex() const
+{
+	if (!activePlaylist || playingOrder.empty() || audioPlayer.getPath().empty()) {
+		return -1;
+	}
+	if (replayStatus == Replay::One) {
+		bool isPlayingMusicValid = queuedMusicIndex != -1 || (playingOrder_currentIndex >= 0 && playingOrder_currentIndex < (int)playingOrder.size());
+		return isPlayingMusicValid ? getPlayingMusicIndex() : -1;
+	}
+	if (!playQueue.empty()) {
+		return playQueue.getMusicIndex(playQueue.getEntry(0));
+	}
+	int orderIndex = playingOrder_currentIndex + 1;
+	if (orderIndex >= (int)playingOrder.size()) {
+		if (replayStatus != Replay::All) {
+			return -1;
+		}
+		orderIndex = 0;
+	}
+	return activePlaylist->musicIndexList[playingOrder.at(orderIndex)];
+}
+
+void core::MusicPlayer::prefetchNextMusic()
+{
+	int nextMusicIndex = getNextMusicIndex();
+	if (nextMusicIndex != prefetchedMusicIndex) {
+		audioPlayer.setNext(nextMusicIndex == -1 ? fs::path() : library.getPath(nextMusicIndex));
+		prefetchedMusicIndex = nextMusicIndex;
+	}
+}
+
+void core::MusicPlayer::pushHistory()
+{
+	if (audioPlayer.getPath().empty() || !activePlaylist) {
+		return;
+	}
+	if (queuedMusicIndex != -1) {
+		playQueue.pushHistory({ queuedMusicIndex, true });
 	}
+	else if (playingOrder_currentIndex >= 0 && playingOrder_currentIndex < (int)playingOrder.size()) {
+		playQueue.pushHistory({ getPlayingMusicIndex(), false });
+	}
+}
+
+void core::MusicPlayer::updateOldTracksPlaytime()
+{
+	// current music may not be calculated
+	activePlaylist->oldTracksPlaytime = playingOrderPlaytime.getPlaytimeBefore(std::clamp(playingOrder_currentIndex, 0, (int)playingOrderPlaytime.size()));
+}
+
+void core::MusicPlayer::rebuildPlayingOrderPlaytime()
+{
+	std::vector<Time> durations;
+	durations.reserve(playingOrder.size());
+	for (int playlistMusicIndex : playingOrder) {
+		durations.push_back(library.getDuration(activePlaylist->musicIndexList[playlistMusicIndex]));
+	}
+	playingOrderPlaytime.assign(durations);
 }
 
 void core::MusicPlayer::resume()
 {
-	Mix_ResumeMusic();
-	trackPlaytime.resume();
+	audioPlayer.resume();
 }
 
 void core::MusicPlayer::pause()
 {
-	Mix_PauseMusic();
-	trackPlaytime.pause();
+	audioPlayer.pause();
 }
 
 void core::MusicPlayer::stop()
 {
-	trackPlaytime.restart();
-	trackPlaytime.stop();
 	playtime.stop();
 	activePlaylist = nullptr;
 	playingOrder_currentIndex = -1;
+	queuedMusicIndex = -1;
 	playingOrder.clear();
-	if (music) {
-		Mix_HaltMusic();
-		Mix_FreeMusic(music);
-		music = nullptr;
-	}
+	playingOrderPlaytime.clear();
+	deferredOrderPositions.clear();
+	audioPlayer.stop();
+	prefetchedMusicIndex = -1;
 }
 
 void core::MusicPlayer::shuffle()
 {
-	static std::random_device rd;
-	static auto rng = std::mt19937(rd());
-
 	isShuffled_ = true;
 
 	if (playingOrder.empty()) {
@@ -718,34 +1588,38 @@ void core::MusicPlayer::shuffle()
 
 	if (playingOrder_currentIndex == -1) {
 		// No music is playing or paused, so shuffle everything.
-		std::shuffle(std::begin(playingOrder), std::end(playingOrder), rng);
+		playingOrder.shuffle(rng);
 	}
 	else {
 		// Shuffling only the remaining music is a bad idea, beacause if the playlist loops, then if the shuffle happend
 		// at the last music, the playlist would not be shuffled at all. For instance the Samsung music player replays 
 		// everything after an shuffle.
-		int playlist_currentMusicIndex = playingOrder.at(playingOrder_currentIndex);
-		playingOrder.erase(playingOrder.begin() + playingOrder_currentIndex);
-		playingOrder.insert(playingOrder.begin(), playlist_currentMusicIndex);
-		std::shuffle(std::begin(playingOrder) + 1, std::end(playingOrder), rng);
+		playingOrder.shuffle(rng, playingOrder.at(playingOrder_currentIndex));
 		playingOrder_currentIndex = 0;
 	}
+	if (isSameArtistSeparated) {
+		std::vector<std::string_view> artists;
+		artists.reserve(activePlaylist->musicIndexList.size());
+		for (int musicIndex : activePlaylist->musicIndexList) {
+			artists.push_back(library.getArtist(musicIndex));
+		}
+		playingOrder.separateGroups(artists);
+	}
+	rebuildPlayingOrderPlaytime();
+	updateOldTracksPlaytime();
 }
 
 void core::MusicPlayer::resetShuffle()
 {
 	if (!playingOrder.empty())
 	{
-		int playlist_currentMusicIndex = playingOrder.at(playingOrder_currentIndex);
-		std::sort(playingOrder.begin(), playingOrder.end(), [](const int& a, const int& b) {
-			return a < b;
-			});
-		for (int i = 0; i < playingOrder.size(); ++i) {
-			if (playlist_currentMusicIndex == playingOrder[i]) {
-				playingOrder_currentIndex = i;
-				break;
-			}
+		// In the unshuffled order the order index is the playlist position.
+		if (playingOrder_currentIndex >= 0 && playingOrder_currentIndex < (int)playingOrder.size()) {
+			playingOrder_currentIndex = playingOrder.at(playingOrder_currentIndex);
 		}
+		playingOrder.reset(playingOrder.size());
+		rebuildPlayingOrderPlaytime();
+		updateOldTracksPlaytime();
 	}
 	isShuffled_ = false;
 }
@@ -755,6 +1629,7 @@ void core::MusicPlayer::onConsoleResize()
 	for (Playlist& playlist : playlists) {
 		playlist.drawableList.onConsoleResize();
 	}
+	playQueueList.onConsoleResize();
 }
 
 void core::MusicPlayer::stopDrawableListEvents()
@@ -762,6 +1637,7 @@ void core::MusicPlayer::stopDrawableListEvents()
 	for (Playlist& playlist : playlists) {
 		playlist.drawableList.loseFocus();
 	}
+	playQueueList.loseFocus();
 }
 
 void core::MusicPlayer::resumeDrawableListEvents()
@@ -769,6 +1645,7 @@ void core::MusicPlayer::resumeDrawableListEvents()
 	for (Playlist& playlist : playlists) {
 		playlist.drawableList.gainFocus();
 	}
+	playQueueList.gainFocus();
 }
 
 void core::MusicPlayer::scrollDrawableListToTop()
@@ -776,42 +1653,51 @@ void core::MusicPlayer::scrollDrawableListToTop()
 	for (Playlist& playlist : playlists) {
 		playlist.drawableList.scrollToTop();
 	}
+	playQueueList.scrollToTop();
 }
 
 void core::MusicPlayer::setDrawnPlaylist(std::string playlistName /*= ""*/)
 {
+	isPlayQueueShown_ = false;
 	if (playlistName.empty()) {
 		drawnPlaylist = nullptr;
 	}
 	else if (!playlistName.empty()) {
-		bool found = false;
-		for (Playlist& playlist : playlists) {
-			if (playlist.name == playlistName) {
-				drawnPlaylist = &playlist;
-				found = true;
-			}
+		Playlist* playlist = playlists.get(playlists.find(playlistName));
+		if (playlist) {
+			drawnPlaylist = playlist;
 		}
-		if (!found) {
+		else {
 			log("Debug: Playlist not found in setDrawnPlaylist()!");
 			__debugbreak();
 		}
 	}
 }
 
+void core::MusicPlayer::setPlayQueueShown(bool isShown)
+{
+	isPlayQueueShown_ = isShown;
+}
+
+bool core::MusicPlayer::isPlayQueueShown() const
+{
+	return isPlayQueueShown_;
+}
+
 void core::MusicPlayer::setVolume(float volume)
 {
-	Mix_VolumeMusic(volume);
+	audioPlayer.setVolume(volume);
 	this->volume = volume;
 }
 
-const core::MusicPlayer::MusicInfo& core::MusicPlayer::getPlayingMusicInfo() const
+core::MusicPlayer::MusicInfo core::MusicPlayer::getPlayingMusicInfo() const
 {
 	/*
 		playingOrder:               index in Playlist::musicIndexList
-		Playlist::musicIndexList:   index in MusicPlayer::musicInfoList
-		MusicPlayer::musicInfoList: music information
+		Playlist::musicIndexList:   index in MusicPlayer::library
+		MusicPlayer::library:       music information
 	*/
-	return musicInfoList.at(getPlayingMusicIndex());
+	return library.get(getPlayingMusicIndex());
 }
 
 int core::MusicPlayer::getPlaylistPlayingMusicIndex() const
@@ -821,12 +1707,36 @@ int core::MusicPlayer::getPlaylistPlayingMusicIndex() const
 
 int core::MusicPlayer::getPlayingMusicIndex() const
 {
+	if (queuedMusicIndex != -1) {
+		return queuedMusicIndex;
+	}
 	return activePlaylist->musicIndexList.at(getPlaylistPlayingMusicIndex());
 }
 
+core::DrawableList* core::MusicPlayer::getDrawnList()
+{
+	if (!drawnPlaylist) {
+		return nullptr;
+	}
+	return isPlayQueueShown_ ? &playQueueList : &drawnPlaylist->drawableList;
+}
+
+const core::DrawableList* core::MusicPlayer::getDrawnList() const
+{
+	if (!drawnPlaylist) {
+		return nullptr;
+	}
+	return isPlayQueueShown_ ? &playQueueList : &drawnPlaylist->drawableList;
+}
+
+core::MusicPlayer::Playlist& core::MusicPlayer::getAllPlaylist()
+{
+	return *playlists.get(playlists.find(ALL_PLAYLIST_NAME)); // is added by init() and never removed
+}
+
 const core::Time core::MusicPlayer::getPlayingMusicElapsedTime() const
 {
-	return trackPlaytime.getElapsedTime();
+	return audioPlayer.getPosition();
 }
 
 std::string core::MusicPlayer::getActivePlaylistName() const
@@ -837,6 +1747,18 @@ std::string core::MusicPlayer::getActivePlaylistName() const
 	return "";
 }
 
+std::vector<std::string> core::MusicPlayer::getPlaylistNames() const
+{
+	std::vector<std::string> playlistNames;
+	playlistNames.reserve(playlists.size());
+	for (const Playlist& playlist : playlists) {
+		if (playlist.name != ALL_PLAYLIST_NAME) {
+			playlistNames.push_back(playlist.name);
+		}
+	}
+	return playlistNames;
+}
+
 float core::MusicPlayer::getVolume() const
 {
 	return volume;
@@ -888,24 +1810,36 @@ core::Time core::MusicPlayer::getActivePlaylistPlaytime() const
 	return activePlaylist->oldTracksPlaytime + getPlayingMusicElapsedTime();
 }
 
+core::Time core::MusicPlayer::getActivePlaylistRemainingTime() const
+{
+	Time remainingTime = playingOrderPlaytime.getTotal() - getActivePlaylistPlaytime();
+	return remainingTime > Time() ? remainingTime : Time();
+}
+
+core::Time core::MusicPlayer::getTimeUntilTrack(int trackNumber) const
+{
+	Time timeUntilTrack = playingOrderPlaytime.getPlaytimeBefore(std::clamp(trackNumber - 1, 0, (int)playingOrderPlaytime.size())) - getActivePlaylistPlaytime();
+	return timeUntilTrack > Time() ? timeUntilTrack : Time();
+}
+
 bool core::MusicPlayer::isPlaying() const
 {
-	return Mix_PlayingMusic() && !Mix_PausedMusic(); // SDL2 treats paused music as playing music
+	return !audioPlayer.isStopped() && !audioPlayer.isPaused();
 }
 
 bool core::MusicPlayer::isPaused() const
 {
-	return Mix_PausedMusic();
+	return !audioPlayer.isStopped() && audioPlayer.isPaused();
 }
 
 bool core::MusicPlayer::isStopped() const
 {
-	return !Mix_PlayingMusic();
+	return audioPlayer.isStopped();
 }
 
 bool core::MusicPlayer::empty() const
 {
-	return musicInfoList.empty();
+	return library.getMusicCount() == 0;
 }
 
 bool core::MusicPlayer::isShuffled() const
@@ -913,10 +1847,16 @@ bool core::MusicPlayer::isShuffled() const
 	return isShuffled_;
 }
 
+bool core::MusicPlayer::isScanning() const
+{
+	return isScanning_;
+}
+
 bool core::MusicPlayer::isTrappedOnTop() const
 {
-	if (drawnPlaylist) {
-		return drawnPlaylist->drawableList.isTrappedOnTop();
+	const DrawableList* drawnList = getDrawnList();
+	if (drawnList) {
+		return drawnList->isTrappedOnTop();
 	}
 	return false;
 }
\ No newline at end of file
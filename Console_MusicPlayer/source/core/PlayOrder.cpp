@@ -0,0 +1,162 @@
+#include "core/PlayOrder.hpp"
+#include <algorithm>
+#include <numeric>
+#include <deque>
+#include <cassert>
+
+void core::PlayOrder::reset(size_t size)
+{
+	order.resize(size);
+	std::iota(order.begin(), order.end(), 0);
+	orderIndices = order;
+}
+
+void core::PlayOrder::clear()
+{
+	order.clear();
+	orderIndices.clear();
+}
+
+void core::PlayOrder::shuffle(std::mt19937& rng, int firstPosition /*= -1*/)
+{
+	if (firstPosition == -1) {
+		std::shuffle(order.begin(), order.end(), rng);
+	}
+	else {
+		std::swap(order[0], order[orderIndices.at(firstPosition)]);
+		std::shuffle(order.begin() + 1, order.end(), rng);
+	}
+	updateOrderIndices();
+}
+
+void core::PlayOrder::separateGroups(const std::vector<std::string_view>& groups)
+{
+	assert(groups.size() == order.size());
+	std::vector<int> separatedOrder;
+	separatedOrder.reserve(order.size());
+	std::deque<int> deferredPositions; // in play order, so the shuffle stays random
+	auto isConflict = [&](int position) {
+		return !separatedOrder.empty() && !groups[position].empty() && groups[position] == groups[separatedOrder.back()];
+	};
+	for (int position : order) {
+		while (!deferredPositions.empty() && !isConflict(deferredPositions.front())) {
+			separatedOrder.push_back(deferredPositions.front());
+			deferredPositions.pop_front();
+		}
+		if (isConflict(position)) {
+			deferredPositions.push_back(position);
+		}
+		else {
+			separatedOrder.push_back(position);
+		}
+	}
+	// The rest is mostly one group, which was too frequent at the end. It is put into the gaps between two other groups
+	// (in one pass) and what is still left is appended.
+	order.clear();
+	auto isSameGroup = [&](int position, int otherPosition) {
+		return !groups[position].empty() && groups[position] == groups[otherPosition];
+	};
+	for (size_t i = 0; i < separatedOrder.size(); ++i) {
+		order.push_back(separatedOrder[i]);
+		bool hasNext = i + 1 < separatedOrder.size();
+		if (!deferredPositions.empty() && hasNext
+			&& !isSameGroup(deferredPositions.front(), separatedOrder[i]) && !isSameGroup(deferredPositions.front(), separatedOrder[i + 1])) {
+			order.push_back(deferredPositions.front());
+			deferredPositions.pop_front();
+		}
+	}
+	order.insert(order.end(), deferredPositions.begin(), deferredPositions.end());
+	updateOrderIndices();
+}
+
+void core::PlayOrder::insert(size_t orderIndex, int position)
+{
+	assert(orderIndex <= order.size() && position >= 0 && position <= (int)order.size());
+	for (int& otherPosition : order) {
+		if (otherPosition >= position) {
+			++otherPosition;
+		}
+	}
+	order.insert(order.begin() + orderIndex, position);
+	updateOrderIndices();
+}
+
+void core::PlayOrder::append(const std::vector<int>& positions, std::mt19937* rng /*= nullptr*/, size_t firstOrderIndex /*= 0*/)
+{
+	assert(firstOrderIndex <= order.size());
+	if (!rng) {
+		order.insert(order.end(), positions.begin(), positions.end());
+	}
+	else {
+		// Which order indices after 'firstOrderIndex' get a new position is shuffled; the old positions keep their order.
+		std::vector<int> newPositions = positions;
+		std::shuffle(newPositions.begin(), newPositions.end(), *rng);
+		std::vector<char> isNew(order.size() - firstOrderIndex + newPositions.size(), false); // std::vector<bool> has no real iterators for std::shuffle()
+		std::fill(isNew.begin(), isNew.begin() + newPositions.size(), true);
+		std::shuffle(isNew.begin(), isNew.end(), *rng);
+		std::vector<int> oldPositions(order.begin() + firstOrderIndex, order.end());
+		order.resize(firstOrderIndex);
+		auto newIt = newPositions.begin();
+		auto oldIt = oldPositions.begin();
+		for (char isNewIndex : isNew) {
+			order.push_back(isNewIndex ? *newIt++ : *oldIt++);
+		}
+	}
+	assert(std::all_of(positions.begin(), positions.end(), [&](int position) { return position >= 0 && position < (int)order.size(); }));
+	updateOrderIndices();
+}
+
+void core::PlayOrder::erase(size_t orderIndex)
+{
+	int position = order.at(orderIndex);
+	order.erase(order.begin() + orderIndex);
+	for (int& otherPosition : order) {
+		if (otherPosition > position) {
+			--otherPosition;
+		}
+	}
+	updateOrderIndices();
+}
+
+int core::PlayOrder::at(size_t orderIndex) const
+{
+	return order.at(orderIndex);
+}
+
+int core::PlayOrder::operator[](size_t orderIndex) const
+{
+	return order[orderIndex];
+}
+
+int core::PlayOrder::getOrderIndex(int position) const
+{
+	return orderIndices.at(position);
+}
+
+size_t core::PlayOrder::size() const
+{
+	return order.size();
+}
+
+bool core::PlayOrder::empty() const
+{
+	return order.empty();
+}
+
+std::vector<int>::const_iterator core::PlayOrder::begin() const
+{
+	return order.begin();
+}
+
+std::vector<int>::const_iterator core::PlayOrder::end() const
+{
+	return order.end();
+}
+
+void core::PlayOrder::updateOrderIndices()
+{
+	orderIndices.resize(order.size());
+	for (int i = 0; i < (int)order.size(); ++i) {
+		orderIndices[order[i]] = i;
+	}
+}
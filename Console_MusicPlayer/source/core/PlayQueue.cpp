@@ -0,0 +1,207 @@
+#include "core/PlayQueue.hpp"
+#include "core/MusicLibrary.hpp"
+#include "core/SmallTools.hpp"
+#include <cassert>
+
+///////////////////////////////////////////////////////////////////////////////
+// Queue
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlayQueue::EntryID core::PlayQueue::pushFront(int musicIndex)
+{
+	EntryID entryID = allocate(musicIndex);
+	link(entryID, first);
+	return entryID;
+}
+
+core::PlayQueue::EntryID core::PlayQueue::pushBack(int musicIndex)
+{
+	EntryID entryID = allocate(musicIndex);
+	link(entryID, NOENTRY);
+	return entryID;
+}
+
+int core::PlayQueue::popFront()
+{
+	if (empty()) {
+		return -1;
+	}
+	int musicIndex = entries[first].musicIndex;
+	erase(first);
+	return musicIndex;
+}
+
+void core::PlayQueue::erase(EntryID entryID)
+{
+	unlink(entryID);
+	freeEntries.push_back(entryID);
+}
+
+void core::PlayQueue::move(EntryID entryID, EntryID nextEntryID)
+{
+	if (entryID == nextEntryID) {
+		return;
+	}
+	unlink(entryID);
+	link(entryID, nextEntryID);
+}
+
+void core::PlayQueue::clear()
+{
+	entries.clear();
+	freeEntries.clear();
+	first = NOENTRY;
+	last = NOENTRY;
+	count = 0;
+	cursorEntry = NOENTRY;
+}
+
+core::PlayQueue::EntryID core::PlayQueue::getEntry(size_t position) const
+{
+	assert(position < count);
+	// Start at the closest of the front, the back and the cursor:
+	EntryID entryID = first;
+	size_t entryPosition = 0;
+	if (count - 1 - position < position) {
+		entryID = last;
+		entryPosition = count - 1;
+	}
+	size_t distance = entryPosition > position ? entryPosition - position : position - entryPosition;
+	if (cursorEntry != NOENTRY && (cursorPosition > position ? cursorPosition - position : position - cursorPosition) < distance) {
+		entryID = cursorEntry;
+		entryPosition = cursorPosition;
+	}
+
+	for (; entryPosition < position; ++entryPosition) {
+		entryID = entries[entryID].next;
+	}
+	for (; entryPosition > position; --entryPosition) {
+		entryID = entries[entryID].previous;
+	}
+	cursorEntry = entryID;
+	cursorPosition = position;
+	return entryID;
+}
+
+core::PlayQueue::EntryID core::PlayQueue::getNext(EntryID entryID) const
+{
+	return entries[entryID].next;
+}
+
+core::PlayQueue::EntryID core::PlayQueue::getPrevious(EntryID entryID) const
+{
+	return entries[entryID].previous;
+}
+
+int core::PlayQueue::getMusicIndex(EntryID entryID) const
+{
+	return entries[entryID].musicIndex;
+}
+
+size_t core::PlayQueue::size() const
+{
+	return count;
+}
+
+bool core::PlayQueue::empty() const
+{
+	return count == 0;
+}
+
+core::PlayQueue::EntryID core::PlayQueue::allocate(int musicIndex)
+{
+	if (freeEntries.empty()) {
+		entries.push_back({ musicIndex, NOENTRY, NOENTRY });
+		return (EntryID)entries.size() - 1;
+	}
+	EntryID entryID = freeEntries.back();
+	freeEntries.pop_back();
+	entries[entryID] = { musicIndex, NOENTRY, NOENTRY };
+	return entryID;
+}
+
+void core::PlayQueue::link(EntryID entryID, EntryID nextEntryID)
+{
+	Entry& entry = entries[entryID];
+	entry.next = nextEntryID;
+	entry.previous = nextEntryID == NOENTRY ? last : entries[nextEntryID].previous;
+	(entry.previous == NOENTRY ? first : entries[entry.previous].next) = entryID;
+	(entry.next == NOENTRY ? last : entries[entry.next].previous) = entryID;
+	++count;
+	// The cursor position is only still valid, if the entry was added at the back:
+	if (nextEntryID != NOENTRY) {
+		cursorEntry = NOENTRY;
+	}
+}
+
+void core::PlayQueue::unlink(EntryID entryID)
+{
+	Entry& entry = entries[entryID];
+	(entry.previous == NOENTRY ? first : entries[entry.previous].next) = entry.next;
+	(entry.next == NOENTRY ? last : entries[entry.next].previous) = entry.previous;
+	--count;
+	cursorEntry = NOENTRY;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// History
+///////////////////////////////////////////////////////////////////////////////
+
+void core::PlayQueue::pushHistory(HistoryEntry entry)
+{
+	if (history.size() == HISTORY_SIZE) {
+		history.erase(history.begin(), history.begin() + HISTORY_SIZE / 2); // amortized O(1)
+	}
+	history.push_back(entry);
+}
+
+core::PlayQueue::HistoryEntry core::PlayQueue::popHistory()
+{
+	if (history.empty()) {
+		return { -1, false };
+	}
+	HistoryEntry entry = history.back();
+	history.pop_back();
+	return entry;
+}
+
+bool core::PlayQueue::isHistoryEmpty() const
+{
+	return history.empty();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PlayQueueRows
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlayQueueRows::PlayQueueRows(const MusicLibrary* library, const PlayQueue* playQueue)
+	: library(library), playQueue(playQueue)
+{
+}
+
+size_t core::PlayQueueRows::size() const
+{
+	return playQueue ? playQueue->size() : 0;
+}
+
+core::DrawableList::Row core::PlayQueueRows::getRow(size_t index) const
+{
+	int musicIndex = playQueue->getMusicIndex(playQueue->getEntry(index));
+	return { std::string(library->getTitle(musicIndex)), core::getTimeStr(library->getDuration(musicIndex)) };
+}
+
+int core::PlayQueueRows::getMaxLength(size_t columnIndex) const
+{
+	if (columnIndex != 1) {
+		return RowProvider::getMaxLength(columnIndex);
+	}
+	// A longer duration never has a shorter string ("9:59" < "10:00" < "1:00:00").
+	Time maxDuration = 0ns;
+	for (PlayQueue::EntryID entryID = playQueue->empty() ? PlayQueue::NOENTRY : playQueue->getEntry(0); entryID != PlayQueue::NOENTRY; entryID = playQueue->getNext(entryID)) {
+		Time duration = library->getDuration(playQueue->getMusicIndex(entryID));
+		if (duration > maxDuration) {
+			maxDuration = duration;
+		}
+	}
+	return (int)core::getTimeStr(maxDuration).length();
+}
@@ -0,0 +1,341 @@
+#include "core/PlaylistFile.hpp"
+#include "core/SmallTools.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cwctype>
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper
+///////////////////////////////////////////////////////////////////////////////
+
+intern bool startsWithNoCase(std::string_view str, std::string_view prefix)
+{
+	if (str.size() < prefix.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < prefix.size(); ++i) {
+		if (std::tolower((unsigned char)str[i]) != std::tolower((unsigned char)prefix[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** "file:///C:/My%20Music/a.mp3" -> "C:/My Music/a.mp3" */
+intern std::wstring decodeFileURL(const std::wstring& url)
+{
+	std::string path = core::toStr(url.substr(7)); // without "file://"
+	if (path.size() >= 3 && path[0] == '/' && path[2] == ':') {
+		path.erase(0, 1); // "/C:/" is a windows path
+	}
+	std::string decodedPath;
+	decodedPath.reserve(path.size());
+	for (size_t i = 0; i < path.size(); ++i) {
+		if (path[i] == '%' && i + 2 < path.size() && std::isxdigit((unsigned char)path[i + 1]) && std::isxdigit((unsigned char)path[i + 2])) {
+			decodedPath += (char)std::stoi(path.substr(i + 1, 2), nullptr, 16);
+			i += 2;
+		}
+		else {
+			decodedPath += path[i];
+		}
+	}
+	return core::decodePlaylistLine(decodedPath);
+}
+
+/** Both paths have to be absolute and normal. */
+intern bool isInDirectory(const fs::path& path, const fs::path& dirPath)
+{
+	fs::path relativePath = path.lexically_relative(dirPath);
+	return !relativePath.empty() && *relativePath.begin() != "..";
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Functions
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlaylistFileFormat core::getPlaylistFileFormat(const fs::path& filePath)
+{
+	std::wstring extension = filePath.extension().wstring();
+	for (wchar_t& c : extension) {
+		c = std::towlower(c);
+	}
+	if (extension == L".m3u")  return PlaylistFileFormat::M3U;
+	if (extension == L".m3u8") return PlaylistFileFormat::M3U8;
+	if (extension == L".pls")  return PlaylistFileFormat::PLS;
+	return PlaylistFileFormat::Unknown;
+}
+
+std::wstring core::decodePlaylistLine(const std::string& line)
+{
+	try {
+		return toWStr(line);
+	}
+	catch (const std::range_error&) {
+		return std::wstring(line.begin(), line.end());
+	}
+}
+
+fs::path core::resolvePlaylistEntryPath(const std::wstring& entryPath, const fs::path& playlistDirPath, const std::vector<fs::path>& musicDirs)
+{
+	fs::path path;
+	if (entryPath.compare(0, 7, L"file://") == 0) {
+		path = decodeFileURL(entryPath);
+	}
+	else if (entryPath.find(L"://") != std::wstring::npos) {
+		return fs::path(); // stream
+	}
+	else {
+		path = entryPath;
+	}
+
+	if (path.is_absolute()) {
+		return path.lexically_normal();
+	}
+	if (path.has_root_directory()) {
+		return (playlistDirPath.root_name() / path).lexically_normal(); // "\Music\a.mp3" is on the drive of the playlist
+	}
+	fs::path nextToPlaylistPath = (playlistDirPath / path).lexically_normal();
+	if (fs::exists(nextToPlaylistPath)) {
+		return nextToPlaylistPath;
+	}
+	for (const fs::path& musicDir : musicDirs) {
+		fs::path inMusicDirPath = (musicDir / path).lexically_normal();
+		if (fs::exists(inMusicDirPath)) {
+			return inMusicDirPath;
+		}
+	}
+	return nextToPlaylistPath;
+}
+
+bool core::importPlaylistFile(const fs::path& filePath, const fs::path& playlistFilePath, const std::vector<fs::path>& musicDirs, std::vector<std::string>& warnings)
+{
+	PlaylistFileReader reader;
+	if (!reader.open(filePath)) {
+		warnings.push_back("Warning: Playlist (" + filePath.u8string() + ") can not be read!");
+		return false;
+	}
+	fs::path tempFilePath = playlistFilePath;
+	tempFilePath += ".tmp";
+	std::ofstream ofs(tempFilePath, std::ios::out | std::ios::trunc);
+	if (!ofs) {
+		warnings.push_back("Warning: Playlist (" + playlistFilePath.u8string() + ") can not be written!");
+		return false;
+	}
+
+	fs::path playlistDirPath = fs::absolute(filePath).parent_path();
+	std::vector<fs::path> absoluteMusicDirs;
+	for (const fs::path& musicDir : musicDirs) {
+		absoluteMusicDirs.push_back(fs::absolute(musicDir).lexically_normal());
+	}
+	PlaylistFileEntry entry;
+	while (reader.next(entry)) {
+		fs::path musicFilePath = resolvePlaylistEntryPath(entry.path, playlistDirPath, absoluteMusicDirs);
+		if (musicFilePath.empty()) {
+			warnings.push_back("Warning: Playlist (" + filePath.u8string() + ") skipped the stream '" + toStr(entry.path) + "'!");
+			continue;
+		}
+		// A file which does not exist may be found by its filename in the library (e.g. the playlist was created on another computer):
+		if (fs::exists(musicFilePath) && std::none_of(absoluteMusicDirs.begin(), absoluteMusicDirs.end(), [&](const fs::path& musicDir) { return isInDirectory(musicFilePath, musicDir); })) {
+			warnings.push_back("Warning: Playlist (" + filePath.u8string() + ") skipped '" + musicFilePath.u8string() + "', which is in no music directory!");
+			continue;
+		}
+		ofs << musicFilePath.filename().u8string() << "\n"; // Playlist should only hold filenames, so that music files can be moved without editing the playlist file.
+	}
+	ofs.close();
+	std::error_code ec;
+	if (!ofs) {
+		fs::remove(tempFilePath, ec);
+		warnings.push_back("Warning: Playlist (" + playlistFilePath.u8string() + ") can not be written!");
+		return false;
+	}
+	fs::rename(tempFilePath, playlistFilePath, ec);
+	if (ec) {
+		fs::remove(tempFilePath, ec);
+		warnings.push_back("Warning: Playlist (" + playlistFilePath.u8string() + ") can not be written!");
+		return false;
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PlaylistFileReader
+///////////////////////////////////////////////////////////////////////////////
+
+bool core::PlaylistFileReader::open(const fs::path& filePath)
+{
+	format = getPlaylistFileFormat(filePath);
+	ifs = std::ifstream(filePath, std::ios::in);
+	isFirstLine = true;
+	pendingEntry = {};
+	pendingNumber = -1;
+	return format != PlaylistFileFormat::Unknown && ifs.is_open();
+}
+
+bool core::PlaylistFileReader::next(PlaylistFileEntry& entry)
+{
+	if (format == PlaylistFileFormat::PLS) {
+		return nextPLS(entry);
+	}
+	return nextM3U(entry);
+}
+
+bool core::PlaylistFileReader::readLine(std::string& line)
+{
+	if (!std::getline(ifs, line)) {
+		return false;
+	}
+	if (!line.empty() && line.back() == '\r') {
+		line.pop_back();
+	}
+	if (isFirstLine && line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+		line.erase(0, 3);
+	}
+	isFirstLine = false;
+	return true;
+}
+
+bool core::PlaylistFileReader::nextM3U(PlaylistFileEntry& entry)
+{
+	std::string line;
+	while (readLine(line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line[0] != '#') {
+			entry = std::move(pendingEntry);
+			entry.path = decodePlaylistLine(line);
+			pendingEntry = {};
+			return true;
+		}
+		// "#EXTINF:<seconds>,<title>" belongs to the next path; other comments (e.g. "#EXTM3U") are skipped:
+		if (line.compare(0, 8, "#EXTINF:") == 0) {
+			size_t commaPos = line.find(',', 8);
+			try {
+				pendingEntry.durationInSec = std::stoi(line.substr(8, commaPos - 8));
+			}
+			catch (const std::logic_error&) {
+				pendingEntry.durationInSec = -1;
+			}
+			pendingEntry.title = commaPos == std::string::npos ? "" : toStr(decodePlaylistLine(line.substr(commaPos + 1)));
+		}
+	}
+	return false;
+}
+
+bool core::PlaylistFileReader::nextPLS(PlaylistFileEntry& entry)
+{
+	// The keys of an entry are usually in a row ("File1", "Title1", "Length1"), so the entry is complete when the next one starts:
+	std::string line;
+	while (readLine(line)) {
+		size_t equalPos = line.find('=');
+		if (equalPos == std::string::npos) {
+			continue; // e.g. "[playlist]"
+		}
+		std::string_view key(line.data(), equalPos);
+		std::string value = line.substr(equalPos + 1);
+		size_t keyLength = startsWithNoCase(key, "file") ? 4 : startsWithNoCase(key, "title") ? 5 : startsWithNoCase(key, "length") ? 6 : 0;
+		if (keyLength == 0 || keyLength == key.size() || key.size() - keyLength > 9 || key.find_first_not_of("0123456789", keyLength) != std::string_view::npos) {
+			continue; // e.g. "NumberOfEntries" or "Version"
+		}
+		int number = std::stoi(std::string(key.substr(keyLength)));
+
+		bool isEntryComplete = number != pendingNumber && !pendingEntry.path.empty();
+		if (isEntryComplete) {
+			entry = std::move(pendingEntry);
+		}
+		if (number != pendingNumber) {
+			pendingEntry = {};
+			pendingNumber = number;
+		}
+		if (keyLength == 4) {
+			pendingEntry.path = decodePlaylistLine(value);
+		}
+		else if (keyLength == 5) {
+			pendingEntry.title = toStr(decodePlaylistLine(value));
+		}
+		else {
+			try {
+				pendingEntry.durationInSec = std::stoi(value);
+			}
+			catch (const std::logic_error&) {
+				pendingEntry.durationInSec = -1;
+			}
+		}
+		if (isEntryComplete) {
+			return true;
+		}
+	}
+	if (!pendingEntry.path.empty()) {
+		entry = std::move(pendingEntry);
+		pendingEntry = {};
+		return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PlaylistFileWriter
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlaylistFileWriter::~PlaylistFileWriter()
+{
+	if (ofs.is_open()) {
+		ofs.close();
+		std::error_code ec;
+		fs::remove(tempFilePath, ec);
+	}
+}
+
+bool core::PlaylistFileWriter::open(const fs::path& filePath)
+{
+	this->filePath = filePath;
+	tempFilePath = filePath;
+	tempFilePath += ".tmp";
+	format = getPlaylistFileFormat(filePath);
+	entryCount = 0;
+	if (format == PlaylistFileFormat::Unknown) {
+		return false;
+	}
+	ofs = std::ofstream(tempFilePath, std::ios::out | std::ios::trunc);
+	if (format == PlaylistFileFormat::PLS) {
+		ofs << "[playlist]\n";
+	}
+	else {
+		ofs << "#EXTM3U\n";
+	}
+	return (bool)ofs;
+}
+
+void core::PlaylistFileWriter::write(const PlaylistFileEntry& entry)
+{
+	++entryCount;
+	if (format == PlaylistFileFormat::PLS) {
+		ofs << "File" << entryCount << "=" << toStr(entry.path) << "\n";
+		if (!entry.title.empty()) {
+			ofs << "Title" << entryCount << "=" << entry.title << "\n";
+		}
+		ofs << "Length" << entryCount << "=" << entry.durationInSec << "\n";
+	}
+	else {
+		ofs << "#EXTINF:" << entry.durationInSec << "," << entry.title << "\n" << toStr(entry.path) << "\n";
+	}
+}
+
+bool core::PlaylistFileWriter::close()
+{
+	if (format == PlaylistFileFormat::PLS) {
+		ofs << "NumberOfEntries=" << entryCount << "\nVersion=2\n";
+	}
+	ofs.close();
+	std::error_code ec;
+	if (!ofs) {
+		fs::remove(tempFilePath, ec);
+		return false;
+	}
+	fs::rename(tempFilePath, filePath, ec);
+	if (ec) {
+		fs::remove(tempFilePath, ec);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,136 @@
+#include "core/PlaylistRegistry.hpp"
+#include "core/MusicLibrary.hpp"
+#include "core/SmallTools.hpp"
+#include <algorithm>
+
+///////////////////////////////////////////////////////////////////////////////
+// PlaylistRows
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlaylistRows::PlaylistRows(const MusicLibrary* library, const std::vector<int>* musicIndexList)
+	: library(library), musicIndexList(musicIndexList)
+{
+}
+
+size_t core::PlaylistRows::size() const
+{
+	return musicIndexList ? musicIndexList->size() : 0;
+}
+
+core::DrawableList::Row core::PlaylistRows::getRow(size_t index) const
+{
+	int musicIndex = musicIndexList->at(index);
+	return { std::string(library->getTitle(musicIndex)), core::getTimeStr(library->getDuration(musicIndex)) };
+}
+
+int core::PlaylistRows::getMaxLength(size_t columnIndex) const
+{
+	if (columnIndex != 1) {
+		return RowProvider::getMaxLength(columnIndex);
+	}
+	// A longer duration never has a shorter string ("9:59" < "10:00" < "1:00:00").
+	Time maxDuration = 0s;
+	for (int musicIndex : *musicIndexList) {
+		if (library->getDuration(musicIndex) > maxDuration) {
+			maxDuration = library->getDuration(musicIndex);
+		}
+	}
+	return (int)core::getTimeStr(maxDuration).length();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PlaylistRegistry
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlaylistRegistry::Handle core::PlaylistRegistry::add(Playlist playlist)
+{
+	if (slotsByName.count(playlist.name)) {
+		return {};
+	}
+	uint32_t slotIndex;
+	if (freeSlots.empty()) {
+		slotIndex = (uint32_t)slots.size();
+		slots.emplace_back();
+	}
+	else {
+		slotIndex = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	Slot& slot = slots[slotIndex];
+	slot.playlist = std::make_unique<Playlist>(std::move(playlist));
+	slot.position = (uint32_t)playlists.size();
+	playlists.push_back(slot.playlist.get());
+	playlistSlots.push_back(slotIndex);
+	slotsByName.emplace(slot.playlist->name, slotIndex);
+	return { slotIndex, slot.generation };
+}
+
+bool core::PlaylistRegistry::remove(Handle handle)
+{
+	if (!isValid(handle)) {
+		return false;
+	}
+	Slot& slot = slots[handle.slot];
+	// Move the last playlist into the gap:
+	uint32_t lastSlotIndex = playlistSlots.back();
+	playlists[slot.position] = playlists.back();
+	playlistSlots[slot.position] = lastSlotIndex;
+	slots[lastSlotIndex].position = slot.position;
+	playlists.pop_back();
+	playlistSlots.pop_back();
+
+	slotsByName.erase(slot.playlist->name);
+	slot.playlist.reset();
+	++slot.generation;
+	freeSlots.push_back(handle.slot);
+	return true;
+}
+
+void core::PlaylistRegistry::clear()
+{
+	*this = PlaylistRegistry();
+}
+
+core::Playlist* core::PlaylistRegistry::get(Handle handle)
+{
+	return isValid(handle) ? slots[handle.slot].playlist.get() : nullptr;
+}
+
+const core::Playlist* core::PlaylistRegistry::get(Handle handle) const
+{
+	return isValid(handle) ? slots[handle.slot].playlist.get() : nullptr;
+}
+
+core::PlaylistRegistry::Handle core::PlaylistRegistry::find(const std::string& name) const
+{
+	auto it = slotsByName.find(name);
+	if (it == slotsByName.end()) {
+		return {};
+	}
+	return { it->second, slots[it->second].generation };
+}
+
+bool core::PlaylistRegistry::isValid(Handle handle) const
+{
+	return handle.slot < slots.size() && slots[handle.slot].playlist && slots[handle.slot].generation == handle.generation;
+}
+
+size_t core::PlaylistRegistry::size() const
+{
+	return playlists.size();
+}
+
+bool core::PlaylistRegistry::empty() const
+{
+	return playlists.empty();
+}
+
+core::PlaylistRegistry::Iterator core::PlaylistRegistry::begin() const
+{
+	return Iterator(playlists.begin());
+}
+
+core::PlaylistRegistry::Iterator core::PlaylistRegistry::end() const
+{
+	return Iterator(playlists.end());
+}
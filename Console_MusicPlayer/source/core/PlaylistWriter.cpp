@@ -0,0 +1,287 @@
+#include "core/PlaylistWriter.hpp"
+#include "core/PlaylistFile.hpp"
+#include "core/SmallTools.hpp"
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+static const auto  WAIT_TIMEOUT  = std::chrono::milliseconds(250); //< how often the pending edits and 'isRunning' are checked
+static const auto  COMPACT_DELAY = std::chrono::seconds(2);        //< time without edits before the journal is compacted
+static const char* JOURNAL_EXTENSION = ".journal";
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper
+///////////////////////////////////////////////////////////////////////////////
+
+intern fs::path getJournalPath(const fs::path& playlistFilePath)
+{
+	fs::path journalPath = playlistFilePath;
+	journalPath += JOURNAL_EXTENSION;
+	return journalPath;
+}
+
+/** 0 if the file does not exist. */
+intern long long getLastWriteTime(const fs::path& filePath)
+{
+	std::error_code ec;
+	auto lastWriteTime = fs::last_write_time(filePath, ec);
+	return ec ? 0 : (long long)lastWriteTime.time_since_epoch().count();
+}
+
+/** Returns false if the edit is invalid (e.g. a line of an interrupted write). */
+intern bool applyEdit(const core::PlaylistWriter::Edit& edit, std::vector<std::wstring>& musicFilenames)
+{
+	using Type = core::PlaylistWriter::Edit::Type;
+	int size = (int)musicFilenames.size();
+	if (edit.type == Type::Insert && edit.position >= 0 && edit.position <= size) {
+		musicFilenames.insert(musicFilenames.begin() + edit.position, edit.filename);
+		return true;
+	}
+	if (edit.type == Type::Erase && edit.position >= 0 && edit.position < size) {
+		musicFilenames.erase(musicFilenames.begin() + edit.position);
+		return true;
+	}
+	if (edit.type == Type::Move && edit.position >= 0 && edit.position < size && edit.newPosition >= 0 && edit.newPosition < size) {
+		auto from = musicFilenames.begin() + edit.position;
+		auto to   = musicFilenames.begin() + edit.newPosition;
+		if (from < to) std::rotate(from, from + 1, to + 1);
+		else           std::rotate(to, from, from + 1);
+		return true;
+	}
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// PlaylistWriter
+///////////////////////////////////////////////////////////////////////////////
+
+core::PlaylistWriter::~PlaylistWriter()
+{
+	stop();
+}
+
+void core::PlaylistWriter::start()
+{
+	stop();
+	isRunning = true;
+	thread = std::thread(&PlaylistWriter::run, this);
+}
+
+void core::PlaylistWriter::stop()
+{
+	isRunning = false;
+	condition.notify_one();
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void core::PlaylistWriter::append(const fs::path& playlistFilePath, Edit edit)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = std::find_if(pendingPlaylists.begin(), pendingPlaylists.end(), [&](const PendingPlaylist& pending) { return pending.filePath == playlistFilePath; });
+	if (it == pendingPlaylists.end()) {
+		pendingPlaylists.push_back({ playlistFilePath });
+		it = pendingPlaylists.end() - 1;
+	}
+	it->edits.push_back(std::move(edit));
+	condition.notify_one();
+}
+
+void core::PlaylistWriter::compact(const fs::path& playlistFilePath)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = std::find_if(pendingPlaylists.begin(), pendingPlaylists.end(), [&](const PendingPlaylist& pending) { return pending.filePath == playlistFilePath; });
+	if (it == pendingPlaylists.end()) {
+		pendingPlaylists.push_back({ playlistFilePath });
+		it = pendingPlaylists.end() - 1;
+	}
+	it->isCompactRequested = true;
+	condition.notify_one();
+}
+
+void core::PlaylistWriter::pollLog()
+{
+	std::vector<std::string> polledLogMessages;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		polledLogMessages.swap(logMessages);
+	}
+	for (auto& message : polledLogMessages) {
+		log(message);
+	}
+}
+
+void core::PlaylistWriter::pushLog(std::string message)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	logMessages.push_back(std::move(message));
+}
+
+void core::PlaylistWriter::run()
+{
+	struct Journal
+	{
+		fs::path                              filePath; //< of the playlist
+		int                                   editCount;
+		std::chrono::steady_clock::time_point lastEditTime;
+	};
+	std::vector<Journal> journals; // which are not compacted yet
+
+	bool isStopping = false;
+	while (!isStopping) {
+		std::vector<PendingPlaylist> polledPlaylists;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait_for(lock, WAIT_TIMEOUT, [this]() { return !isRunning || !pendingPlaylists.empty(); });
+			polledPlaylists.swap(pendingPlaylists);
+			isStopping = !isRunning;
+		}
+
+		// Append the edits to the journals:
+		auto now = std::chrono::steady_clock::now();
+		for (PendingPlaylist& pending : polledPlaylists) {
+			auto journal = std::find_if(journals.begin(), journals.end(), [&](const Journal& journal) { return journal.filePath == pending.filePath; });
+			if (journal == journals.end()) {
+				journals.push_back({ pending.filePath, 0, now });
+				journal = journals.end() - 1;
+			}
+			if (!pending.edits.empty() && writeJournal(pending.filePath, pending.edits)) {
+				journal->editCount += (int)pending.edits.size();
+				journal->lastEditTime = now;
+			}
+			if (pending.isCompactRequested) {
+				journal->editCount = COMPACT_EDIT_COUNT; // compacted below
+			}
+		}
+
+		// Compact the journals:
+		for (auto journal = journals.begin(); journal != journals.end();) {
+			if (isStopping || journal->editCount >= COMPACT_EDIT_COUNT || now - journal->lastEditTime >= COMPACT_DELAY) {
+				compactJournal(journal->filePath);
+				journal = journals.erase(journal);
+			}
+			else {
+				++journal;
+			}
+		}
+	}
+}
+
+bool core::PlaylistWriter::writeJournal(const fs::path& playlistFilePath, const std::vector<Edit>& edits)
+{
+	fs::path journalPath = getJournalPath(playlistFilePath);
+	bool isNewJournal = !fs::exists(journalPath);
+	std::ofstream ofs(journalPath, std::ios::out | std::ios::app);
+	if (!ofs) {
+		pushLog("Error: Playlist journal (" + journalPath.u8string() + ") can not be written!");
+		return false;
+	}
+	std::ostringstream oss;
+	if (isNewJournal) {
+		oss << "playlist " << getLastWriteTime(playlistFilePath) << "\n";
+	}
+	for (const Edit& edit : edits) {
+		if (edit.type == Edit::Type::Insert) oss << "+ " << edit.position << " " << toStr(edit.filename) << "\n";
+		if (edit.type == Edit::Type::Erase)  oss << "- " << edit.position << "\n";
+		if (edit.type == Edit::Type::Move)   oss << "> " << edit.position << " " << edit.newPosition << "\n";
+	}
+	ofs << oss.str();
+	ofs.flush();
+	return (bool)ofs;
+}
+
+void core::PlaylistWriter::compactJournal(const fs::path& playlistFilePath)
+{
+	std::vector<std::wstring> musicFilenames = readPlaylistFile(playlistFilePath);
+	applyJournal(playlistFilePath, musicFilenames);
+
+	fs::path tempFilePath = playlistFilePath;
+	tempFilePath += ".tmp";
+	{
+		std::ofstream ofs(tempFilePath, std::ios::out | std::ios::trunc);
+		for (const std::wstring& musicFilename : musicFilenames) {
+			ofs << toStr(musicFilename) << "\n";
+		}
+		ofs.flush();
+		if (!ofs) {
+			pushLog("Error: Playlist (" + playlistFilePath.u8string() + ") can not be written!");
+			return;
+		}
+	}
+	// The rename replaces the playlist file at once. Its new write time makes the journal invalid, even if it can not be removed.
+	std::error_code ec;
+	fs::rename(tempFilePath, playlistFilePath, ec);
+	if (ec) {
+		pushLog("Error: Playlist (" + playlistFilePath.u8string() + ") can not be replaced: " + ec.message());
+		return;
+	}
+	fs::remove(getJournalPath(playlistFilePath), ec);
+}
+
+bool core::PlaylistWriter::applyJournal(const fs::path& playlistFilePath, std::vector<std::wstring>& musicFilenames)
+{
+	fs::path journalPath = getJournalPath(playlistFilePath);
+	std::ifstream ifs(journalPath, std::ios::in);
+	if (!ifs) {
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << ifs.rdbuf();
+	ifs.close();
+	std::string content = buffer.str();
+	// A line without line break at the end was interrupted while writing:
+	content.erase(content.find_last_of('\n') == std::string::npos ? 0 : content.find_last_of('\n') + 1);
+
+	std::istringstream lines(content);
+	std::string line;
+	std::string keyword;
+	long long lastWriteTime = 0;
+	std::getline(lines, line);
+	std::istringstream header(line);
+	if (!(header >> keyword >> lastWriteTime) || keyword != "playlist" || lastWriteTime != getLastWriteTime(playlistFilePath)) {
+		// ..the journal belongs to another version of the playlist file
+		std::error_code ec;
+		fs::remove(journalPath, ec);
+		return false;
+	}
+	while (std::getline(lines, line)) {
+		Edit edit = {};
+		std::istringstream iss(line);
+		char type = 0;
+		iss >> type >> edit.position;
+		if (type == '+') {
+			edit.type = Edit::Type::Insert;
+			std::string filename;
+			iss.get(); // space
+			std::getline(iss, filename);
+			edit.filename = decodePlaylistLine(filename);
+		}
+		else if (type == '-') {
+			edit.type = Edit::Type::Erase;
+		}
+		else if (type == '>') {
+			edit.type = Edit::Type::Move;
+			iss >> edit.newPosition;
+		}
+		if (!iss || !applyEdit(edit, musicFilenames)) {
+			break;
+		}
+	}
+	return true;
+}
+
+std::vector<std::wstring> core::PlaylistWriter::readPlaylistFile(const fs::path& playlistFilePath)
+{
+	std::vector<std::wstring> musicFilenames;
+	std::ifstream ifs(playlistFilePath, std::ios::in);
+	std::string line;
+	while (std::getline(ifs, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		musicFilenames.push_back(decodePlaylistLine(line)); // Playlist should only hold filenames, so that music files can be moved without editing the playlist file.
+	}
+	return musicFilenames;
+}
@@ -0,0 +1,80 @@
+#include "core/PlaytimeIndex.hpp"
+#include <cassert>
+
+void core::PlaytimeIndex::assign(const std::vector<Time>& durations)
+{
+	this->durations.clear();
+	this->durations.reserve(durations.size());
+	for (const Time& duration : durations) {
+		this->durations.push_back(duration.asNanoSeconds());
+	}
+	build();
+}
+
+void core::PlaytimeIndex::clear()
+{
+	durations.clear();
+	tree.clear();
+}
+
+void core::PlaytimeIndex::set(size_t position, Time duration)
+{
+	assert(position < durations.size());
+	long long delta = duration.asNanoSeconds() - durations[position];
+	durations[position] = duration.asNanoSeconds();
+	for (size_t i = position + 1; i < tree.size(); i += i & (~i + 1)) {
+		tree[i] += delta;
+	}
+}
+
+void core::PlaytimeIndex::insert(size_t position, Time duration)
+{
+	assert(position <= durations.size());
+	durations.insert(durations.begin() + position, duration.asNanoSeconds());
+	build();
+}
+
+void core::PlaytimeIndex::erase(size_t position)
+{
+	assert(position < durations.size());
+	durations.erase(durations.begin() + position);
+	build();
+}
+
+core::Time core::PlaytimeIndex::getPlaytimeBefore(size_t position) const
+{
+	assert(position <= durations.size());
+	long long sum = 0;
+	for (size_t i = position; i > 0; i -= i & (~i + 1)) {
+		sum += tree[i];
+	}
+	return Nanoseconds(sum);
+}
+
+core::Time core::PlaytimeIndex::getDuration(size_t position) const
+{
+	return Nanoseconds(durations.at(position));
+}
+
+core::Time core::PlaytimeIndex::getTotal() const
+{
+	return getPlaytimeBefore(durations.size());
+}
+
+size_t core::PlaytimeIndex::size() const
+{
+	return durations.size();
+}
+
+void core::PlaytimeIndex::build()
+{
+	// O(n): each node adds its sum to its parent.
+	tree.assign(durations.size() + 1, 0);
+	for (size_t i = 1; i < tree.size(); ++i) {
+		tree[i] += durations[i - 1];
+		size_t parent = i + (i & (~i + 1));
+		if (parent < tree.size()) {
+			tree[parent] += tree[i];
+		}
+	}
+}
@@ -8,6 +8,7 @@
 #include <fstream>
 #include <algorithm>
 #include <cctype>
+#include <cwctype>
 #include <codecvt>
 #include <locale>
 
@@ -65,14 +66,14 @@ void core::log(std::string message)
 std::wstring core::toWStr(std::string str)
 {
 	//static std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> cv;
-	static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> cv;
+	thread_local std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> cv; // the playlists are resolved on several threads
 	return cv.from_bytes(str);
 }
 
 std::string core::toStr(std::wstring wstr)
 {
 	//static std::wstring_convert<std::codecvt_utf8<wchar_t>, wchar_t> cv;
-	static std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> cv;
+	thread_local std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> cv; // the playlists are resolved on several threads
 	return cv.to_bytes(wstr);
 }
 
@@ -169,6 +170,25 @@ bool core::isSupportedAudioFile(fs::path filepath)
 	return hasExtention(filepath, sdlSupportedExtentions);
 }
 
+bool core::isSupportedAudioFilename(std::wstring_view filename)
+{
+	static const std::vector<std::wstring> sdlSupportedExtentions{
+		L".flac", L".mp3", L".ogg", L".voc", L".wav", L".midi", L".mod", L".opus"
+	};
+	size_t dotPos = filename.find_last_of(L'.');
+	if (dotPos == std::wstring_view::npos || dotPos == 0) {
+		return false; // ..no extension or hidden file without extension (".mp3"), like fs::path::extension()
+	}
+	std::wstring_view extension = filename.substr(dotPos);
+	for (auto& sdlSupportedExtention : sdlSupportedExtentions) {
+		if (extension.size() == sdlSupportedExtention.size() && std::equal(extension.begin(), extension.end(), sdlSupportedExtention.begin(),
+			[](wchar_t a, wchar_t b) { return std::towlower(a) == b; })) { // e.g. .WAV is also valid
+			return true;
+		}
+	}
+	return false;
+}
+
 bool core::isAudioFile(fs::path filepath)
 {
 	static const std::vector<std::string> audioExtentions {
@@ -240,6 +260,12 @@ bool core::hasFlag(int flag, int flagList)
 	return flag == (flag & flagList);
 }
 
+std::mutex& core::getMixerLoadMutex()
+{
+	static std::mutex mixerLoadMutex;
+	return mixerLoadMutex;
+}
+
 intern std::wstring getComment(const std::wstring& commentVarName, const std::map<std::wstring, std::wstring>& config)
 {
 	// __comment<name><num>
@@ -0,0 +1,738 @@
+#include "core/TagReader.hpp"
+#include "core/SmallTools.hpp"
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+static const size_t HEAD_SIZE      = 64 * 1024;  //< bytes which are read at once from the start of the file
+static const size_t MAX_TAG_SIZE   = 256 * 1024; //< larger tags are truncated (they only contain pictures then)
+static const size_t OGG_TAIL_SIZE  = 64 * 1024;  //< bytes searched for the last ogg page
+
+namespace
+{
+	/**
+	 * Random access to a file. The head of the file is read once and kept in memory, because most requests are
+	 * within it. Requests beyond the head read the file directly.
+	 */
+	class File
+	{
+	public:
+		explicit File(const fs::path& filePath)
+			: ifs(filePath, std::ios::in | std::ios::binary)
+			, size(0)
+		{
+			if (!ifs) {
+				return;
+			}
+			ifs.seekg(0, std::ios::end);
+			size = (uint64_t)ifs.tellg();
+			head = readDirect(0, HEAD_SIZE);
+		}
+
+		bool isOpen() const
+		{
+			return size > 0;
+		}
+
+		uint64_t getSize() const
+		{
+			return size;
+		}
+
+		/** Returns less than 'count' bytes at the end of the file. */
+		std::vector<uint8_t> read(uint64_t offset, size_t count)
+		{
+			if (offset + count <= head.size()) {
+				return std::vector<uint8_t>(head.begin() + (size_t)offset, head.begin() + (size_t)(offset + count));
+			}
+			return readDirect(offset, count);
+		}
+	private:
+		std::ifstream        ifs;
+		uint64_t             size;
+		std::vector<uint8_t> head;
+
+		std::vector<uint8_t> readDirect(uint64_t offset, size_t count)
+		{
+			if (offset >= size) {
+				return {};
+			}
+			count = (size_t)std::min<uint64_t>(count, size - offset);
+			std::vector<uint8_t> data(count);
+			ifs.clear();
+			ifs.seekg(offset);
+			ifs.read(reinterpret_cast<char*>(data.data()), count);
+			data.resize((size_t)ifs.gcount());
+			return data;
+		}
+	};
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Helper
+///////////////////////////////////////////////////////////////////////////////
+
+intern uint32_t readBE32(const uint8_t* p) { return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]; }
+intern uint32_t readBE24(const uint8_t* p) { return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]; }
+intern uint32_t readLE32(const uint8_t* p) { return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0]; }
+intern uint16_t readLE16(const uint8_t* p) { return (uint16_t)(p[1] << 8 | p[0]); }
+intern uint64_t readLE64(const uint8_t* p) { return (uint64_t)readLE32(p + 4) << 32 | readLE32(p); }
+/** ID3v2 sizes use only 7 bits per byte. */
+intern uint32_t readSyncSafe32(const uint8_t* p) { return (uint32_t)(p[0] & 0x7F) << 21 | (uint32_t)(p[1] & 0x7F) << 14 | (uint32_t)(p[2] & 0x7F) << 7 | (p[3] & 0x7F); }
+
+intern bool startsWith(const std::vector<uint8_t>& data, size_t offset, const char* str)
+{
+	size_t length = std::strlen(str);
+	return offset + length <= data.size() && std::memcmp(data.data() + offset, str, length) == 0;
+}
+
+intern core::Time samplesToTime(uint64_t sampleCount, uint32_t sampleRate)
+{
+	return core::Time(core::Nanoseconds((long long)((double)sampleCount * 1'000'000'000.0 / sampleRate)));
+}
+
+intern void appendUtf8(std::string& str, uint32_t codePoint)
+{
+	if (codePoint < 0x80) {
+		str += (char)codePoint;
+	}
+	else if (codePoint < 0x800) {
+		str += (char)(0xC0 | codePoint >> 6);
+		str += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else if (codePoint < 0x10000) {
+		str += (char)(0xE0 | codePoint >> 12);
+		str += (char)(0x80 | (codePoint >> 6 & 0x3F));
+		str += (char)(0x80 | (codePoint & 0x3F));
+	}
+	else {
+		str += (char)(0xF0 | codePoint >> 18);
+		str += (char)(0x80 | (codePoint >> 12 & 0x3F));
+		str += (char)(0x80 | (codePoint >> 6 & 0x3F));
+		str += (char)(0x80 | (codePoint & 0x3F));
+	}
+}
+
+intern std::string latin1ToUtf8(const uint8_t* p, size_t size)
+{
+	std::string str;
+	for (size_t i = 0; i < size && p[i] != 0; ++i) {
+		appendUtf8(str, p[i]);
+	}
+	return str;
+}
+
+intern std::string utf16ToUtf8(const uint8_t* p, size_t size, bool isBigEndian)
+{
+	std::string str;
+	for (size_t i = 0; i + 1 < size; i += 2) {
+		uint32_t unit = isBigEndian ? (p[i] << 8 | p[i + 1]) : (p[i + 1] << 8 | p[i]);
+		if (unit == 0) {
+			break;
+		}
+		if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size) { // surrogate pair
+			uint32_t low = isBigEndian ? (p[i + 2] << 8 | p[i + 3]) : (p[i + 3] << 8 | p[i + 2]);
+			unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+			i += 2;
+		}
+		appendUtf8(str, unit);
+	}
+	return str;
+}
+
+intern bool isValidUtf8(const uint8_t* p, size_t size)
+{
+	for (size_t i = 0; i < size;) {
+		int followCount = p[i] < 0x80 ? 0 : (p[i] & 0xE0) == 0xC0 ? 1 : (p[i] & 0xF0) == 0xE0 ? 2 : (p[i] & 0xF8) == 0xF0 ? 3 : -1;
+		if (followCount < 0 || i + followCount >= size) {
+			return false;
+		}
+		for (int j = 1; j <= followCount; ++j) {
+			if ((p[i + j] & 0xC0) != 0x80) {
+				return false;
+			}
+		}
+		i += followCount + 1;
+	}
+	return true;
+}
+
+/** For strings without a defined encoding (ID3v1, RIFF INFO): utf-8 if possible, otherwise latin-1. */
+intern std::string unknownToUtf8(const uint8_t* p, size_t size)
+{
+	size = std::find(p, p + size, 0) - p;
+	while (size > 0 && p[size - 1] == ' ') { // ID3v1 fields are padded with spaces
+		--size;
+	}
+	return isValidUtf8(p, size) ? std::string(reinterpret_cast<const char*>(p), size) : latin1ToUtf8(p, size);
+}
+
+/** Reverses the ID3v2 unsynchronisation (0xFF 0x00 -> 0xFF). */
+intern void removeUnsynchronisation(std::vector<uint8_t>& data)
+{
+	size_t dst = 0;
+	for (size_t src = 0; src < data.size(); ++src) {
+		data[dst++] = data[src];
+		if (data[src] == 0xFF && src + 1 < data.size() && data[src + 1] == 0x00) {
+			++src;
+		}
+	}
+	data.resize(dst);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Tags
+///////////////////////////////////////////////////////////////////////////////
+
+/** Sets title, artist and album from the fields of a Vorbis comment (used by OGG, Opus and FLAC). */
+intern void parseVorbisComment(const uint8_t* p, size_t size, core::MusicInfo& musicInfo)
+{
+	if (size < 8) {
+		return;
+	}
+	// The lengths are compared before they are added, so that a corrupt length can not overflow 'pos' (32 bit size_t):
+	uint32_t vendorLength = readLE32(p);
+	if (vendorLength > size - 8) {
+		return;
+	}
+	size_t pos = 4 + (size_t)vendorLength; // skip vendor string
+	uint32_t fieldCount = readLE32(p + pos);
+	pos += 4;
+	for (uint32_t i = 0; i < fieldCount && pos <= size - 4; ++i) {
+		size_t length = readLE32(p + pos);
+		pos += 4;
+		if (length > size - pos) {
+			return; // truncated
+		}
+		std::string field(reinterpret_cast<const char*>(p + pos), length);
+		pos += length;
+
+		size_t separator = field.find('=');
+		if (separator == std::string::npos) {
+			continue;
+		}
+		std::string key = field.substr(0, separator);
+		for (auto& c : key) {
+			c = (char)toupper((unsigned char)c);
+		}
+		std::string* target = key == "TITLE" ? &musicInfo.title : key == "ARTIST" ? &musicInfo.artist : key == "ALBUM" ? &musicInfo.album : nullptr;
+		if (target && target->empty()) { // the first value wins, if a field occurs multiple times
+			*target = field.substr(separator + 1);
+		}
+	}
+}
+
+/** Returns the size of the ID3v2 tag at 'offset' (incl. header and footer) or 0 if there is none. */
+intern uint64_t getID3v2Size(File& file, uint64_t offset)
+{
+	std::vector<uint8_t> header = file.read(offset, 10);
+	if (!startsWith(header, 0, "ID3") || header.size() < 10) {
+		return 0;
+	}
+	bool hasFooter = header[5] & 0x10;
+	return 10 + (uint64_t)readSyncSafe32(&header[6]) + (hasFooter ? 10 : 0);
+}
+
+intern std::string decodeID3v2Text(const uint8_t* p, size_t size)
+{
+	if (size == 0) {
+		return "";
+	}
+	uint8_t encoding = p[0];
+	++p;
+	--size;
+	switch (encoding) {
+	case 0: return latin1ToUtf8(p, size);
+	case 1: // utf-16 with BOM
+		if (size >= 2 && p[0] == 0xFE && p[1] == 0xFF) return utf16ToUtf8(p + 2, size - 2, true);
+		if (size >= 2 && p[0] == 0xFF && p[1] == 0xFE) return utf16ToUtf8(p + 2, size - 2, false);
+		return utf16ToUtf8(p, size, false);
+	case 2: return utf16ToUtf8(p, size, true);
+	case 3: return std::string(reinterpret_cast<const char*>(p), std::find(p, p + size, 0) - p);
+	default: return "";
+	}
+}
+
+/** Reads the text frames TIT2, TPE1 and TALB (ID3v2.2: TT2, TP1, TAL) of the ID3v2 tag at the start of the file. */
+intern void parseID3v2(File& file, core::MusicInfo& musicInfo)
+{
+	uint64_t tagSize = getID3v2Size(file, 0);
+	if (tagSize == 0) {
+		return;
+	}
+	std::vector<uint8_t> header = file.read(0, 10);
+	uint8_t version = header[3];
+	uint8_t flags   = header[5];
+	if (version < 2 || version > 4) {
+		return;
+	}
+	std::vector<uint8_t> tag = file.read(10, (size_t)std::min<uint64_t>(tagSize - 10, MAX_TAG_SIZE));
+	if (version < 4 && (flags & 0x80)) { // ID3v2.4 stores the unsynchronisation per frame
+		removeUnsynchronisation(tag);
+	}
+
+	size_t pos = 0;
+	if (version >= 3 && (flags & 0x40) && tag.size() >= 4) { // extended header
+		// The size is compared before 4 is added, so that a corrupt size can not overflow 'pos' (32 bit size_t):
+		uint32_t extendedHeaderSize = version == 3 ? readBE32(tag.data()) : readSyncSafe32(tag.data());
+		if (extendedHeaderSize >= tag.size() - (version == 3 ? 4 : 0)) {
+			return;
+		}
+		pos = (version == 3 ? 4 : 0) + (size_t)extendedHeaderSize;
+	}
+
+	const size_t frameHeaderSize = version == 2 ? 6 : 10;
+	const size_t idLength        = version == 2 ? 3 : 4;
+	while (pos + frameHeaderSize <= tag.size() && tag[pos] != 0) { // the tag may be followed by padding
+		const uint8_t* frame = &tag[pos];
+		size_t frameSize = version == 2 ? readBE24(frame + 3) : version == 3 ? readBE32(frame + 4) : readSyncSafe32(frame + 4);
+		pos += frameHeaderSize;
+		if (frameSize > tag.size() - pos) {
+			break; // truncated
+		}
+		std::string id(reinterpret_cast<const char*>(frame), idLength);
+		std::string* target = (id == "TIT2" || id == "TT2") ? &musicInfo.title : (id == "TPE1" || id == "TP1") ? &musicInfo.artist : (id == "TALB" || id == "TAL") ? &musicInfo.album : nullptr;
+		if (target && target->empty()) {
+			std::vector<uint8_t> data(tag.begin() + pos, tag.begin() + pos + frameSize);
+			bool isSupported = true;
+			if (version == 3) {
+				isSupported = (frame[9] & 0xC0) == 0; // compressed or encrypted
+			}
+			else if (version == 4) {
+				isSupported = (frame[9] & 0x0C) == 0;
+				if (frame[9] & 0x02) {
+					removeUnsynchronisation(data);
+				}
+				if ((frame[9] & 0x01) && data.size() >= 4) { // data length indicator
+					data.erase(data.begin(), data.begin() + 4);
+				}
+			}
+			if (isSupported) {
+				*target = decodeID3v2Text(data.data(), data.size());
+			}
+		}
+		pos += frameSize;
+	}
+}
+
+/** ID3v1 is only used for the fields which the ID3v2 tag did not set. */
+intern void parseID3v1(File& file, core::MusicInfo& musicInfo)
+{
+	if (file.getSize() < 128) {
+		return;
+	}
+	std::vector<uint8_t> tag = file.read(file.getSize() - 128, 128);
+	if (!startsWith(tag, 0, "TAG") || tag.size() < 128) {
+		return;
+	}
+	if (musicInfo.title.empty())  musicInfo.title  = unknownToUtf8(&tag[3], 30);
+	if (musicInfo.artist.empty()) musicInfo.artist = unknownToUtf8(&tag[33], 30);
+	if (musicInfo.album.empty())  musicInfo.album  = unknownToUtf8(&tag[63], 30);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MP3
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	struct MpegFrameHeader
+	{
+		int      version;        //< 1: MPEG-1, 2: MPEG-2, 3: MPEG-2.5
+		int      layer;          //< 1-3
+		uint32_t bitrate;        //< bit/s, 0 if free format
+		uint32_t sampleRate;
+		uint32_t samplesPerFrame;
+		bool     isMono;
+		size_t   frameSize;      //< bytes incl. header, 0 if free format
+	};
+}
+
+intern bool parseMpegFrameHeader(const uint8_t* p, MpegFrameHeader& header)
+{
+	static const uint16_t BITRATES[2][3][15] = { // [MPEG-1, MPEG-2/2.5][layer - 1][index] in kbit/s
+		{ { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+		  { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384 },
+		  { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320 } },
+		{ { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256 },
+		  { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160 },
+		  { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160 } } };
+	static const uint32_t SAMPLE_RATES[3][3] = { { 44100, 48000, 32000 }, { 22050, 24000, 16000 }, { 11025, 12000, 8000 } };
+
+	if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+		return false;
+	}
+	int versionBits    = p[1] >> 3 & 0x03;
+	int layerBits      = p[1] >> 1 & 0x03;
+	int bitrateIndex   = p[2] >> 4;
+	int sampleRateBits = p[2] >> 2 & 0x03;
+	if (versionBits == 1 || layerBits == 0 || bitrateIndex == 15 || sampleRateBits == 3) {
+		return false; // reserved values
+	}
+	header.version         = versionBits == 3 ? 1 : versionBits == 2 ? 2 : 3;
+	header.layer           = 4 - layerBits;
+	header.bitrate         = BITRATES[header.version == 1 ? 0 : 1][header.layer - 1][bitrateIndex] * 1000;
+	header.sampleRate      = SAMPLE_RATES[header.version - 1][sampleRateBits];
+	header.samplesPerFrame = header.layer == 1 ? 384 : (header.layer == 3 && header.version != 1) ? 576 : 1152;
+	header.isMono          = (p[3] >> 6) == 3;
+	bool hasPadding        = p[2] & 0x02;
+	header.frameSize       = header.bitrate == 0 ? 0 : header.samplesPerFrame / 8 * header.bitrate / header.sampleRate + (hasPadding ? (header.layer == 1 ? 4 : 1) : 0);
+	return true;
+}
+
+intern bool readMp3(File& file, core::MusicInfo& musicInfo)
+{
+	parseID3v2(file, musicInfo);
+	parseID3v1(file, musicInfo);
+
+	// Find the first frame. A valid frame must be followed by another frame with the same format, otherwise it is
+	// probably just some bytes which look like a frame header.
+	uint64_t audioOffset = getID3v2Size(file, 0);
+	std::vector<uint8_t> data = file.read(audioOffset, HEAD_SIZE);
+	MpegFrameHeader header;
+	size_t framePos = 0;
+	while (true) {
+		if (framePos + 4 > data.size()) {
+			return false;
+		}
+		if (parseMpegFrameHeader(&data[framePos], header) && header.frameSize > 0) {
+			MpegFrameHeader nextHeader;
+			size_t nextPos = framePos + header.frameSize;
+			if (nextPos + 4 > data.size()
+				|| (parseMpegFrameHeader(&data[nextPos], nextHeader) && nextHeader.version == header.version && nextHeader.layer == header.layer && nextHeader.sampleRate == header.sampleRate)) {
+				break;
+			}
+		}
+		++framePos;
+	}
+
+	// VBR files contain the frame count in the first frame (Xing / Info header of LAME, VBRI header of Fraunhofer).
+	size_t sideInfoSize = header.version == 1 ? (header.isMono ? 17 : 32) : (header.isMono ? 9 : 17);
+	size_t xingPos = framePos + 4 + sideInfoSize;
+	size_t vbriPos = framePos + 4 + 32;
+	if ((startsWith(data, xingPos, "Xing") || startsWith(data, xingPos, "Info")) && xingPos + 8 <= data.size()) {
+		uint32_t xingFlags = readBE32(&data[xingPos + 4]);
+		if ((xingFlags & 0x01) && xingPos + 12 <= data.size()) {
+			uint64_t sampleCount = (uint64_t)readBE32(&data[xingPos + 8]) * header.samplesPerFrame;
+			// The LAME extension follows the optional fields and stores encoder delay and padding, which are not part of the music.
+			size_t lamePos = xingPos + 12 + ((xingFlags & 0x02) ? 4 : 0) + ((xingFlags & 0x04) ? 100 : 0) + ((xingFlags & 0x08) ? 4 : 0);
+			if ((startsWith(data, lamePos, "LAME") || startsWith(data, lamePos, "Lavc") || startsWith(data, lamePos, "Lavf")) && lamePos + 24 <= data.size()) {
+				uint32_t delayAndPadding = readBE24(&data[lamePos + 21]);
+				uint64_t skippedCount = (delayAndPadding >> 12) + (delayAndPadding & 0xFFF);
+				sampleCount = sampleCount > skippedCount ? sampleCount - skippedCount : 0;
+			}
+			musicInfo.duration = samplesToTime(sampleCount, header.sampleRate);
+			return true;
+		}
+	}
+	else if (startsWith(data, vbriPos, "VBRI") && vbriPos + 18 <= data.size()) {
+		uint64_t frameCount = readBE32(&data[vbriPos + 14]);
+		musicInfo.duration = samplesToTime(frameCount * header.samplesPerFrame, header.sampleRate);
+		return true;
+	}
+
+	// CBR: all frames have the same bitrate
+	uint64_t audioSize = file.getSize() - (audioOffset + framePos);
+	if (file.getSize() >= 128 && startsWith(file.read(file.getSize() - 128, 3), 0, "TAG")) {
+		audioSize -= std::min<uint64_t>(audioSize, 128);
+	}
+	musicInfo.duration = core::Time(core::Nanoseconds((long long)((double)audioSize * 8 * 1'000'000'000.0 / header.bitrate)));
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// FLAC
+///////////////////////////////////////////////////////////////////////////////
+
+intern bool readFlac(File& file, core::MusicInfo& musicInfo)
+{
+	uint64_t pos = getID3v2Size(file, 0); // not allowed, but some taggers write it anyway
+	if (!startsWith(file.read(pos, 4), 0, "fLaC")) {
+		return false;
+	}
+	pos += 4;
+
+	bool hasStreamInfo = false;
+	bool isLastBlock = false;
+	while (!isLastBlock) {
+		std::vector<uint8_t> blockHeader = file.read(pos, 4);
+		if (blockHeader.size() < 4) {
+			return false;
+		}
+		isLastBlock       = blockHeader[0] & 0x80;
+		int blockType     = blockHeader[0] & 0x7F;
+		uint32_t blockSize = readBE24(&blockHeader[1]);
+		pos += 4;
+
+		if (blockType == 0 && blockSize >= 18) { // STREAMINFO
+			std::vector<uint8_t> block = file.read(pos, 18);
+			if (block.size() < 18) {
+				return false;
+			}
+			uint32_t sampleRate  = (uint32_t)block[10] << 12 | (uint32_t)block[11] << 4 | block[12] >> 4;
+			uint64_t sampleCount = (uint64_t)(block[13] & 0x0F) << 32 | readBE32(&block[14]);
+			if (sampleRate == 0) {
+				return false;
+			}
+			musicInfo.duration = samplesToTime(sampleCount, sampleRate);
+			hasStreamInfo = true;
+		}
+		else if (blockType == 4) { // VORBIS_COMMENT
+			std::vector<uint8_t> block = file.read(pos, std::min<size_t>(blockSize, MAX_TAG_SIZE));
+			parseVorbisComment(block.data(), block.size(), musicInfo);
+		}
+		pos += blockSize; // e.g. pictures are skipped without reading them
+	}
+	return hasStreamInfo;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OGG
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+	/** Assembles the packets of the first logical stream from the ogg pages. */
+	class OggPacketReader
+	{
+	public:
+		explicit OggPacketReader(File& file)
+			: file(file)
+			, pageOffset(0)
+			, dataOffset(0)
+			, segmentIndex(0)
+			, serial(0)
+			, hasSerial(false)
+		{}
+
+		/** Packets larger than maxSize are truncated. */
+		bool readPacket(std::vector<uint8_t>& packet, size_t maxSize)
+		{
+			packet.clear();
+			while (true) {
+				if (segmentIndex >= segmentTable.size() && !readPage()) {
+					return false;
+				}
+				uint8_t segmentSize = segmentTable[segmentIndex++];
+				if (packet.size() < maxSize) {
+					std::vector<uint8_t> segment = file.read(dataOffset, segmentSize);
+					packet.insert(packet.end(), segment.begin(), segment.end());
+				}
+				dataOffset += segmentSize;
+				if (segmentSize < 255) {
+					return true;
+				}
+			}
+		}
+
+		uint32_t getSerial() const
+		{
+			return serial;
+		}
+	private:
+		File&                file;
+		uint64_t             pageOffset;   //< next page
+		uint64_t             dataOffset;   //< next segment
+		std::vector<uint8_t> segmentTable; //< of the current page
+		size_t               segmentIndex;
+		uint32_t             serial;
+		bool                 hasSerial;
+
+		bool readPage()
+		{
+			while (true) {
+				std::vector<uint8_t> header = file.read(pageOffset, 27);
+				if (header.size() < 27 || !startsWith(header, 0, "OggS")) {
+					return false;
+				}
+				uint32_t pageSerial = readLE32(&header[14]);
+				segmentTable = file.read(pageOffset + 27, header[26]);
+				if (segmentTable.size() < header[26]) {
+					return false;
+				}
+				size_t pageDataSize = 0;
+				for (uint8_t segmentSize : segmentTable) {
+					pageDataSize += segmentSize;
+				}
+				dataOffset = pageOffset + 27 + segmentTable.size();
+				pageOffset = dataOffset + pageDataSize;
+				segmentIndex = 0;
+				if (!hasSerial) {
+					serial = pageSerial;
+					hasSerial = true;
+				}
+				if (pageSerial == serial) {
+					return true;
+				}
+			}
+		}
+	};
+}
+
+/** Returns the granule position of the last page of the stream or -1. */
+intern int64_t findLastGranulePosition(File& file, uint32_t serial)
+{
+	uint64_t tailSize = std::min<uint64_t>(file.getSize(), OGG_TAIL_SIZE);
+	std::vector<uint8_t> tail = file.read(file.getSize() - tailSize, (size_t)tailSize);
+	for (size_t pos = tail.size() < 27 ? 0 : tail.size() - 27 + 1; pos-- > 0;) {
+		if (startsWith(tail, pos, "OggS") && readLE32(&tail[pos + 14]) == serial) {
+			int64_t granulePosition = (int64_t)readLE64(&tail[pos + 6]);
+			if (granulePosition >= 0) { // -1: no packet ends on this page
+				return granulePosition;
+			}
+		}
+	}
+	return -1;
+}
+
+intern bool readOgg(File& file, core::MusicInfo& musicInfo)
+{
+	OggPacketReader reader(file);
+	std::vector<uint8_t> identification;
+	std::vector<uint8_t> comment;
+	if (!reader.readPacket(identification, 64) || !reader.readPacket(comment, MAX_TAG_SIZE)) {
+		return false;
+	}
+
+	uint32_t sampleRate;
+	uint64_t preSkip = 0;
+	if (startsWith(identification, 0, "\x01vorbis") && identification.size() >= 16) {
+		sampleRate = readLE32(&identification[12]);
+		if (startsWith(comment, 0, "\x03vorbis")) {
+			parseVorbisComment(comment.data() + 7, comment.size() - 7, musicInfo);
+		}
+	}
+	else if (startsWith(identification, 0, "OpusHead") && identification.size() >= 12) {
+		sampleRate = 48000; // the granule position of opus is always in 48 kHz
+		preSkip = readLE16(&identification[10]);
+		if (startsWith(comment, 0, "OpusTags")) {
+			parseVorbisComment(comment.data() + 8, comment.size() - 8, musicInfo);
+		}
+	}
+	else {
+		return false; // e.g. FLAC in ogg
+	}
+
+	int64_t granulePosition = findLastGranulePosition(file, reader.getSerial());
+	if (granulePosition < 0 || sampleRate == 0) {
+		return false;
+	}
+	musicInfo.duration = samplesToTime((uint64_t)granulePosition > preSkip ? granulePosition - preSkip : 0, sampleRate);
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// WAV
+///////////////////////////////////////////////////////////////////////////////
+
+intern bool readWav(File& file, core::MusicInfo& musicInfo)
+{
+	std::vector<uint8_t> header = file.read(0, 12);
+	if (!startsWith(header, 0, "RIFF") || !startsWith(header, 8, "WAVE")) {
+		return false;
+	}
+
+	uint16_t audioFormat = 0;
+	uint32_t sampleRate  = 0;
+	uint32_t byteRate    = 0;
+	uint64_t dataSize    = 0;
+	uint32_t factSampleCount = 0;
+	bool hasFormat = false;
+	bool hasData   = false;
+	uint64_t pos = 12;
+	while (pos + 8 <= file.getSize()) {
+		std::vector<uint8_t> chunkHeader = file.read(pos, 8);
+		uint32_t chunkSize = readLE32(&chunkHeader[4]);
+		pos += 8;
+
+		if (startsWith(chunkHeader, 0, "fmt ") && chunkSize >= 16) {
+			std::vector<uint8_t> chunk = file.read(pos, 16);
+			if (chunk.size() < 16) {
+				return false;
+			}
+			audioFormat = readLE16(&chunk[0]);
+			sampleRate  = readLE32(&chunk[4]);
+			byteRate    = readLE32(&chunk[8]);
+			hasFormat   = true;
+		}
+		else if (startsWith(chunkHeader, 0, "fact") && chunkSize >= 4) {
+			std::vector<uint8_t> chunk = file.read(pos, 4);
+			factSampleCount = chunk.size() == 4 ? readLE32(chunk.data()) : 0;
+		}
+		else if (startsWith(chunkHeader, 0, "data")) {
+			dataSize = std::min<uint64_t>(chunkSize, file.getSize() - pos); // streamed files may have a wrong size
+			hasData = true;
+		}
+		else if (startsWith(chunkHeader, 0, "LIST")) {
+			std::vector<uint8_t> chunk = file.read(pos, std::min<size_t>(chunkSize, MAX_TAG_SIZE));
+			if (startsWith(chunk, 0, "INFO")) {
+				for (size_t subPos = 4; subPos + 8 <= chunk.size();) {
+					size_t subSize = readLE32(&chunk[subPos + 4]);
+					bool isTruncated = subSize > chunk.size() - (subPos + 8); // ..checked before it is added to 'subPos', which would overflow (32 bit size_t)
+					size_t available = isTruncated ? chunk.size() - (subPos + 8) : subSize;
+					std::string id(reinterpret_cast<const char*>(&chunk[subPos]), 4);
+					std::string* target = id == "INAM" ? &musicInfo.title : id == "IART" ? &musicInfo.artist : id == "IPRD" ? &musicInfo.album : nullptr;
+					if (target) {
+						*target = unknownToUtf8(&chunk[subPos + 8], available);
+					}
+					if (isTruncated) {
+						break;
+					}
+					subPos += 8 + subSize + (subSize & 1);
+				}
+			}
+		}
+		pos += chunkSize + (chunkSize & 1); // chunks are word aligned
+	}
+	if (!hasFormat || !hasData || sampleRate == 0 || byteRate == 0) {
+		return false;
+	}
+
+	bool isPcm = audioFormat == 1 || audioFormat == 3 || audioFormat == 0xFFFE; // PCM, IEEE float, extensible
+	if (!isPcm && factSampleCount > 0) { // compressed formats (e.g. ADPCM) store the sample count
+		musicInfo.duration = samplesToTime(factSampleCount, sampleRate);
+	}
+	else {
+		musicInfo.duration = core::Time(core::Nanoseconds((long long)((double)dataSize * 1'000'000'000.0 / byteRate)));
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Read
+///////////////////////////////////////////////////////////////////////////////
+
+bool core::tagReader::read(const fs::path& musicFilePath, MusicInfo& musicInfo)
+{
+	File file(musicFilePath);
+	if (!file.isOpen()) {
+		return false;
+	}
+
+	std::string extension = musicFilePath.extension().u8string();
+	for (auto& c : extension) {
+		c = (char)tolower((unsigned char)c);
+	}
+
+	MusicInfo result;
+	result.path = musicFilePath;
+	bool isRead = false;
+	if (extension == ".mp3") {
+		isRead = readMp3(file, result);
+	}
+	else if (extension == ".flac") {
+		isRead = readFlac(file, result);
+	}
+	else if (extension == ".ogg" || extension == ".opus") {
+		isRead = readOgg(file, result);
+	}
+	else if (extension == ".wav") {
+		isRead = readWav(file, result);
+	}
+	if (isRead) {
+		musicInfo = std::move(result);
+	}
+	return isRead;
+}
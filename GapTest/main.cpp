@@ -0,0 +1,317 @@
+#include "core/AudioPlayer.hpp"
+#include <SDL.h>
+#include <SDL_mixer.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+
+/**
+ * Checks that the AudioPlayer starts the next music at the sample after the last one of the current music (gapless).
+ * Opens the dummy audio driver (SDL_AUDIODRIVER=dummy), writes two short WAV files in the format of the device and plays
+ * them with play() and setNext(). The first music ends with digital silence, which has to be played, too.
+ * - Decoded: the first music is prefetched with setNext() before play(), so both music are decoded completely. The test
+ *   calls AudioPlayer::mix() itself with buffers of different sizes, so the output does not depend on the timing.
+ * - Streamed: the first music is played at once, so SDL_mixer streams it in the audio callback of the dummy driver and
+ *   the AudioPlayer hands over to the decoded next music (like the music player does). A post mix callback records the
+ *   output of AudioPlayer::mix().
+ * A check passes if the output is the first music, then the second one and then silence. Each check runs with the
+ * default settings, with a crossfade which is turned off again (setCrossfade() with 0) and with a crossfade of
+ * CROSSFADE_FRAME_COUNT frames, which the second music has to overlap exactly.
+ * Usage: GapTest (returns EXIT_FAILURE if a check fails)
+ */
+
+static constexpr int FREQUENCY               = 44100;
+static constexpr int CHANNEL_COUNT           = 2;
+static constexpr int FRAME_COUNTS[2]         = { FREQUENCY / 4 + 17, FREQUENCY / 8 + 3 }; // ..do not end at the end of a buffer
+static constexpr int END_SILENCE_FRAME_COUNT = 300; //< the first music ends with this many silent frames
+static constexpr int CROSSFADE_MICROSECONDS  = 31250; //< 1/32 s
+static constexpr int CROSSFADE_FRAME_COUNT   = FREQUENCY / 32; //< CROSSFADE_MICROSECONDS rounded down to whole frames, like setCrossfade() does
+
+enum class Crossfade
+{
+	Default,   //< no setCrossfade()
+	TurnedOff, //< setCrossfade() with CROSSFADE_MICROSECONDS and then with 0
+	On         //< setCrossfade() with CROSSFADE_MICROSECONDS
+};
+
+/** What the AudioPlayer delivered to the device. */
+struct Output
+{
+	std::mutex          mutex; //< the audio callback appends to 'samples' (see recordMix())
+	std::vector<Sint16> samples;
+	int                 startedCount = 0; //< Event::NextStarted
+	bool                isEnded      = false;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Music
+///////////////////////////////////////////////////////////////////////////////
+/** Only the silence at the end of the first music is 0, and each other frame of both music is different. */
+static Sint16 getSample(int musicIndex, int frame, int channel)
+{
+	if (musicIndex == 0 && frame >= FRAME_COUNTS[0] - END_SILENCE_FRAME_COUNT) {
+		return 0;
+	}
+	int sample = 1 + frame % 16000 + channel * 16000;
+	return (Sint16)(musicIndex == 0 ? sample : -sample);
+}
+
+/** Returns the frame of the second music, or -1 if the frame is not one of it. */
+static int findSecondFrame(const Sint16* frameSamples)
+{
+	int frame = -frameSamples[0] - 1;
+	if (frame < 0 || frame >= FRAME_COUNTS[1]) {
+		return -1;
+	}
+	for (int channel = 0; channel < CHANNEL_COUNT; ++channel) {
+		if (frameSamples[channel] != getSample(1, frame, channel)) {
+			return -1;
+		}
+	}
+	return frame;
+}
+
+static void writeLE(std::ofstream& ofs, Uint32 value, int byteCount)
+{
+	for (int i = 0; i < byteCount; ++i) {
+		ofs.put((char)((value >> (8 * i)) & 0xFF));
+	}
+}
+
+/** 16 bit PCM with FREQUENCY and CHANNEL_COUNT, like the audio device, so SDL_mixer does not convert the samples. */
+static bool writeWav(const fs::path& path, int musicIndex)
+{
+	std::ofstream ofs(path, std::ios::binary);
+	Uint32 dataSize = FRAME_COUNTS[musicIndex] * CHANNEL_COUNT * 2;
+	ofs.write("RIFF", 4);
+	writeLE(ofs, 36 + dataSize, 4);
+	ofs.write("WAVEfmt ", 8);
+	writeLE(ofs, 16, 4);
+	writeLE(ofs, 1, 2); // ..PCM
+	writeLE(ofs, CHANNEL_COUNT, 2);
+	writeLE(ofs, FREQUENCY, 4);
+	writeLE(ofs, FREQUENCY * CHANNEL_COUNT * 2, 4);
+	writeLE(ofs, CHANNEL_COUNT * 2, 2);
+	writeLE(ofs, 16, 2);
+	ofs.write("data", 4);
+	writeLE(ofs, dataSize, 4);
+	for (int frame = 0; frame < FRAME_COUNTS[musicIndex]; ++frame) {
+		for (int channel = 0; channel < CHANNEL_COUNT; ++channel) {
+			writeLE(ofs, (Uint16)getSample(musicIndex, frame, channel), 2);
+		}
+	}
+	return ofs.good();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Play
+///////////////////////////////////////////////////////////////////////////////
+static void setCrossfade(core::AudioPlayer& player, Crossfade crossfade)
+{
+	if (crossfade != Crossfade::Default) {
+		player.setCrossfade(core::Time(core::Microseconds(CROSSFADE_MICROSECONDS)), core::AudioPlayer::FadeCurve::EqualPower);
+	}
+	if (crossfade == Crossfade::TurnedOff) {
+		player.setCrossfade(core::Time(), core::AudioPlayer::FadeCurve::EqualPower);
+	}
+}
+
+static bool waitForNext(const core::AudioPlayer& player)
+{
+	for (int i = 0; i < 5000 && !player.isNextLoaded(); ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return player.isNextLoaded();
+}
+
+static void pollEvents(core::AudioPlayer& player, Output& output)
+{
+	player.update();
+	core::AudioPlayer::Event event;
+	while (player.pollEvent(event)) {
+		if (event == core::AudioPlayer::Event::NextStarted) {
+			++output.startedCount;
+		}
+		else {
+			output.isEnded = true;
+		}
+	}
+}
+
+/** Decoded music: the test calls AudioPlayer::mix() itself. Returns false if the music was not loaded. */
+static bool mixDecoded(const fs::path musicPaths[2], int bufferFrameCount, Crossfade crossfade, Output& output)
+{
+	core::AudioPlayer player;
+	player.init();
+	Mix_SetPostMix(nullptr, nullptr); // ..the test mixes
+	setCrossfade(player, crossfade);
+	player.setNext(musicPaths[0]);
+	bool isLoaded = waitForNext(player);
+	player.play(musicPaths[0]);
+	player.setNext(musicPaths[1]);
+	isLoaded = isLoaded && waitForNext(player);
+	if (!isLoaded) {
+		return false;
+	}
+
+	std::vector<Uint8> buffer(bufferFrameCount * CHANNEL_COUNT * sizeof(Sint16));
+	for (int i = 0; i < 10000 && !output.isEnded; ++i) {
+		std::fill(buffer.begin(), buffer.end(), (Uint8)0);
+		core::AudioPlayer::mix(&player, buffer.data(), (int)buffer.size());
+		output.samples.insert(output.samples.end(), (const Sint16*)buffer.data(), (const Sint16*)(buffer.data() + buffer.size()));
+		pollEvents(player, output);
+	}
+	player.terminate();
+	return true;
+}
+
+struct Recorder
+{
+	core::AudioPlayer* player;
+	Output*            output;
+};
+
+/** Post mix callback of the streamed music: mixes like the AudioPlayer and records the output. */
+static void SDLCALL recordMix(void* userData, Uint8* stream, int length)
+{
+	Recorder* recorder = (Recorder*)userData;
+	core::AudioPlayer::mix(recorder->player, stream, length);
+	std::lock_guard<std::mutex> lock(recorder->output->mutex);
+	recorder->output->samples.insert(recorder->output->samples.end(), (const Sint16*)stream, (const Sint16*)(stream + length));
+}
+
+/** Streamed music: the dummy driver calls the audio callback in real time. Returns false if the music was not loaded. */
+static bool mixStreamed(const fs::path musicPaths[2], Crossfade crossfade, Output& output)
+{
+	core::AudioPlayer player;
+	player.init();
+	Recorder recorder = { &player, &output };
+	Mix_SetPostMix(&recordMix, &recorder);
+	setCrossfade(player, crossfade);
+	player.play(musicPaths[0]);
+	player.setNext(musicPaths[1]);
+	bool isLoaded = waitForNext(player);
+	for (int i = 0; isLoaded && i < 5000 && !output.isEnded; ++i) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		pollEvents(player, output);
+	}
+	Mix_SetPostMix(nullptr, nullptr); // waits for a running audio callback
+	player.terminate();
+	return isLoaded;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Check
+///////////////////////////////////////////////////////////////////////////////
+/** Returns false if the output is not the first music followed by the second one, which overlaps 'crossfadeFrameCount' frames. */
+static bool checkOutput(const Output& output, int crossfadeFrameCount)
+{
+	// The output may start with silence, till the first music is loaded:
+	const std::vector<Sint16>& samples = output.samples;
+	int outputFrameCount = (int)samples.size() / CHANNEL_COUNT;
+	int firstStart = 0;
+	while (firstStart < outputFrameCount && samples[firstStart * CHANNEL_COUNT] == 0 && samples[firstStart * CHANNEL_COUNT + 1] == 0) {
+		++firstStart;
+	}
+	// The second music has to start 'crossfadeFrameCount' frames before the first one ends; after the end, it is not faded in anymore:
+	int firstEnd = firstStart + FRAME_COUNTS[0];
+	int secondStart = -1;
+	for (int frame = firstEnd; frame < outputFrameCount && secondStart == -1; ++frame) {
+		int secondFrame = findSecondFrame(&samples[frame * CHANNEL_COUNT]);
+		secondStart = secondFrame == -1 ? -1 : frame - secondFrame;
+	}
+	// ..and all samples, which are not faded, have to be in order, followed by silence:
+	int wrongFrameCount = 0;
+	for (int frame = 0; frame < outputFrameCount; ++frame) {
+		int musicIndex = -1; // ..silence
+		int musicFrame = 0;
+		if (frame >= firstStart && frame < firstEnd - crossfadeFrameCount) {
+			musicIndex = 0;
+			musicFrame = frame - firstStart;
+		}
+		else if (frame >= firstEnd - crossfadeFrameCount && frame < firstEnd) {
+			continue; // ..crossfade
+		}
+		else if (frame >= firstEnd && frame < firstEnd - crossfadeFrameCount + FRAME_COUNTS[1]) {
+			musicIndex = 1;
+			musicFrame = frame - (firstEnd - crossfadeFrameCount);
+			if (musicFrame >= FRAME_COUNTS[1] - crossfadeFrameCount) {
+				continue; // ..the last music fades out
+			}
+		}
+		for (int channel = 0; channel < CHANNEL_COUNT; ++channel) {
+			Sint16 expectedSample = musicIndex == -1 ? 0 : getSample(musicIndex, musicFrame, channel);
+			if (samples[frame * CHANNEL_COUNT + channel] != expectedSample) {
+				++wrongFrameCount;
+				break;
+			}
+		}
+	}
+
+	bool isPassed = output.isEnded && output.startedCount == 1 && firstStart < outputFrameCount && secondStart == firstEnd - crossfadeFrameCount
+		&& wrongFrameCount == 0 && outputFrameCount >= firstEnd - crossfadeFrameCount + FRAME_COUNTS[1];
+	if (secondStart != -1 && secondStart >= firstEnd) {
+		std::cout << secondStart - firstEnd << " silent frames between the music, ";
+	}
+	else if (secondStart != -1) {
+		std::cout << firstEnd - secondStart << " frames overlap, ";
+	}
+	std::cout << wrongFrameCount << " wrong frames, " << output.startedCount << " started, " << (output.isEnded ? "ended" : "not ended") << ": "
+		<< (isPassed ? "passed" : "FAILED") << std::endl;
+	return isPassed;
+}
+
+static bool check(const fs::path musicPaths[2], int bufferFrameCount, Crossfade crossfade)
+{
+	const char* crossfadeNames[] = { "default", "turned off", "on" };
+	std::cout << (bufferFrameCount == 0 ? "Streamed" : "Decoded, buffer of " + std::to_string(bufferFrameCount) + " frames")
+		<< ", crossfade " << crossfadeNames[(int)crossfade] << ": ";
+	Output output;
+	bool isLoaded = bufferFrameCount == 0 ? mixStreamed(musicPaths, crossfade, output) : mixDecoded(musicPaths, bufferFrameCount, crossfade, output);
+	if (!isLoaded) {
+		std::cout << "FAILED (the music was not loaded)" << std::endl;
+		return false;
+	}
+	return checkOutput(output, crossfade == Crossfade::On ? CROSSFADE_FRAME_COUNT : 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Main
+///////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+	SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+	if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+		std::cerr << "SDL could not initialize! SDL Error: " << SDL_GetError() << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (Mix_OpenAudioDevice(FREQUENCY, AUDIO_S16SYS, CHANNEL_COUNT, 1024, nullptr, 0) == -1) {
+		std::cerr << "SDL mixer initialization failed! SDL Error: " << Mix_GetError() << std::endl;
+		SDL_Quit();
+		return EXIT_FAILURE;
+	}
+
+	fs::path directoryPath = fs::temp_directory_path() / "Console_MusicPlayer_GapTest";
+	fs::create_directories(directoryPath);
+	const fs::path musicPaths[2] = { directoryPath / "first.wav", directoryPath / "second.wav" };
+	bool isPassed = writeWav(musicPaths[0], 0) && writeWav(musicPaths[1], 1);
+	if (!isPassed) {
+		std::cerr << "The music can not be written to '" << directoryPath.u8string() << "'!" << std::endl;
+	}
+
+	for (int bufferFrameCount : { 1024, 441, 37, 0 }) { // ..0 streams the first music
+		for (Crossfade crossfade : { Crossfade::Default, Crossfade::TurnedOff, Crossfade::On }) {
+			isPassed = check(musicPaths, bufferFrameCount, crossfade) && isPassed;
+		}
+	}
+
+	std::error_code ec;
+	fs::remove_all(directoryPath, ec);
+	Mix_CloseAudio();
+	SDL_Quit();
+	return isPassed ? EXIT_SUCCESS : EXIT_FAILURE;
+}